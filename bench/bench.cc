@@ -0,0 +1,219 @@
+// mouse_client_bench: parsing, polling, counter history and motion decoding with
+// realistic payloads. Run with --json to get results that can be diffed between releases.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "bench.hpp"
+
+#ifndef MOUSE_CLIENT_SOURCE_DIR
+#define MOUSE_CLIENT_SOURCE_DIR "."
+#endif
+
+namespace Bench
+{
+    namespace
+    {
+        struct Summary
+        {
+            double mean, min, p50, p90, p99, p999, max;
+            double opsPerSecond;
+            double mbPerSecond;
+        };
+
+        // Nearest rank on the sorted samples
+        double percentile(const std::vector<double> &sorted, double p)
+        {
+            if (sorted.empty())
+                return 0;
+            size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+            return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+        }
+
+        Summary summarize(const Result &result)
+        {
+            std::vector<double> sorted = result.samples;
+            std::sort(sorted.begin(), sorted.end());
+
+            Summary s{};
+            s.mean = result.operations ? result.totalNs / result.operations : 0;
+            s.min = sorted.empty() ? 0 : sorted.front();
+            s.p50 = percentile(sorted, 50);
+            s.p90 = percentile(sorted, 90);
+            s.p99 = percentile(sorted, 99);
+            s.p999 = percentile(sorted, 99.9);
+            s.max = sorted.empty() ? 0 : sorted.back();
+            s.opsPerSecond = result.totalNs > 0 ? result.operations * 1e9 / result.totalNs : 0;
+            s.mbPerSecond = s.opsPerSecond * result.bytesPerOperation / 1e6;
+            return s;
+        }
+
+        std::string json_string(std::string_view text)
+        {
+            std::string out = "\"";
+            for (char c : text)
+            {
+                if (c == '"' || c == '\\')
+                    out.push_back('\\');
+                if (static_cast<unsigned char>(c) >= 0x20)
+                    out.push_back(c);
+            }
+            return out + "\"";
+        }
+
+        std::string number(double value)
+        {
+            char text[32];
+            std::snprintf(text, sizeof(text), "%.6g", value);
+            return text;
+        }
+    }
+
+    bool Runner::enabled(std::string_view name) const
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string_view::npos;
+    }
+
+    int Runner::scaled(int batches) const
+    {
+        return std::max(1, static_cast<int>(batches * options.scale));
+    }
+
+    void Runner::add(Result result)
+    {
+        Summary s = summarize(result);
+        char mbPerSecond[32] = "-";
+        if (result.bytesPerOperation)
+            std::snprintf(mbPerSecond, sizeof(mbPerSecond), "%.1f", s.mbPerSecond);
+        std::printf("%-24s %12.0f %12.0f %12.0f %12.0f %10s\n", result.name.c_str(), s.p50, s.p99, s.max,
+                    s.opsPerSecond, mbPerSecond);
+        std::fflush(stdout);
+        results.push_back(std::move(result));
+    }
+
+    void Runner::fail(const std::string &name, const std::string &reason)
+    {
+        std::printf("%-24s FAILED: %s\n", name.c_str(), reason.c_str());
+        failures.emplace_back(name, reason);
+    }
+
+    void Runner::print_header() const
+    {
+        std::printf("%-24s %12s %12s %12s %12s %10s\n", "case", "p50 ns", "p99 ns", "max ns", "ops/s", "MB/s");
+    }
+
+    bool Runner::write_json(const std::string &path) const
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out.is_open())
+            return false;
+
+        out << "{\n";
+        out << "  \"suite\": \"mouse_client_bench\",\n";
+        out << "  \"schema\": 1,\n";
+        out << "  \"timestamp\": " << std::time(nullptr) << ",\n";
+#ifdef __VERSION__
+        out << "  \"compiler\": " << json_string(__VERSION__) << ",\n";
+#endif
+#ifdef NDEBUG
+        out << "  \"optimized\": true,\n";
+#else
+        out << "  \"optimized\": false,\n";
+#endif
+        out << "  \"scale\": " << number(options.scale) << ",\n";
+        out << "  \"results\": [";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &r = results[i];
+            Summary s = summarize(r);
+            out << (i ? ",\n" : "\n");
+            out << "    {\"name\": " << json_string(r.name)
+                << ", \"operations\": " << r.operations
+                << ", \"bytes_per_op\": " << r.bytesPerOperation
+                << ", \"ops_per_sec\": " << number(s.opsPerSecond)
+                << ", \"mb_per_sec\": " << number(s.mbPerSecond)
+                << ", \"ns_per_op\": {\"mean\": " << number(s.mean)
+                << ", \"min\": " << number(s.min)
+                << ", \"p50\": " << number(s.p50)
+                << ", \"p90\": " << number(s.p90)
+                << ", \"p99\": " << number(s.p99)
+                << ", \"p999\": " << number(s.p999)
+                << ", \"max\": " << number(s.max) << "}}";
+        }
+        out << "\n  ],\n";
+        out << "  \"failures\": [";
+        for (size_t i = 0; i < failures.size(); ++i)
+            out << (i ? ", " : "") << "{\"name\": " << json_string(failures[i].first)
+                << ", \"reason\": " << json_string(failures[i].second) << "}";
+        out << "]\n}\n";
+        return out.good();
+    }
+}
+
+static void print_usage()
+{
+    std::cout << "Usage: mouse_client_bench [--filter <text>] [--json <file>] [--quick] [--data <dir>]\n"
+                 "  --filter  only run cases whose name contains text, e.g. history/\n"
+                 "  --json    also write the results as JSON\n"
+                 "  --quick   a tenth of the iterations, for smoke runs\n"
+                 "  --data    directory with the serial_output_*.txt motion samples\n";
+}
+
+int main(int argc, char *argv[])
+{
+    Bench::Options options;
+    options.dataDir = MOUSE_CLIENT_SOURCE_DIR "/scripts/sample_motion_data";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            options.jsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "--data") == 0 && i + 1 < argc)
+            options.dataDir = argv[++i];
+        else if (std::strcmp(argv[i], "--quick") == 0)
+            options.scale = 0.1;
+        else
+        {
+            print_usage();
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    std::error_code ec;
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::filesystem::path temp = std::filesystem::temp_directory_path(ec) / ("mouse_client_bench." + std::to_string(stamp));
+    std::filesystem::create_directories(temp, ec);
+    if (ec)
+    {
+        std::cerr << "Cannot create " << temp << ": " << ec.message() << std::endl;
+        return 1;
+    }
+    options.tempDir = temp.string();
+
+    // The table is printf'd to stdout, what the code under test logs goes to stderr instead
+    std::streambuf *out = std::cout.rdbuf(std::cerr.rdbuf());
+
+    Bench::Runner runner(options);
+    runner.print_header();
+    Bench::parse_benchmarks(runner);
+    Bench::poll_benchmarks(runner);
+    Bench::history_benchmarks(runner);
+    Bench::motion_benchmarks(runner);
+
+    std::filesystem::remove_all(temp, ec);
+    std::cout.rdbuf(out);
+
+    if (!options.jsonPath.empty() && !runner.write_json(options.jsonPath))
+    {
+        std::cerr << "Failed to write " << options.jsonPath << std::endl;
+        return 1;
+    }
+    return runner.failed() ? 1 : 0;
+}
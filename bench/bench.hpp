@@ -0,0 +1,94 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Minimal harness for mouse_client_bench. Every case times its operation in batches,
+// one latency sample per batch, and the runner reports percentiles and throughput as
+// a table and optionally as JSON that can be diffed between releases.
+namespace Bench
+{
+    struct Options
+    {
+        std::string filter;   // only cases whose name contains this
+        std::string jsonPath; // also write the results here
+        std::string dataDir;  // scripts/sample_motion_data
+        std::string tempDir;  // scratch files, removed on exit
+        double scale = 1.0;   // iteration multiplier, --quick uses 0.1
+    };
+
+    struct Result
+    {
+        std::string name;
+        uint64_t operations = 0;
+        uint64_t bytesPerOperation = 0; // 0 when throughput in bytes makes no sense
+        double totalNs = 0;
+        std::vector<double> samples; // ns per operation, one per batch
+    };
+
+    class Runner
+    {
+    public:
+        explicit Runner(const Options &options) : options(options) {}
+
+        bool enabled(std::string_view name) const;
+        const Options &settings() const { return options; }
+
+        // Times batches * batchSize calls of fn after one untimed warm-up batch
+        template <typename Fn>
+        void run(const std::string &name, int batches, int batchSize, uint64_t bytesPerOperation, Fn fn)
+        {
+            using namespace std::chrono;
+            batches = scaled(batches);
+
+            for (int i = 0; i < batchSize; ++i)
+                fn();
+
+            Result result;
+            result.name = name;
+            result.bytesPerOperation = bytesPerOperation;
+            result.samples.reserve(batches);
+            for (int b = 0; b < batches; ++b)
+            {
+                auto start = steady_clock::now();
+                for (int i = 0; i < batchSize; ++i)
+                    fn();
+                double ns = duration<double, std::nano>(steady_clock::now() - start).count();
+                result.totalNs += ns;
+                result.samples.push_back(ns / batchSize);
+            }
+            result.operations = static_cast<uint64_t>(batches) * batchSize;
+            add(std::move(result));
+        }
+
+        // A case that could not run, e.g. missing sample data; reported and fails the run
+        void fail(const std::string &name, const std::string &reason);
+
+        void print_header() const;
+        bool write_json(const std::string &path) const;
+        bool failed() const { return !failures.empty(); }
+
+    private:
+        int scaled(int batches) const;
+        void add(Result result);
+
+        Options options;
+        std::vector<Result> results;
+        std::vector<std::pair<std::string, std::string>> failures;
+    };
+
+    // Keeps the optimizer from dropping a result nobody reads
+    inline void keep(uint64_t value)
+    {
+        static volatile uint64_t sink;
+        sink = sink + value;
+    }
+
+    // One per bench/*_bench.cc
+    void parse_benchmarks(Runner &runner);
+    void poll_benchmarks(Runner &runner);
+    void history_benchmarks(Runner &runner);
+    void motion_benchmarks(Runner &runner);
+}
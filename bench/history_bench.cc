@@ -0,0 +1,294 @@
+// The per-poll writes in Gui::updateGui (history record and snapshot) and the startup
+// reads in gui_init, against files in the scratch directory, reopening after a crash tore the
+// last keyframe, the rollups against a rescan of the raw history and the history chart
+// redrawing a day, a month and a year
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+#include "bench.hpp"
+#include "../src/include/history_chart.hpp"
+#include "../src/include/rollup.hpp"
+#include "../src/include/stats_store.hpp"
+
+namespace Bench
+{
+    namespace
+    {
+        // Counters as a mouse in use produces them, a few clicks between two polls
+        struct Usage
+        {
+            ComPort::MouseStatus status;
+            int64_t time = 1756637000;
+            uint32_t step = 0;
+
+            Usage()
+            {
+                status.left_clicks = 116982;
+                status.right_clicks = 372741;
+                status.middle_clicks = 31681;
+                status.backward_clicks = 804;
+                status.forward_clicks = 77;
+                status.downward_scrolls = 47768;
+                status.upward_scrolls = 18027;
+                status.battery_percent = 64;
+                status.current_dpi = 1600;
+            }
+
+            void next()
+            {
+                ++step;
+                time += 2;
+                status.left_clicks += step % 3;
+                status.right_clicks += step % 5 == 0;
+                status.downward_scrolls += step % 4;
+                status.upward_scrolls += step % 7 == 0;
+            }
+        };
+
+        const size_t historyRecords = 100000;
+        const size_t chartRecords = 365 * 24 * 30; // a year, a poll every 2 minutes
+        const int chartWidth = 1000;
+    }
+
+    void history_benchmarks(Runner &runner)
+    {
+        const std::string dir = runner.settings().tempDir;
+        const std::string appendPath = dir + "/append.bin";
+        const std::string historyPath = dir + "/history.bin";
+        const std::string snapshotPath = dir + "/mouse_stats.last";
+        const std::string rollupPath = dir + "/rollup.bin";
+        const std::string chartPath = dir + "/chart.bin";
+
+        if (runner.enabled("history/append"))
+        {
+            Stats::Store store;
+            if (!store.open(appendPath))
+            {
+                runner.fail("history/append", "cannot open " + appendPath);
+                return;
+            }
+
+            Usage usage;
+            bool ok = true;
+            runner.run("history/append", 20000, 10, 0, [&]
+                       {
+                           usage.next();
+                           ok &= store.append(Stats::from_status(usage.status, usage.time)); });
+            if (!ok)
+                runner.fail("history/append", "append failed");
+        }
+
+        if (runner.enabled("history/snapshot_write"))
+        {
+            Usage usage;
+            bool ok = true;
+            runner.run("history/snapshot_write", 2000, 10, sizeof(Stats::Snapshot), [&]
+                       {
+                           usage.next();
+                           ok &= Stats::write_snapshot(snapshotPath, Stats::snapshot_from_status(usage.status, usage.time)); });
+            if (!ok)
+                runner.fail("history/snapshot_write", "write failed");
+        }
+
+        if (runner.enabled("history/snapshot_read"))
+        {
+            Usage usage;
+            Stats::write_snapshot(snapshotPath, Stats::snapshot_from_status(usage.status, usage.time));
+            Stats::Snapshot snapshot;
+            bool ok = true;
+            runner.run("history/snapshot_read", 2000, 10, sizeof(Stats::Snapshot), [&]
+                       { ok &= Stats::read_snapshot(snapshotPath, snapshot); keep(snapshot.time); });
+            if (!ok)
+                runner.fail("history/snapshot_read", "read failed");
+        }
+
+        if (runner.enabled("history/rollup_add"))
+        {
+            Stats::Store store;
+            Stats::Rollups rollups;
+            if (!store.open(rollupPath) || !rollups.open(rollupPath, store))
+            {
+                runner.fail("history/rollup_add", "cannot open " + rollupPath);
+                return;
+            }
+
+            Usage usage;
+            bool ok = true;
+            runner.run("history/rollup_add", 20000, 10, 0, [&]
+                       {
+                           usage.next();
+                           ok &= rollups.add(Stats::from_status(usage.status, usage.time)); });
+            if (!ok)
+                runner.fail("history/rollup_add", "add failed");
+        }
+
+        if (runner.enabled("history/open_100k") || runner.enabled("history/open_torn_keyframe") ||
+            runner.enabled("history/scan_100k") || runner.enabled("history/hourly_100k"))
+        {
+            {
+                Stats::Store store;
+                if (!store.open(historyPath))
+                {
+                    runner.fail("history/open_100k", "cannot open " + historyPath);
+                    return;
+                }
+                Usage usage;
+                for (size_t i = 0; i < historyRecords; ++i)
+                {
+                    usage.next();
+                    store.append(Stats::from_status(usage.status, usage.time));
+                }
+            }
+            std::error_code ec;
+            const uint64_t historyBytes = std::filesystem::file_size(historyPath, ec);
+
+            // gui_init: open the store, which recovers the latest reading from the last keyframe
+            if (runner.enabled("history/open_100k"))
+                runner.run("history/open_100k", 200, 1, 0, [&]
+                           {
+                               Stats::Store store;
+                               store.open(historyPath);
+                               keep(store.latest().time); });
+
+            // Opening after a crash tore the last keyframe: the entry before it is replayed and
+            // only the torn bytes go, the history before them must survive
+            if (runner.enabled("history/open_torn_keyframe"))
+            {
+                const std::string tornPath = dir + "/torn.bin";
+                struct
+                {
+                    int64_t time;
+                    uint64_t offset;
+                } lastKeyframe{};
+                std::ifstream index(historyPath + ".idx", std::ios::binary);
+                index.seekg(-static_cast<std::streamoff>(sizeof(lastKeyframe)), std::ios::end);
+                index.read(reinterpret_cast<char *>(&lastKeyframe), sizeof(lastKeyframe));
+
+                // What the store should recover: the last record before that keyframe
+                Stats::Record expected;
+                {
+                    Stats::Store intact;
+                    intact.open(historyPath);
+                    intact.scan(INT64_MIN, lastKeyframe.time - 1, [&](const Stats::Record &record)
+                                { expected = record; });
+                }
+
+                bool ok = static_cast<bool>(index);
+                runner.run("history/open_torn_keyframe", 200, 1, 0, [&]
+                           {
+                               std::filesystem::copy_file(historyPath, tornPath, std::filesystem::copy_options::overwrite_existing, ec);
+                               std::filesystem::copy_file(historyPath + ".idx", tornPath + ".idx",
+                                                          std::filesystem::copy_options::overwrite_existing, ec);
+                               std::filesystem::resize_file(tornPath, lastKeyframe.offset + 3, ec);
+                               Stats::Store store;
+                               ok &= store.open(tornPath) && store.latest().time == expected.time &&
+                                     store.latest().counters == expected.counters;
+                               keep(store.latest().time); });
+                if (!ok || std::filesystem::file_size(tornPath, ec) != lastKeyframe.offset)
+                    runner.fail("history/open_torn_keyframe", "history before the torn keyframe was lost");
+            }
+
+            if (runner.enabled("history/scan_100k"))
+            {
+                Stats::Store store;
+                store.open(historyPath);
+                runner.run("history/scan_100k", 50, 1, historyBytes, [&]
+                           {
+                               uint64_t records = 0;
+                               store.scan(INT64_MIN, INT64_MAX, [&](const Stats::Record &)
+                                          { ++records; });
+                               keep(records); });
+            }
+
+            // Clicks per hour over the whole history: every raw record, or the hour rollups
+            if (runner.enabled("history/hourly_100k"))
+            {
+                Stats::Store store;
+                store.open(historyPath);
+                runner.run("history/hourly_100k_raw", 20, 1, historyBytes, [&]
+                           {
+                               uint64_t hours = 0, clicks = 0;
+                               int64_t hour = INT64_MIN;
+                               Stats::Record previous;
+                               bool first = true;
+                               store.scan(INT64_MIN, INT64_MAX, [&](const Stats::Record &record)
+                                          {
+                                              if (!first)
+                                                  clicks += Stats::increase(previous.counters, record.counters)[0];
+                                              first = false;
+                                              previous = record;
+                                              if (record.time >= hour + 3600)
+                                              {
+                                                  hour = Stats::bucket_start(Stats::RESOLUTION_HOUR, record.time);
+                                                  ++hours;
+                                              } });
+                               keep(hours + clicks); });
+
+                std::error_code ec;
+                for (const char *suffix : {".min", ".hour", ".day"})
+                    std::filesystem::remove(historyPath + suffix, ec);
+                Stats::Rollups rollups; // built from the history here, which it reports
+                if (!rollups.open(historyPath, store))
+                {
+                    runner.fail("history/hourly_100k", "cannot build the rollups");
+                    return;
+                }
+                runner.run("history/hourly_100k", 2000, 1, 0, [&]
+                           {
+                               uint64_t clicks = 0;
+                               rollups.scan(Stats::RESOLUTION_HOUR, INT64_MIN, INT64_MAX, [&](const Stats::Bucket &bucket)
+                                            { clicks += bucket.counts[0]; });
+                               keep(clicks); });
+            }
+        }
+
+        // One redraw of the chart: pick the level, stream its buckets into chartWidth columns
+        if (runner.enabled("history/chart_day") || runner.enabled("history/chart_month") ||
+            runner.enabled("history/chart_year"))
+        {
+            std::error_code ec;
+            for (const char *suffix : {"", ".min", ".hour", ".day"})
+                std::filesystem::remove(chartPath + suffix, ec);
+            Stats::Store store;
+            Stats::Rollups rollups;
+            if (!store.open(chartPath) || !rollups.open(chartPath, store))
+            {
+                runner.fail("history/chart_year", "cannot open " + chartPath);
+                return;
+            }
+            Usage usage;
+            bool ok = true;
+            for (size_t i = 0; i < chartRecords; ++i)
+            {
+                usage.next();
+                usage.time += 118;
+                const Stats::Record record = Stats::from_status(usage.status, usage.time);
+                ok &= store.append(record) && rollups.add(record);
+            }
+            if (!ok)
+            {
+                runner.fail("history/chart_year", "cannot build the history");
+                return;
+            }
+
+            const int64_t now = usage.time;
+            for (auto [name, seconds] : {std::pair{"history/chart_day", int64_t(86400)},
+                                         std::pair{"history/chart_month", int64_t(30 * 86400)},
+                                         std::pair{"history/chart_year", int64_t(365 * 86400)}})
+            {
+                if (!runner.enabled(name))
+                    continue;
+                Stats::Downsampler downsampler;
+                runner.run(name, 200, 1, 0, [&]
+                           {
+                               const int64_t from = now - seconds;
+                               const Stats::Resolution resolution = Stats::chart_resolution(from, now, chartWidth);
+                               downsampler.begin(from, now, chartWidth, resolution, 0x1f);
+                               rollups.scan(resolution, from, now, [&](const Stats::Bucket &bucket)
+                                            { downsampler.add(bucket); });
+                               keep(downsampler.finish().size() + downsampler.peak()); });
+            }
+        }
+    }
+}
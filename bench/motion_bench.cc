@@ -0,0 +1,161 @@
+// Decoding the captures in scripts/sample_motion_data, from the text log as --motion-replay
+// reads it and from the .mcol conversion, and --motion-analyze over the sample repeated to
+// ten million samples with the SSE2 and the scalar kernels, and --motion-ingest of many
+// copies of the sample on one thread and on all of them
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+
+#include "bench.hpp"
+#include "../src/include/motion_analysis.hpp"
+#include "../src/include/motion_capture.hpp"
+#include "../src/include/motion_ingest.hpp"
+#include "../src/include/motion_store.hpp"
+
+namespace Bench
+{
+    static constexpr size_t analysisSamples = 10'000'000;
+
+    static void analysis_benchmarks(Runner &runner, const std::string &textPath)
+    {
+        if (!runner.enabled("motion/analyze"))
+            return;
+
+        Motion::Capture sample, capture;
+        Motion::Decoder decoder(sample);
+        if (!Motion::decode_file(textPath, decoder) || sample.size() == 0)
+        {
+            runner.fail("motion/analyze", "cannot decode " + textPath);
+            return;
+        }
+        capture.reserve(analysisSamples);
+        while (capture.size() < analysisSamples)
+        {
+            const size_t take = std::min(sample.size(), analysisSamples - capture.size());
+            auto append = [take](auto &to, const auto &from)
+            { to.insert(to.end(), from.begin(), from.begin() + static_cast<std::ptrdiff_t>(take)); };
+            append(capture.block, sample.block);
+            append(capture.before_x, sample.before_x);
+            append(capture.before_y, sample.before_y);
+            append(capture.after_x, sample.after_x);
+            append(capture.after_y, sample.after_y);
+            append(capture.x_cond, sample.x_cond);
+            append(capture.y_cond, sample.y_cond);
+        }
+
+        // What analyze reads of a sample: four int16 columns and the two conditions
+        const uint64_t bytes = analysisSamples * (4 * sizeof(int16_t) + 2);
+        const std::string vectorName = std::string("motion/analyze_10m_") + Motion::vector_kernels();
+        Motion::Analysis vector, scalar;
+        runner.run(vectorName, 20, 1, bytes, [&]
+                   {
+                       vector = Motion::analyze(capture, Motion::Kernels::VECTOR);
+                       keep(vector.samples); });
+        runner.run("motion/analyze_10m_scalar", 20, 1, bytes, [&]
+                   {
+                       scalar = Motion::analyze(capture, Motion::Kernels::SCALAR);
+                       keep(scalar.samples); });
+        if (vector.axes[Motion::AXIS_AFTER_X].accelRms != scalar.axes[Motion::AXIS_AFTER_X].accelRms ||
+            vector.deltaY.changed != scalar.deltaY.changed || vector.yCondTriggers != scalar.yCondTriggers)
+            runner.fail(vectorName, "differs from the scalar kernels");
+    }
+
+    static constexpr int ingestFiles = 64;
+
+    static void ingest_benchmarks(Runner &runner, const std::string &textPath, uint64_t textBytes)
+    {
+        if (!runner.enabled("motion/ingest"))
+            return;
+
+        const std::string dir = runner.settings().tempDir + "/ingest";
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        std::vector<std::string> paths;
+        for (int i = 0; i < ingestFiles; ++i)
+        {
+            char name[40];
+            snprintf(name, sizeof(name), "/serial_output_%03d.txt", i);
+            paths.push_back(dir + name);
+            std::filesystem::copy_file(textPath, paths.back(), std::filesystem::copy_options::overwrite_existing, ec);
+            if (ec)
+            {
+                runner.fail("motion/ingest", "cannot copy " + textPath + " to " + dir);
+                return;
+            }
+        }
+
+        // Small parts, so that even one file keeps several workers busy
+        const std::string archivePath = runner.settings().tempDir + "/ingest.mcol";
+        std::vector<unsigned> threadCounts{1};
+        if (std::thread::hardware_concurrency() > 1)
+            threadCounts.push_back(std::thread::hardware_concurrency());
+        for (unsigned threads : threadCounts)
+        {
+            const std::string name = "motion/ingest_" + std::to_string(ingestFiles) + "x_" + std::to_string(threads) +
+                                     (threads == 1 ? "thread" : "threads");
+            Motion::IngestOptions options;
+            options.threads = threads;
+            options.partBytes = 64 << 10;
+            Motion::IngestResult result;
+            bool ok = true;
+            runner.run(name, 5, 1, ingestFiles * textBytes, [&]
+                       {
+                           ok &= Motion::ingest_captures(paths, archivePath, options, result);
+                           keep(result.samples); });
+            if (!ok || result.failed != 0)
+                runner.fail(name, "ingest failed");
+        }
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    void motion_benchmarks(Runner &runner)
+    {
+        const std::string textPath = runner.settings().dataDir + "/serial_output_20250831_125709.txt";
+        const std::string columnarPath = runner.settings().tempDir + "/sample.mcol";
+
+        std::error_code ec;
+        const uint64_t textBytes = std::filesystem::file_size(textPath, ec);
+        if (ec)
+        {
+            runner.fail("motion/*", "no sample capture at " + textPath);
+            return;
+        }
+
+        analysis_benchmarks(runner, textPath);
+        ingest_benchmarks(runner, textPath, textBytes);
+
+        Motion::Capture capture;
+        if (runner.enabled("motion/decode_text"))
+        {
+            bool ok = true;
+            runner.run("motion/decode_text", 100, 1, textBytes, [&]
+                       {
+                           capture.clear();
+                           Motion::Decoder decoder(capture);
+                           ok &= Motion::decode_file(textPath, decoder);
+                           keep(capture.size()); });
+            if (!ok)
+                runner.fail("motion/decode_text", "decode failed");
+        }
+
+        if (!runner.enabled("motion/read_mcol_all"))
+            return;
+
+        if (Motion::convert_text_capture(textPath, columnarPath) <= 0)
+        {
+            runner.fail("motion/read_mcol_all", "cannot convert " + textPath);
+            return;
+        }
+        const uint64_t columnarBytes = std::filesystem::file_size(columnarPath, ec);
+
+        // Opening maps the file, so it is part of what a replay pays
+        runner.run("motion/read_mcol_all", 500, 1, columnarBytes, [&]
+                   {
+                       capture.clear();
+                       Motion::ColumnReader reader;
+                       if (reader.open(columnarPath))
+                           reader.read_all(capture);
+                       keep(capture.size()); });
+    }
+}
@@ -0,0 +1,124 @@
+// Per-response cost of parsing a mouse stats dump: the regex code read_data_mouse
+// used to run versus the single-pass parser in response_parser.cc, and the binary
+// STATUS frame that replaces the dump on newer firmware
+#include <regex>
+#include <string>
+
+#include "bench.hpp"
+#include "../src/include/binary_protocol.hpp"
+#include "../src/include/response_parser.hpp"
+
+static const std::string sampleResponse =
+    "==================== Mouse Stats ====================\r\n"
+    "Firmware build date: Aug 31 2025 12:41:07\r\n"
+    "Left clicks: 116982\r\n"
+    "Right clicks: 372741\r\n"
+    "Middle clicks: 31681\r\n"
+    "Backward clicks: 804\r\n"
+    "Forward clicks: 77\r\n"
+    "Downward scrolls: 47768\r\n"
+    "Upward scrolls: 18027\r\n"
+    "Battery level: 3712mV = 64%\r\n"
+    "Current DPI [400, 800, 1600, 3200]: 1600\r\n"
+    "=====================================================\r\n";
+
+// Verbatim copy of the parsing half of the old read_data_mouse
+static void regex_parse(const std::string &response, ComPort::MouseStatus &status)
+{
+    std::smatch m;
+
+    std::regex clicks_re(R"(Left clicks:\s*(\d+))");
+    if (std::regex_search(response, m, clicks_re))
+        status.left_clicks = std::stoull(m[1]);
+
+    clicks_re = std::regex(R"(Right clicks:\s*(\d+))");
+    if (std::regex_search(response, m, clicks_re))
+        status.right_clicks = std::stoull(m[1]);
+
+    clicks_re = std::regex(R"(Middle clicks:\s*(\d+))");
+    if (std::regex_search(response, m, clicks_re))
+        status.middle_clicks = std::stoull(m[1]);
+
+    clicks_re = std::regex(R"(Backward clicks:\s*(\d+))");
+    if (std::regex_search(response, m, clicks_re))
+        status.backward_clicks = std::stoull(m[1]);
+
+    clicks_re = std::regex(R"(Forward clicks:\s*(\d+))");
+    if (std::regex_search(response, m, clicks_re))
+        status.forward_clicks = std::stoull(m[1]);
+
+    clicks_re = std::regex(R"(Downward scrolls:\s*(\d+))");
+    if (std::regex_search(response, m, clicks_re))
+        status.downward_scrolls = std::stoull(m[1]);
+
+    clicks_re = std::regex(R"(Upward scrolls:\s*(\d+))");
+    if (std::regex_search(response, m, clicks_re))
+        status.upward_scrolls = std::stoull(m[1]);
+
+    std::regex battery_re(R"(Battery level:\s*(-?\d+)mV\s*=\s*(\d+)%?)");
+    if (std::regex_search(response, m, battery_re))
+    {
+        status.battery_mv = std::stoi(m[1]);
+        status.battery_percent = std::stoi(m[2]);
+    }
+
+    std::regex dpi_re(R"(Current DPI \[.*\]:\s*(\d+))");
+    if (std::regex_search(response, m, dpi_re))
+        status.current_dpi = std::stoi(m[1]);
+}
+
+namespace Bench
+{
+    void parse_benchmarks(Runner &runner)
+    {
+        ComPort::MouseStatus before, after;
+        regex_parse(sampleResponse, before);
+        uint32_t found = ComPort::parse_response(sampleResponse, after);
+
+        if (before.left_clicks != after.left_clicks || before.upward_scrolls != after.upward_scrolls ||
+            before.battery_mv != after.battery_mv || before.battery_percent != after.battery_percent ||
+            before.current_dpi != after.current_dpi || (ComPort::MOUSE_FIELDS & ~found))
+        {
+            runner.fail("parse/*", "parsers disagree on the sample response");
+            return;
+        }
+
+        if (runner.enabled("parse/regex"))
+            runner.run("parse/regex", 200, 10, sampleResponse.size(), [&]
+                       { regex_parse(sampleResponse, before); keep(before.left_clicks); });
+
+        if (runner.enabled("parse/single_pass"))
+            runner.run("parse/single_pass", 20000, 100, sampleResponse.size(), [&]
+                       { keep(ComPort::parse_response(sampleResponse, after)); });
+
+        // The report as read_data_mouse sees it, line by line out of the frame reader
+        if (runner.enabled("parse/lines"))
+        {
+            std::vector<std::string_view> lines;
+            std::string_view rest = sampleResponse;
+            for (size_t end; (end = rest.find('\n')) != std::string_view::npos; rest.remove_prefix(end + 1))
+                lines.push_back(rest.substr(0, end));
+
+            runner.run("parse/lines", 20000, 100, sampleResponse.size(), [&]
+                       {
+                           uint32_t fields = ComPort::FIELD_NONE;
+                           for (std::string_view line : lines)
+                               fields |= ComPort::parse_line(line, after);
+                           keep(fields); });
+        }
+
+        if (runner.enabled("parse/binary"))
+        {
+            const std::string frame = ComPort::encode_status_frame(after, ComPort::Subject::MOUSE);
+            ComPort::MouseStatus decoded;
+            if (ComPort::decode_status_frame(frame, decoded) != ComPort::MOUSE_FIELDS ||
+                decoded.left_clicks != after.left_clicks || decoded.current_dpi != after.current_dpi)
+            {
+                runner.fail("parse/binary", "STATUS frame does not round trip");
+                return;
+            }
+            runner.run("parse/binary", 20000, 100, frame.size(), [&]
+                       { keep(ComPort::decode_status_frame(frame, decoded)); });
+        }
+    }
+}
@@ -0,0 +1,260 @@
+// One status poll the way read_data_mouse does it, against the simulated firmware on the
+// other end of an in-memory transport. Measures the client side without the serial line.
+// Also DeviceManager rounds over many devices, a subscribed device that cannot notify the
+// manager, and identifying many ports at discovery.
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "bench.hpp"
+#include "../src/include/device_manager.hpp"
+#include "../src/include/device_protocol.hpp"
+#include "../src/include/firmware_sim.hpp"
+#include "../src/include/metrics.hpp"
+
+namespace Bench
+{
+    static void poll_case(Runner &runner, const std::string &name, size_t responseBytes,
+                          ComPort::Protocol protocol = ComPort::Protocol::TEXT)
+    {
+        if (!runner.enabled(name))
+            return;
+
+        auto [client, device] = ComPort::MemoryTransport::pair();
+        Sim::Options options;
+        options.baud = 0;
+        options.responseBytes = responseBytes;
+        Sim::FirmwareSim sim(*device, options);
+        const bool binary = protocol == ComPort::Protocol::BINARY;
+        const size_t reportBytes = binary ? sim.status_frame().size() : sim.status_report().size();
+
+        std::atomic<bool> stop = false;
+        std::thread firmware([&]
+                             { sim.run(stop); });
+
+        ComPort::FrameReader rx = binary ? ComPort::FrameReader(ComPort::frameHeaderSize, ComPort::binary_frame_length)
+                                         : ComPort::FrameReader("\n");
+        ComPort::MouseStatus status;
+        bool ok = true;
+        runner.run(name, 2000, 1, reportBytes, [&]
+                   {
+                       ok &= ComPort::query_status(*client, rx, ComPort::Subject::MOUSE, status, protocol);
+                       keep(status.left_clicks); });
+
+        stop = true;
+        firmware.join();
+        if (!ok)
+            runner.fail(name, "query_status failed");
+    }
+
+    // One round of DeviceManager polling every one of count simulated mice. The time per
+    // device should stay flat as count grows.
+    static void manager_case(Runner &runner, const std::string &name, int count)
+    {
+        if (!runner.enabled(name))
+            return;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        uint64_t readings = 0;
+        ComPort::DeviceManager::Options managerOptions;
+        managerOptions.pollPeriod = std::chrono::hours(1);
+        managerOptions.subscribe = false; // a round of polls, not pushed changes
+        managerOptions.log = false;
+        ComPort::DeviceManager manager(managerOptions);
+        manager.start([&](const ComPort::DeviceInfo &, const ComPort::Reading &)
+                      {
+                          std::lock_guard<std::mutex> lock(mutex);
+                          ++readings;
+                          cv.notify_one(); }, nullptr);
+
+        Sim::Options options;
+        options.baud = 0;
+        std::atomic<bool> stop = false;
+        std::vector<std::unique_ptr<ComPort::MemoryTransport>> ends;
+        std::vector<std::unique_ptr<Sim::FirmwareSim>> sims;
+        std::vector<std::thread> firmware;
+        for (int i = 0; i < count; ++i)
+        {
+            auto [client, device] = ComPort::MemoryTransport::pair();
+            sims.push_back(std::make_unique<Sim::FirmwareSim>(*device, options));
+            ends.push_back(std::move(device));
+            manager.add({L"sim" + std::to_wstring(i), "", ComPort::Subject::MOUSE}, std::move(client));
+        }
+        for (int i = 0; i < count; ++i)
+            firmware.emplace_back([&, i]
+                                  { sims[i]->run(stop); });
+
+        // Every device is polled once as soon as it is added
+        auto wait_for = [&](uint64_t target)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            return cv.wait_for(lock, std::chrono::seconds(5), [&]
+                               { return readings >= target; });
+        };
+        bool ok = wait_for(count);
+
+        const size_t reportBytes = sims[0]->status_frame().size();
+        runner.run(name, 500, 1, reportBytes * count, [&]
+                   {
+                       uint64_t target;
+                       {
+                           std::lock_guard<std::mutex> lock(mutex);
+                           target = readings + count;
+                       }
+                       manager.poll_now();
+                       ok &= wait_for(target); });
+
+        manager.stop();
+        stop = true;
+        for (std::thread &thread : firmware)
+            thread.join();
+        if (!ok)
+            runner.fail(name, "a round did not complete");
+    }
+
+    // A transport that cannot notify, the way the Windows serial port is, so the manager
+    // has to read it
+    class PolledTransport : public ComPort::Transport
+    {
+    public:
+        explicit PolledTransport(std::unique_ptr<ComPort::Transport> inner) : inner(std::move(inner)) {}
+
+        bool send(std::string_view bytes) override { return inner->send(bytes); }
+        int receive(std::span<char> buffer, int timeoutMs) override { return inner->receive(buffer, timeoutMs); }
+        void discard_input() override { inner->discard_input(); }
+        std::string name() const override { return inner->name(); }
+
+    private:
+        std::unique_ptr<ComPort::Transport> inner;
+    };
+
+    // A subscribed mouse on a polled transport that has nothing to report. The manager should
+    // wake every subscribedReadInterval, not every 10 ms poll of a pending response.
+    static void subscribed_polled_case(Runner &runner, const std::string &name)
+    {
+        if (!runner.enabled(name))
+            return;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        uint64_t readings = 0;
+        ComPort::DeviceManager::Options managerOptions;
+        managerOptions.pollPeriod = std::chrono::hours(1);
+        managerOptions.log = false;
+        ComPort::DeviceManager manager(managerOptions);
+        manager.start([&](const ComPort::DeviceInfo &, const ComPort::Reading &)
+                      {
+                          std::lock_guard<std::mutex> lock(mutex);
+                          ++readings;
+                          cv.notify_one(); }, nullptr);
+
+        auto [client, device] = ComPort::MemoryTransport::pair();
+        Sim::Options options;
+        options.baud = 0;
+        Sim::FirmwareSim sim(*device, options);
+        std::atomic<bool> stop = false;
+        std::thread firmware([&]
+                             { sim.run(stop); });
+        manager.add({L"sim0", "", ComPort::Subject::MOUSE}, std::make_unique<PolledTransport>(std::move(client)));
+
+        // The answer to 'S' is the first reading, from then on the mouse only pushes changes
+        bool ok;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ok = cv.wait_for(lock, std::chrono::seconds(5), [&]
+                             { return readings >= 1; });
+        }
+
+        const std::chrono::milliseconds idle(1000);
+        const uint64_t allowed = idle / managerOptions.subscribedReadInterval + 2;
+        uint64_t wakeups = 0;
+        runner.run(name, 1, 1, 0, [&]
+                   {
+                       const uint64_t before = Metrics::counter(Metrics::COUNTER_MANAGER_WAKEUPS);
+                       std::this_thread::sleep_for(idle);
+                       wakeups = std::max(wakeups, Metrics::counter(Metrics::COUNTER_MANAGER_WAKEUPS) - before); });
+
+        manager.stop();
+        stop = true;
+        firmware.join();
+        if (!ok)
+            runner.fail(name, "the subscription was not answered");
+        else if (wakeups > allowed)
+            runner.fail(name, std::to_string(wakeups) + " wakeups in " + std::to_string(idle.count()) +
+                                  " ms, expected at most " + std::to_string(allowed));
+    }
+
+    // Discovery identifying count simulated devices that each take a while to answer, all at
+    // once the way probe_ports() does it, and one port after the other. The first should stay
+    // near one round trip as count grows, the second grows with it.
+    static void probe_case(Runner &runner, const std::string &name, int count, bool concurrent)
+    {
+        if (!runner.enabled(name))
+            return;
+
+        Sim::Options options;
+        options.baud = 0;
+        options.latencyMs = 20;
+        std::vector<ComPort::DeviceInfo> candidates;
+        for (int i = 0; i < count; ++i)
+            candidates.push_back({L"sim" + std::to_wstring(i), "", ComPort::Subject::MOUSE});
+
+        bool ok = true;
+        runner.run(name, 10, 1, 0, [&]
+                   {
+                       // A probed port is closed again, every round gets new devices
+                       std::atomic<bool> stop = false;
+                       std::vector<std::unique_ptr<ComPort::MemoryTransport>> clients, ends;
+                       std::vector<std::unique_ptr<Sim::FirmwareSim>> sims;
+                       std::vector<std::thread> firmware;
+                       for (int i = 0; i < count; ++i)
+                       {
+                           auto [client, device] = ComPort::MemoryTransport::pair();
+                           sims.push_back(std::make_unique<Sim::FirmwareSim>(*device, options));
+                           clients.push_back(std::move(client));
+                           ends.push_back(std::move(device));
+                       }
+                       for (int i = 0; i < count; ++i)
+                           firmware.emplace_back([&, i]
+                                                 { sims[i]->run(stop); });
+
+                       auto open = [&](const std::wstring &port) -> std::unique_ptr<ComPort::Transport>
+                       { return std::move(clients[std::stoi(port.substr(3))]); };
+                       size_t found = 0;
+                       if (concurrent)
+                       {
+                           found = ComPort::probe_ports(candidates, ComPort::probeTimeoutMs,
+                                                        [](const ComPort::DeviceInfo &, std::unique_ptr<ComPort::Transport>)
+                                                        { return true; }, open);
+                       }
+                       else
+                       {
+                           for (const ComPort::DeviceInfo &candidate : candidates)
+                           {
+                               std::unique_ptr<ComPort::Transport> transport = open(candidate.port);
+                               found += ComPort::identify(*transport, ComPort::probeTimeoutMs) == candidate.subject;
+                           }
+                       }
+                       ok &= found == static_cast<size_t>(count);
+
+                       stop = true;
+                       for (std::thread &thread : firmware)
+                           thread.join(); });
+        if (!ok)
+            runner.fail(name, "a device did not identify itself");
+    }
+
+    void poll_benchmarks(Runner &runner)
+    {
+        poll_case(runner, "poll/memory", 0);
+        poll_case(runner, "poll/memory_2k", 2000);
+        poll_case(runner, "poll/memory_binary", 0, ComPort::Protocol::BINARY);
+        manager_case(runner, "poll/manager_1", 1);
+        manager_case(runner, "poll/manager_64", 64);
+        subscribed_polled_case(runner, "poll/subscribed_polled_idle");
+        probe_case(runner, "poll/probe_8", 8, true);
+        probe_case(runner, "poll/probe_8_serial", 8, false);
+    }
+}
@@ -0,0 +1,80 @@
+// Firmware simulator on a pseudo terminal, point the client at the printed path:
+//   ./build/bin/mouse_sim --latency 5 --jitter 20 &
+//   ./build/bin/mouse_client --mouse-port /dev/pts/N
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "../src/include/firmware_sim.hpp"
+
+static std::atomic<bool> stopRequested(false);
+
+static void usage()
+{
+    std::cout << "Usage: mouse_sim [options]\n"
+                 "  --receiver            answer like the receiver instead of the mouse\n"
+                 "  --response-bytes N    pad the '1' report to about N bytes\n"
+                 "  --latency MS          delay before every response\n"
+                 "  --jitter MS           plus up to MS of random delay\n"
+                 "  --baud N              line rate to pace the output at, 0 = unthrottled (115200)\n"
+                 "  --motion-rate N       motion blocks per second for '2', 0 = line rate (500)\n"
+                 "  --text-only           ignore 'B' like firmware without the binary protocol\n"
+                 "  --no-subscribe        ignore 'S' like firmware that can only be polled\n"
+                 "  --clicks N            clicks per second while subscribed (2)\n"
+                 "  --seed N              random seed\n";
+}
+
+int main(int argc, char *argv[])
+{
+    Sim::Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        auto value = [&]()
+        { return i + 1 < argc ? std::atoi(argv[++i]) : 0; };
+
+        if (std::strcmp(argv[i], "--receiver") == 0)
+            options.personality = ComPort::Subject::RECEIVER;
+        else if (std::strcmp(argv[i], "--response-bytes") == 0)
+            options.responseBytes = static_cast<size_t>(value());
+        else if (std::strcmp(argv[i], "--latency") == 0)
+            options.latencyMs = value();
+        else if (std::strcmp(argv[i], "--jitter") == 0)
+            options.jitterMs = value();
+        else if (std::strcmp(argv[i], "--baud") == 0)
+            options.baud = value();
+        else if (std::strcmp(argv[i], "--motion-rate") == 0)
+            options.motionBlocksPerSecond = value();
+        else if (std::strcmp(argv[i], "--text-only") == 0)
+            options.binaryProtocol = false;
+        else if (std::strcmp(argv[i], "--no-subscribe") == 0)
+            options.subscribe = false;
+        else if (std::strcmp(argv[i], "--clicks") == 0)
+            options.clicksPerSecond = value();
+        else if (std::strcmp(argv[i], "--seed") == 0)
+            options.seed = static_cast<uint32_t>(value());
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    std::unique_ptr<ComPort::PtyTransport> pty = ComPort::PtyTransport::create();
+    if (!pty)
+        return 1;
+
+    std::signal(SIGINT, [](int)
+                { stopRequested = true; });
+    std::signal(SIGTERM, [](int)
+                { stopRequested = true; });
+
+    std::cout << "Simulated " << (options.personality == ComPort::Subject::MOUSE ? "MOUSE" : "RECEIVER")
+              << " on " << pty->slave_path() << std::endl;
+
+    Sim::FirmwareSim sim(*pty, options);
+    sim.run(stopRequested);
+
+    std::cout << "Answered " << sim.requests() << " status requests, sent " << sim.bytes_sent() << " bytes" << std::endl;
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <array>
+#include <bit>
+
+#include "include/binary_protocol.hpp"
+#include "include/response_parser.hpp"
+
+namespace ComPort
+{
+    static constexpr std::array<uint16_t, 256> crcTable = []
+    {
+        std::array<uint16_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint16_t crc = static_cast<uint16_t>(i << 8);
+            for (int bit = 0; bit < 8; ++bit)
+                crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+            table[i] = crc;
+        }
+        return table;
+    }();
+
+    uint16_t crc16(std::string_view bytes)
+    {
+        uint16_t crc = 0xFFFF;
+        for (char c : bytes)
+            crc = static_cast<uint16_t>((crc << 8) ^ crcTable[((crc >> 8) ^ static_cast<uint8_t>(c)) & 0xFF]);
+        return crc;
+    }
+
+    static uint32_t load(std::string_view bytes, size_t at, size_t size)
+    {
+        uint32_t value = 0;
+        for (size_t i = 0; i < size; ++i)
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[at + i])) << (8 * i);
+        return value;
+    }
+
+    static void store(std::string &out, uint32_t value, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+
+    // Header and CRC of a frame of the given type, payload still to be appended
+    static std::string begin_frame(uint8_t type, size_t payloadSize)
+    {
+        std::string frame;
+        frame.reserve(frameHeaderSize + payloadSize + frameTrailerSize);
+        frame.push_back(static_cast<char>(frameMagic0));
+        frame.push_back(static_cast<char>(frameMagic1));
+        frame.push_back(static_cast<char>(type));
+        store(frame, static_cast<uint32_t>(payloadSize), 2);
+        return frame;
+    }
+
+    static void end_frame(std::string &frame)
+    {
+        store(frame, crc16(std::string_view(frame).substr(2)), 2);
+    }
+
+    // Whole frame of this type with a good CRC
+    static bool check_frame(std::string_view frame, uint8_t type)
+    {
+        if (frame.size() < frameHeaderSize + frameTrailerSize || binary_frame_length(frame) != frame.size() ||
+            frame_type(frame) != type)
+            return false;
+        const size_t crcAt = frame.size() - frameTrailerSize;
+        return crc16(frame.substr(2, crcAt - 2)) == load(frame, crcAt, 2);
+    }
+
+    // The fields a CHANGE frame can carry, in payload order
+    static constexpr uint32_t changeFields[] = {
+        FIELD_LEFT_CLICKS, FIELD_RIGHT_CLICKS, FIELD_MIDDLE_CLICKS, FIELD_BACKWARD_CLICKS, FIELD_FORWARD_CLICKS,
+        FIELD_DOWNWARD_SCROLLS, FIELD_UPWARD_SCROLLS, FIELD_BATTERY, FIELD_CURRENT_DPI};
+
+    static uint32_t field_value(const MouseStatus &status, uint32_t field)
+    {
+        switch (field)
+        {
+        case FIELD_LEFT_CLICKS:
+            return static_cast<uint32_t>(status.left_clicks);
+        case FIELD_RIGHT_CLICKS:
+            return static_cast<uint32_t>(status.right_clicks);
+        case FIELD_MIDDLE_CLICKS:
+            return static_cast<uint32_t>(status.middle_clicks);
+        case FIELD_BACKWARD_CLICKS:
+            return static_cast<uint32_t>(status.backward_clicks);
+        case FIELD_FORWARD_CLICKS:
+            return static_cast<uint32_t>(status.forward_clicks);
+        case FIELD_DOWNWARD_SCROLLS:
+            return static_cast<uint32_t>(status.downward_scrolls);
+        case FIELD_UPWARD_SCROLLS:
+            return static_cast<uint32_t>(status.upward_scrolls);
+        case FIELD_BATTERY:
+            return static_cast<uint32_t>(status.battery_mv & 0xFFFF) | static_cast<uint32_t>(status.battery_percent & 0xFF) << 16;
+        case FIELD_CURRENT_DPI:
+            return static_cast<uint32_t>(status.current_dpi);
+        }
+        return 0;
+    }
+
+    static void set_field(MouseStatus &status, uint32_t field, uint32_t value)
+    {
+        switch (field)
+        {
+        case FIELD_LEFT_CLICKS:
+            status.left_clicks = value;
+            break;
+        case FIELD_RIGHT_CLICKS:
+            status.right_clicks = value;
+            break;
+        case FIELD_MIDDLE_CLICKS:
+            status.middle_clicks = value;
+            break;
+        case FIELD_BACKWARD_CLICKS:
+            status.backward_clicks = value;
+            break;
+        case FIELD_FORWARD_CLICKS:
+            status.forward_clicks = value;
+            break;
+        case FIELD_DOWNWARD_SCROLLS:
+            status.downward_scrolls = value;
+            break;
+        case FIELD_UPWARD_SCROLLS:
+            status.upward_scrolls = value;
+            break;
+        case FIELD_BATTERY:
+            status.battery_mv = static_cast<int>(value & 0xFFFF);
+            status.battery_percent = static_cast<int>((value >> 16) & 0xFF);
+            break;
+        case FIELD_CURRENT_DPI:
+            status.current_dpi = static_cast<int>(value);
+            break;
+        }
+    }
+
+    size_t binary_frame_length(std::string_view header)
+    {
+        if (static_cast<uint8_t>(header[0]) != frameMagic0 || static_cast<uint8_t>(header[1]) != frameMagic1)
+            return 0;
+        return frameHeaderSize + load(header, 3, 2) + frameTrailerSize;
+    }
+
+    std::string encode_status_frame(const MouseStatus &status, Subject subject)
+    {
+        std::string frame = begin_frame(FRAME_STATUS, statusPayloadSize);
+        store(frame, subject == Subject::MOUSE ? 1 : 2, 1);
+        store(frame, 0, 1);
+        store(frame, static_cast<uint32_t>(status.current_dpi), 2);
+        store(frame, static_cast<uint32_t>(status.battery_mv), 2);
+        store(frame, static_cast<uint32_t>(status.battery_percent), 1);
+        store(frame, 0, 1);
+        for (uint64_t counter : {status.left_clicks, status.right_clicks, status.middle_clicks,
+                                 status.backward_clicks, status.forward_clicks,
+                                 status.downward_scrolls, status.upward_scrolls})
+            store(frame, static_cast<uint32_t>(counter), 4);
+        end_frame(frame);
+        return frame;
+    }
+
+    uint32_t decode_status_frame(std::string_view frame, MouseStatus &status)
+    {
+        if (frame.size() != statusFrameSize || !check_frame(frame, FRAME_STATUS))
+            return FIELD_NONE;
+
+        const size_t p = frameHeaderSize;
+        const Subject subject = load(frame, p, 1) == 1 ? Subject::MOUSE : Subject::RECEIVER;
+        status.battery_mv = static_cast<int>(load(frame, p + 4, 2));
+        status.battery_percent = static_cast<int>(load(frame, p + 6, 1));
+        if (subject == Subject::RECEIVER)
+            return RECEIVER_FIELDS;
+
+        status.current_dpi = static_cast<int>(load(frame, p + 2, 2));
+        status.left_clicks = load(frame, p + 8, 4);
+        status.right_clicks = load(frame, p + 12, 4);
+        status.middle_clicks = load(frame, p + 16, 4);
+        status.backward_clicks = load(frame, p + 20, 4);
+        status.forward_clicks = load(frame, p + 24, 4);
+        status.downward_scrolls = load(frame, p + 28, 4);
+        status.upward_scrolls = load(frame, p + 32, 4);
+        return MOUSE_FIELDS;
+    }
+
+    std::string encode_change_frame(const MouseStatus &before, const MouseStatus &after, Subject subject)
+    {
+        const uint32_t fields = subject == Subject::MOUSE ? MOUSE_FIELDS : RECEIVER_FIELDS;
+        uint32_t changed = FIELD_NONE;
+        for (uint32_t field : changeFields)
+        {
+            if ((fields & field) && field_value(before, field) != field_value(after, field))
+                changed |= field;
+        }
+        if (changed == FIELD_NONE)
+            return {};
+
+        std::string frame = begin_frame(FRAME_CHANGE, 2 + 4 * std::popcount(changed));
+        store(frame, changed, 2);
+        for (uint32_t field : changeFields)
+        {
+            if (changed & field)
+                store(frame, field_value(after, field), 4);
+        }
+        end_frame(frame);
+        return frame;
+    }
+
+    uint32_t decode_change_frame(std::string_view frame, MouseStatus &status)
+    {
+        if (frame.size() < frameHeaderSize + 2 + frameTrailerSize || !check_frame(frame, FRAME_CHANGE))
+            return FIELD_NONE;
+
+        const uint32_t changed = load(frame, frameHeaderSize, 2);
+        if (changed == FIELD_NONE || (changed & ~MOUSE_FIELDS) ||
+            frame.size() != frameHeaderSize + 2 + 4 * std::popcount(changed) + frameTrailerSize)
+            return FIELD_NONE;
+
+        size_t at = frameHeaderSize + 2;
+        for (uint32_t field : changeFields)
+        {
+            if (changed & field)
+            {
+                set_field(status, field, load(frame, at, 4));
+                at += 4;
+            }
+        }
+        return changed;
+    }
+}
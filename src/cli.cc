@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "include/cli.hpp"
+#include "include/com_port.hpp"
+#include "include/live_publisher.hpp"
+#include "include/motion_analysis.hpp"
+#include "include/motion_capture.hpp"
+#include "include/motion_ingest.hpp"
+#include "include/motion_store.hpp"
+#include "include/rollup.hpp"
+#include "include/stats_store.hpp"
+
+namespace Cli
+{
+    // Room for about an hour of motion at the sensor rate before the columns have to grow
+    static constexpr size_t motionReserve = 1 << 18;
+    static constexpr int motionIdleTimeoutMs = 1000;
+
+    static std::atomic<bool> interrupted(false);
+
+    static void print_capture_summary(const Motion::Capture &capture, const Motion::Decoder &decoder,
+                                      double seconds, size_t bytes)
+    {
+        std::cout << "Samples:           " << capture.size() << "\n";
+        if (capture.size() > 0)
+        {
+            auto [minX, maxX] = std::minmax_element(capture.after_x.begin(), capture.after_x.end());
+            auto [minY, maxY] = std::minmax_element(capture.after_y.begin(), capture.after_y.end());
+            std::cout << "Blocks:            " << capture.block.front() << " - " << capture.block.back() << "\n";
+            std::cout << "After X range:     " << *minX << " .. " << *maxX << "\n";
+            std::cout << "After Y range:     " << *minY << " .. " << *maxY << "\n";
+        }
+        std::cout << "Incomplete blocks: " << decoder.incomplete_blocks() << "\n";
+        std::cout << "Malformed lines:   " << decoder.malformed_lines() << "\n";
+        std::cout << "Time:              " << seconds * 1000.0 << " ms";
+        if (seconds > 0)
+            std::cout << " (" << bytes / seconds / 1e6 << " MB/s, " << capture.size() / seconds << " samples/s)";
+        std::cout << std::endl;
+    }
+
+    static int capture_motion(const std::wstring &port, const std::string &outputPath)
+    {
+        std::wstring mousePort = port, receiverPort;
+        if (mousePort.empty() && !ComPort::detectDevices(mousePort, receiverPort))
+        {
+            std::cerr << "No device detected" << std::endl;
+            return 1;
+        }
+        if (mousePort.empty())
+        {
+            std::cerr << "Motion data is only available from the MOUSE" << std::endl;
+            return 1;
+        }
+
+        const bool columnar = outputPath.ends_with(".mcol");
+        Motion::ColumnWriter writer;
+        std::ofstream log;
+        bool opened;
+        if (columnar)
+        {
+            opened = writer.open(outputPath);
+        }
+        else
+        {
+            log.open(outputPath, std::ios::binary);
+            opened = static_cast<bool>(log);
+        }
+        if (!opened)
+        {
+            std::cerr << "Cannot write " << outputPath << std::endl;
+            return 1;
+        }
+
+        if (!ComPort::connect(ComPort::Subject::MOUSE, mousePort))
+            return 1;
+
+        Motion::Capture capture;
+        capture.reserve(motionReserve);
+        Motion::Decoder decoder(capture);
+        size_t bytes = 0;
+
+        // Samples also go to the live region as they are decoded
+        Live::Publisher live;
+        live.open();
+        size_t published = 0;
+        auto publishNew = [&]
+        {
+            for (; published < capture.size(); ++published)
+                live.publish(capture, published);
+        };
+
+        std::signal(SIGINT, [](int)
+                    { interrupted = true; });
+
+        std::cout << "Streaming motion data to " << outputPath << ", Ctrl+C to stop" << std::endl;
+        auto start = std::chrono::steady_clock::now();
+
+        auto onLine = [&](std::string_view line)
+        {
+            bytes += line.size() + 1;
+            decoder.feed_line(line);
+            publishNew();
+            if (columnar)
+                return;
+
+            // Same layout as the Python logger: no blank lines, an empty line before each block
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+                line.remove_suffix(1);
+            size_t first = line.find_first_not_of(" \r\t");
+            if (first == std::string_view::npos)
+                return;
+            if (line[first] == '[' && log.tellp() > 0)
+                log << '\n';
+            log << line << '\n';
+        };
+
+        bool ok = ComPort::stream_motion(onLine, motionIdleTimeoutMs, interrupted);
+        decoder.finish();
+        publishNew();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ComPort::disconnect();
+
+        if (columnar)
+        {
+            writer.append(capture);
+            if (!writer.close())
+            {
+                std::cerr << "Failed to write " << outputPath << std::endl;
+                ok = false;
+            }
+        }
+
+        if (!ok)
+            std::cerr << "Motion stream ended with an error" << std::endl;
+        print_capture_summary(capture, decoder, seconds, bytes);
+        return ok ? 0 : 1;
+    }
+
+    int motion_capture(const std::wstring &port, const std::string &outputPath)
+    {
+        int result = capture_motion(port, outputPath);
+#ifndef _WIN32
+        // Opening a port started the event loop, its thread must not outlive main()
+        ComPort::stopEventLoop();
+#endif
+        return result;
+    }
+
+    int motion_replay(const std::string &path)
+    {
+        Motion::Capture capture;
+        capture.reserve(motionReserve);
+        Motion::Decoder decoder(capture);
+
+        auto start = std::chrono::steady_clock::now();
+        if (Motion::is_columnar_file(path))
+        {
+            Motion::ColumnReader reader;
+            if (!reader.open(path) || !reader.read_all(capture))
+            {
+                std::cerr << "Cannot read " << path << std::endl;
+                return 1;
+            }
+        }
+        else if (!Motion::decode_file(path, decoder))
+        {
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        print_capture_summary(capture, decoder, seconds, static_cast<size_t>(in.tellg()));
+        return 0;
+    }
+
+    int motion_analyze(const std::string &path)
+    {
+        Motion::Capture capture;
+        capture.reserve(motionReserve);
+        auto start = std::chrono::steady_clock::now();
+        if (!Motion::read_capture(path, capture))
+            return 1;
+        auto decoded = std::chrono::steady_clock::now();
+        const Motion::Analysis analysis = Motion::analyze(capture);
+        auto end = std::chrono::steady_clock::now();
+
+        Motion::write_report(std::cout, analysis);
+        std::cerr << "Read in " << std::chrono::duration<double, std::milli>(decoded - start).count()
+                  << " ms, analyzed in " << std::chrono::duration<double, std::milli>(end - decoded).count()
+                  << " ms (" << Motion::vector_kernels() << ")" << std::endl;
+        return 0;
+    }
+
+    int motion_ingest(const std::string &archivePath, const std::vector<std::string> &inputs, unsigned threads)
+    {
+        std::vector<std::string> paths;
+        for (const std::string &input : inputs)
+        {
+            std::error_code ec;
+            if (!std::filesystem::is_directory(input, ec))
+            {
+                paths.push_back(input);
+                continue;
+            }
+            std::vector<std::string> found;
+            for (const auto &entry : std::filesystem::directory_iterator(input, ec))
+                if (entry.is_regular_file() && entry.path().extension() == ".txt")
+                    found.push_back(entry.path().string());
+            std::sort(found.begin(), found.end());
+            paths.insert(paths.end(), found.begin(), found.end());
+        }
+        if (paths.empty())
+        {
+            std::cerr << "No captures to ingest" << std::endl;
+            return 1;
+        }
+
+        Motion::IngestOptions options;
+        options.threads = threads;
+        Motion::IngestResult result;
+        auto start = std::chrono::steady_clock::now();
+        if (!Motion::ingest_captures(paths, archivePath, options, result))
+            return 1;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::ifstream out(archivePath, std::ios::binary | std::ios::ate);
+        std::cout << "Ingested " << result.files - result.failed << " of " << result.files << " captures, "
+                  << result.samples << " samples in " << seconds * 1000.0 << " ms";
+        if (seconds > 0)
+            std::cout << " (" << result.textBytes / seconds / 1e6 << " MB/s)";
+        std::cout << "\n"
+                  << result.textBytes << " -> " << out.tellg() << " bytes, " << result.parts << " parts, "
+                  << result.steals << " stolen\n"
+                  << "Incomplete blocks: " << result.incompleteBlocks << ", malformed lines: " << result.malformedLines
+                  << std::endl;
+        return result.failed ? 1 : 0;
+    }
+
+    int motion_convert(const std::string &textPath, const std::string &columnarPath)
+    {
+        auto start = std::chrono::steady_clock::now();
+        int64_t samples = Motion::convert_text_capture(textPath, columnarPath);
+        if (samples < 0)
+            return 1;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::ifstream in(textPath, std::ios::binary | std::ios::ate);
+        std::ifstream out(columnarPath, std::ios::binary | std::ios::ate);
+        std::cout << "Converted " << samples << " samples in " << seconds * 1000.0 << " ms: "
+                  << in.tellg() << " -> " << out.tellg() << " bytes" << std::endl;
+        return 0;
+    }
+
+    int export_stats(const std::string &storePath, const std::string &csvPath)
+    {
+        if (!std::filesystem::exists(storePath))
+        {
+            std::cerr << storePath << " does not exist" << std::endl;
+            return 1;
+        }
+
+        Stats::Store store;
+        if (!store.open(storePath))
+            return 1;
+        int64_t rows = Stats::export_csv(store, csvPath);
+        if (rows < 0)
+        {
+            std::cerr << "Cannot write " << csvPath << std::endl;
+            return 1;
+        }
+        std::cout << "Exported " << rows << " rows to " << csvPath << std::endl;
+        return 0;
+    }
+
+    int stats_rollup(const std::string &storePath, const std::string &resolution, int days)
+    {
+        Stats::Resolution r;
+        if (resolution == "minute")
+            r = Stats::RESOLUTION_MINUTE;
+        else if (resolution == "hour")
+            r = Stats::RESOLUTION_HOUR;
+        else if (resolution == "day")
+            r = Stats::RESOLUTION_DAY;
+        else
+        {
+            std::cerr << "Resolution must be minute, hour or day" << std::endl;
+            return 1;
+        }
+        if (!std::filesystem::exists(storePath))
+        {
+            std::cerr << storePath << " does not exist" << std::endl;
+            return 1;
+        }
+
+        Stats::Store store;
+        Stats::Rollups rollups;
+        if (!store.open(storePath) || !rollups.open(storePath, store))
+            return 1;
+        if (rollups.caught_up() > 1000)
+            std::cerr << "Rolled up " << rollups.caught_up() << " history records" << std::endl;
+
+        const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                                std::chrono::system_clock::now().time_since_epoch())
+                                .count();
+        auto start = std::chrono::steady_clock::now();
+        std::cout << "Start";
+        for (const char *name : Stats::counterNames)
+            std::cout << "," << name;
+        std::cout << "\n";
+
+        Stats::Counts total{};
+        uint64_t buckets = 0;
+        bool ok = rollups.scan(r, now - int64_t(days) * 86400, now, [&](const Stats::Bucket &bucket)
+                               {
+                                   std::cout << Stats::format_time(bucket.start);
+                                   for (size_t i = 0; i < Stats::counterCount; ++i)
+                                   {
+                                       std::cout << "," << bucket.counts[i];
+                                       total[i] += bucket.counts[i];
+                                   }
+                                   std::cout << "\n";
+                                   ++buckets; });
+        std::cout << "Total";
+        for (uint64_t count : total)
+            std::cout << "," << count;
+        std::cout << std::endl;
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << buckets << " " << resolution << " buckets in " << ms << " ms" << std::endl;
+        if (!ok)
+            std::cerr << "Could not read the rollups of " << storePath << std::endl;
+        return ok ? 0 : 1;
+    }
+}
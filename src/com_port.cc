@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include "include/com_port.hpp"
+#include "include/device_protocol.hpp"
+#include "include/transport.hpp"
+
+// Connection state shared by both platforms, the platform files provide detectAllDevices()
+// and open_serial_transport()
+namespace ComPort
+{
+    bool (*read_data_X)(MouseStatus &status) = nullptr;
+    Subject connectedTo = Subject::NONE;
+
+    // The reader thread polls while the monitor thread may reconnect, the transport and its
+    // frame reader are only touched with this held
+    static std::mutex transportMutex;
+    static std::unique_ptr<Transport> transport;
+    static FrameReader rx("\n");
+
+    std::string device_name(const DeviceInfo &info)
+    {
+        if (!info.serial.empty())
+            return info.serial;
+        std::string port(info.port.begin(), info.port.end());
+        return port.substr(port.find_last_of("/\\") + 1);
+    }
+
+    // The ports detectDevices() found, still open from the handshake, until the next connect()
+    static std::mutex identifiedMutex;
+    static std::map<std::wstring, std::unique_ptr<Transport>> identified;
+
+    bool detectDevices(std::wstring &mouseComPort, std::wstring &receiverComPort)
+    {
+        mouseComPort.clear();
+        receiverComPort.clear();
+
+        std::vector<DeviceInfo> devices;
+        detectAllDevices(devices);
+
+        // Done as soon as there is one of each kind that is attached, the slower ports give up then
+        auto attached = [&](Subject subject)
+        {
+            return std::any_of(devices.begin(), devices.end(), [&](const DeviceInfo &device)
+                               { return device.subject == subject; });
+        };
+        const bool wantMouse = attached(Subject::MOUSE), wantReceiver = attached(Subject::RECEIVER);
+
+        std::lock_guard<std::mutex> lock(identifiedMutex);
+        identified.clear();
+        probe_ports(devices, probeTimeoutMs, [&](const DeviceInfo &device, std::unique_ptr<Transport> transport)
+                    {
+                        std::wstring &port = (device.subject == Subject::MOUSE) ? mouseComPort : receiverComPort;
+                        if (port.empty())
+                        {
+                            port = device.port;
+                            identified[device.port] = std::move(transport);
+                        }
+                        return (wantMouse && mouseComPort.empty()) || (wantReceiver && receiverComPort.empty()); });
+        return !mouseComPort.empty() || !receiverComPort.empty();
+    }
+
+    bool connect(Subject targetSubject, std::wstring targetComPort)
+    {
+        if (targetComPort.empty())
+        {
+            std::cerr << "No COM port found for "
+                      << (targetSubject == Subject::MOUSE ? "MOUSE" : "RECEIVER")
+                      << std::endl;
+            return false;
+        }
+
+        // A port detectDevices() just identified is used as it is, without opening it again.
+        // The other one is closed, so it is not held open for nobody.
+        std::unique_ptr<Transport> serial;
+        {
+            std::lock_guard<std::mutex> lock(identifiedMutex);
+            if (auto it = identified.find(targetComPort); it != identified.end())
+                serial = std::move(it->second);
+            identified.clear();
+        }
+        if (!serial)
+            serial = open_serial_transport(targetComPort);
+        if (!serial)
+            return false;
+
+        std::cout << "Connected to " << serial->name() << std::endl;
+        return attach(targetSubject, std::move(serial));
+    }
+
+    bool attach(Subject targetSubject, std::unique_ptr<Transport> newTransport)
+    {
+        if (!newTransport)
+            return false;
+
+        std::lock_guard<std::mutex> lock(transportMutex);
+        transport = std::move(newTransport);
+        rx.reset();
+        connectedTo = targetSubject;
+        read_data_X = (connectedTo == Subject::MOUSE) ? read_data_mouse : read_data_receiver;
+        return true;
+    }
+
+    void disconnect()
+    {
+        std::lock_guard<std::mutex> lock(transportMutex);
+        transport.reset();
+        rx.reset();
+        connectedTo = Subject::NONE;
+        read_data_X = nullptr;
+    }
+
+    static bool read_data(Subject subject, MouseStatus &status)
+    {
+        std::lock_guard<std::mutex> lock(transportMutex);
+        if (!transport)
+        {
+            std::cout << "Failed to talk to " << (subject == Subject::MOUSE ? "mouse" : "receiver") << std::endl;
+            return false;
+        }
+        return query_status(*transport, rx, subject, status);
+    }
+
+    bool read_data_receiver(MouseStatus &status)
+    {
+        return read_data(Subject::RECEIVER, status);
+    }
+
+    bool read_data_mouse(MouseStatus &status)
+    {
+        return read_data(Subject::MOUSE, status);
+    }
+
+    bool stream_motion(const std::function<void(std::string_view)> &onLine, int idleTimeoutMs,
+                       const std::atomic<bool> &stop)
+    {
+        std::lock_guard<std::mutex> lock(transportMutex);
+        if (!transport)
+            return false;
+        return stream_motion(*transport, rx, onLine, idleTimeoutMs, stop);
+    }
+
+    void print_status(MouseStatus &status)
+    {
+        std::cout << "==================== Mouse Status ====================\n";
+        std::cout << "Firmware build date: " << status.firmware_build_date << "\n";
+        std::cout << "Left clicks:        " << status.left_clicks << "\n";
+        std::cout << "Right clicks:       " << status.right_clicks << "\n";
+        std::cout << "Middle clicks:      " << status.middle_clicks << "\n";
+        std::cout << "Backward clicks:    " << status.backward_clicks << "\n";
+        std::cout << "Forward clicks:     " << status.forward_clicks << "\n";
+        std::cout << "Downward scrolls:   " << status.downward_scrolls << "\n";
+        std::cout << "Upward scrolls:     " << status.upward_scrolls << "\n";
+        std::cout << "Battery level:      " << status.battery_mv << "mV = " << status.battery_percent << "%\n";
+        std::cout << "Current DPI:        " << status.current_dpi << "\n";
+        std::cout << "======================================================\n";
+    }
+}
@@ -0,0 +1,836 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <dbt.h>
+#include <condition_variable>
+#else
+#include <csignal>
+#include <pthread.h>
+#endif
+
+#include "include/daemon.hpp"
+#include "include/device_manager.hpp"
+#include "include/device_protocol.hpp"
+#include "include/http_exporter.hpp"
+#include "include/live_publisher.hpp"
+#include "include/metrics.hpp"
+#include "include/rollup.hpp"
+#include "include/scheduler.hpp"
+
+namespace Daemon
+{
+    // -------------------- Globals --------------------
+    static constexpr std::chrono::milliseconds pollPeriod(2000);
+    static constexpr std::chrono::milliseconds reconnectDelay(2000);
+
+    static Options options;
+    static OnReading onReading;
+    static Scheduler scheduler;
+    static std::unique_ptr<ComPort::DeviceManager> deviceManager;
+    static std::thread monitorThread;
+    static bool running = false;
+
+    // Every device is polled, one is shown: the first mouse, else the first receiver
+    static std::mutex primaryMutex;
+    static ComPort::DeviceInfo primary;
+
+    // History of the shown mouse, written on the manager thread
+    static Stats::Store statsStore;
+    static std::string statsStorePath, statsSnapshotPath;
+    // Its rollups, also read by scrapes and the history chart
+    static std::mutex rollupsMutex;
+    static Stats::Rollups rollups;
+
+    // Devices that answered in earlier runs, newest first, tried before the first scan. With
+    // the protocol each one spoke, so firmware without 'S' and 'B' is not offered them again.
+    struct KnownPort
+    {
+        ComPort::DeviceInfo info;
+        std::optional<ComPort::Protocol> protocol;
+    };
+    static constexpr size_t knownPortsKept = 4;
+    // A known port that is there but silent must not hold up the first real scan for long
+    static constexpr int knownPortTimeoutMs = 150;
+    static std::string knownPortsPath;
+    static std::mutex knownPortsMutex;
+    static std::vector<KnownPort> knownPorts;
+
+    // Every reading of every device, for other local processes
+    static Live::Publisher livePublisher;
+
+    // Latest reading of every device for scrapes, which copy it and never wait on a poll
+    struct DeviceState
+    {
+        ComPort::DeviceInfo info;
+        ComPort::Reading reading;
+        bool connected = false;
+    };
+    static std::mutex devicesMutex;
+    static std::map<std::wstring, DeviceState> devices;
+    static Metrics::HttpExporter metricsExporter;
+
+#ifdef _WIN32
+    static HWND comNotifyHwnd = nullptr;
+    static std::thread comNotifyThread;
+#endif
+
+    // -------------------- Functions --------------------
+    static std::string narrow(const std::wstring &s)
+    {
+        return std::string(s.begin(), s.end());
+    }
+
+    static void onComPortEvent()
+    {
+        std::cout << "Something com port happened" << std::endl;
+        scheduler.post(Scheduler::EVENT_HOTPLUG);
+    }
+
+    static void show(const ComPort::Reading &reading)
+    {
+        if (onReading)
+            onReading(reading);
+    }
+
+    static void persist(const ComPort::Reading &reading)
+    {
+        if (!statsStore.is_open())
+            return;
+
+        const uint64_t persistStart = Metrics::now_ns();
+        ComPort::MouseStatus status = ComPort::to_status(reading);
+        const Stats::Record record = Stats::from_status(status, reading.time);
+        // The rollups only see what the history holds, they are rebuilt from it
+        if (!statsStore.append(record))
+            std::cerr << "Failed to write stats file: " << statsStorePath << std::endl;
+        else
+        {
+            std::lock_guard<std::mutex> lock(rollupsMutex);
+            if (rollups.is_open() && !rollups.add(record))
+                std::cerr << "Failed to write the rollups of " << statsStorePath << std::endl;
+        }
+        Stats::write_snapshot(statsSnapshotPath, Stats::snapshot_from_status(status, reading.time));
+        Metrics::record(Metrics::STAGE_PERSIST, persistStart, Metrics::now_ns());
+    }
+
+    // Manager thread
+    static void onDeviceReading(const ComPort::DeviceInfo &info, const ComPort::Reading &reading)
+    {
+        livePublisher.publish(info, reading);
+        {
+            std::lock_guard<std::mutex> lock(devicesMutex);
+            devices[info.port] = {info, reading, true};
+        }
+        {
+            std::lock_guard<std::mutex> lock(primaryMutex);
+            bool better = primary.port.empty() ||
+                          (primary.subject == ComPort::Subject::RECEIVER && info.subject == ComPort::Subject::MOUSE);
+            if (better && primary.port != info.port)
+            {
+                primary = info;
+                std::cout << "Showing " << (info.subject == ComPort::Subject::MOUSE ? "MOUSE" : "RECEIVER")
+                          << " on " << narrow(info.port) << std::endl;
+            }
+            if (info.port != primary.port)
+                return;
+        }
+        Metrics::startup_mark(Metrics::MILESTONE_FIRST_READING);
+        show(reading);
+        if (reading.subject == ComPort::Subject::MOUSE && reading.persist)
+            persist(reading);
+    }
+
+    // The window goes gray if it was showing this device, the next reading of another one takes over
+    static void forgetDevice(const std::wstring &port)
+    {
+        {
+            std::lock_guard<std::mutex> lock(devicesMutex);
+            if (auto it = devices.find(port); it != devices.end())
+                it->second.connected = false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(primaryMutex);
+            if (primary.port != port)
+                return;
+            primary = {};
+        }
+        show(ComPort::Reading{});
+    }
+
+    // Manager thread
+    static void onDeviceLost(const ComPort::DeviceInfo &info)
+    {
+        std::cout << "Could not read " << narrow(info.port) << ", disconnecting" << std::endl;
+        forgetDevice(info.port);
+        Metrics::count(Metrics::COUNTER_RECONNECTS);
+        scheduler.post(Scheduler::EVENT_RECONNECT);
+    }
+
+    // -------------------- Known ports --------------------
+    // mouse_ports.last holds one "MOUSE|RECEIVER <port> binary|text|- [serial]" line per device
+    static void loadKnownPorts()
+    {
+        std::lock_guard<std::mutex> lock(knownPortsMutex);
+        knownPorts.clear();
+        std::ifstream in(knownPortsPath);
+        std::string line;
+        while (std::getline(in, line) && knownPorts.size() < knownPortsKept)
+        {
+            std::istringstream fields(line);
+            std::string subject, port, protocol, serial;
+            if (!(fields >> subject >> port >> protocol) || (subject != "MOUSE" && subject != "RECEIVER"))
+                continue;
+            fields >> serial;
+            KnownPort known;
+            known.info = {std::wstring(port.begin(), port.end()), serial,
+                          subject == "MOUSE" ? ComPort::Subject::MOUSE : ComPort::Subject::RECEIVER};
+            if (protocol == "binary")
+                known.protocol = ComPort::Protocol::BINARY;
+            else if (protocol == "text")
+                known.protocol = ComPort::Protocol::TEXT;
+            knownPorts.push_back(std::move(known));
+        }
+    }
+
+    // By serial number when both have one, the port stands in for it otherwise
+    static bool sameDevice(const ComPort::DeviceInfo &a, const ComPort::DeviceInfo &b)
+    {
+        if (a.subject != b.subject)
+            return false;
+        return !a.serial.empty() && !b.serial.empty() ? a.serial == b.serial : a.port == b.port;
+    }
+
+    // Moves info to the front. A protocol of nullopt keeps the one known for the device.
+    static void rememberPort(const ComPort::DeviceInfo &info, std::optional<ComPort::Protocol> protocol = std::nullopt)
+    {
+        std::lock_guard<std::mutex> lock(knownPortsMutex);
+        if (knownPortsPath.empty())
+            return;
+        for (const KnownPort &known : knownPorts)
+            if (!protocol && sameDevice(known.info, info))
+                protocol = known.protocol;
+        std::erase_if(knownPorts, [&](const KnownPort &known)
+                      { return known.info.port == info.port || sameDevice(known.info, info); });
+        knownPorts.insert(knownPorts.begin(), {info, protocol});
+        if (knownPorts.size() > knownPortsKept)
+            knownPorts.resize(knownPortsKept);
+
+        std::ofstream out(knownPortsPath, std::ios::trunc);
+        for (const KnownPort &known : knownPorts)
+            out << (known.info.subject == ComPort::Subject::MOUSE ? "MOUSE " : "RECEIVER ") << narrow(known.info.port)
+                << (!known.protocol                                 ? " -"
+                    : *known.protocol == ComPort::Protocol::BINARY ? " binary"
+                                                                    : " text")
+                << (known.info.serial.empty() ? "" : " ") << known.info.serial << "\n";
+        if (!out.good())
+            std::cerr << "Failed to write " << knownPortsPath << std::endl;
+    }
+
+    static std::optional<ComPort::Protocol> knownProtocol(const ComPort::DeviceInfo &info)
+    {
+        std::lock_guard<std::mutex> lock(knownPortsMutex);
+        for (const KnownPort &known : knownPorts)
+            if (sameDevice(known.info, info))
+                return known.protocol;
+        return std::nullopt;
+    }
+
+    // Manager thread, when a device first answered 'B' or was found not to know it
+    static void onDeviceNegotiated(const ComPort::DeviceInfo &info, ComPort::Protocol protocol)
+    {
+        if (knownProtocol(info) != protocol)
+            rememberPort(info, protocol);
+    }
+
+    static void adoptDevice(const ComPort::DeviceInfo &info, std::unique_ptr<ComPort::Transport> transport)
+    {
+        std::cout << "Connected to " << transport->name() << std::endl;
+        deviceManager->add(info, std::move(transport), knownProtocol(info));
+    }
+
+    // Before the first scan, which on Windows alone can take longer than a poll: the ports that
+    // answered last time are the likely ones and need no enumeration to be probed.
+    //
+    // Port numbers can change between boots, and '1' must not go to whatever took a port over,
+    // so only ports whose USB ids still say they are the remembered device are probed. The rest
+    // is left to the scan. probe_ports() also drops a port that answers as the other subject.
+    // Two mice cannot be told apart by their answer, so a subject seen with more than one serial
+    // number is left to the scan as well.
+    static void reconnectKnownPorts()
+    {
+        std::vector<ComPort::DeviceInfo> candidates;
+        {
+            std::lock_guard<std::mutex> lock(knownPortsMutex);
+            for (const KnownPort &known : knownPorts)
+            {
+                bool ambiguous = std::any_of(knownPorts.begin(), knownPorts.end(), [&](const KnownPort &other)
+                                             { return other.info.subject == known.info.subject &&
+                                                      other.info.serial != known.info.serial; });
+                if (!ambiguous && ComPort::portMatches(known.info))
+                    candidates.push_back(known.info);
+            }
+        }
+        if (candidates.empty())
+            return;
+        ComPort::probe_ports(candidates, knownPortTimeoutMs,
+                             [](const ComPort::DeviceInfo &info, std::unique_ptr<ComPort::Transport> transport)
+                             {
+                                 Metrics::startup_mark(Metrics::MILESTONE_KNOWN_PORT);
+                                 adoptDevice(info, std::move(transport));
+                                 return true; });
+    }
+
+    // Opens the devices that appeared and drops the ones that are gone, returns how many are managed
+    static size_t syncDevices()
+    {
+        std::vector<ComPort::DeviceInfo> wanted;
+        if (!options.mousePort.empty() || !options.receiverPort.empty())
+        {
+            if (!options.mousePort.empty())
+                wanted.push_back({options.mousePort, "", ComPort::Subject::MOUSE});
+            if (!options.receiverPort.empty())
+                wanted.push_back({options.receiverPort, "", ComPort::Subject::RECEIVER});
+        }
+        else
+        {
+            ComPort::detectAllDevices(wanted);
+        }
+
+        std::set<std::wstring> managed = deviceManager->ports();
+        for (const std::wstring &port : managed)
+        {
+            bool stillThere = std::any_of(wanted.begin(), wanted.end(), [&](const ComPort::DeviceInfo &info)
+                                          { return info.port == port; });
+            if (!stillThere)
+            {
+                std::cout << narrow(port) << " went away" << std::endl;
+                deviceManager->remove(port);
+                forgetDevice(port);
+            }
+        }
+
+        size_t count = 0;
+        std::vector<ComPort::DeviceInfo> candidates;
+        for (const ComPort::DeviceInfo &info : wanted)
+        {
+            if (managed.count(info.port))
+            {
+                ++count;
+                continue;
+            }
+            std::cout << (info.subject == ComPort::Subject::MOUSE ? "MOUSE" : "RECEIVER") << " detected on "
+                      << narrow(info.port) << ", attempting to connect" << std::endl;
+            candidates.push_back(info);
+        }
+
+        if (!options.mousePort.empty() || !options.receiverPort.empty())
+        {
+            // Ports given on the command line are taken as they are, answering or not
+            for (const ComPort::DeviceInfo &info : candidates)
+            {
+                std::unique_ptr<ComPort::Transport> transport = ComPort::open_serial_transport(info.port);
+                if (!transport)
+                    continue;
+                adoptDevice(info, std::move(transport));
+                ++count;
+            }
+        }
+        else
+        {
+            // Detected ones are identified all at once, each is polled as soon as it answered
+            count += ComPort::probe_ports(candidates, ComPort::probeTimeoutMs,
+                                          [](const ComPort::DeviceInfo &info, std::unique_ptr<ComPort::Transport> transport)
+                                          {
+                                              rememberPort(info);
+                                              adoptDevice(info, std::move(transport));
+                                              return true; });
+        }
+        return count;
+    }
+
+    // -------------------- Metrics endpoint --------------------
+    // Label values may hold anything a USB serial number can
+    static std::string label(const std::string &value)
+    {
+        std::string escaped;
+        for (char c : value)
+        {
+            if (c == '\\' || c == '"')
+                escaped += '\\';
+            if (c == '\n')
+                escaped += "\\n";
+            else
+                escaped += c;
+        }
+        return escaped;
+    }
+
+    static void writeMetrics(std::ostream &out)
+    {
+        struct Device
+        {
+            std::string name;
+            bool mouse;
+            bool connected;
+            ComPort::Reading reading;
+        };
+        std::vector<Device> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(devicesMutex);
+            for (const auto &[port, state] : devices)
+                snapshot.push_back({label(ComPort::device_name(state.info)),
+                                    state.info.subject == ComPort::Subject::MOUSE, state.connected, state.reading});
+        }
+
+        char line[256];
+        auto family = [&](const char *name, const char *type, const char *help)
+        {
+            out << "# TYPE " << name << " " << type << "\n# HELP " << name << " " << help << "\n";
+        };
+        auto sample = [&](const char *name, const Device &device, const char *extra, long long value)
+        {
+            std::snprintf(line, sizeof(line), "%s{device=\"%s\"%s} %lld\n", name, device.name.c_str(), extra, value);
+            out << line;
+        };
+
+        family("mouse_connected", "gauge", "1 while the device answers polls.");
+        for (const Device &d : snapshot)
+            sample("mouse_connected", d, d.mouse ? ",subject=\"mouse\"" : ",subject=\"receiver\"", d.connected);
+
+        family("mouse_clicks", "counter", "Button presses counted by the mouse.");
+        for (const Device &d : snapshot)
+        {
+            if (!d.mouse)
+                continue;
+            sample("mouse_clicks_total", d, ",button=\"left\"", d.reading.left_clicks);
+            sample("mouse_clicks_total", d, ",button=\"right\"", d.reading.right_clicks);
+            sample("mouse_clicks_total", d, ",button=\"middle\"", d.reading.middle_clicks);
+            sample("mouse_clicks_total", d, ",button=\"backward\"", d.reading.backward_clicks);
+            sample("mouse_clicks_total", d, ",button=\"forward\"", d.reading.forward_clicks);
+        }
+
+        family("mouse_scrolls", "counter", "Wheel steps counted by the mouse.");
+        for (const Device &d : snapshot)
+        {
+            if (!d.mouse)
+                continue;
+            sample("mouse_scrolls_total", d, ",direction=\"down\"", d.reading.downward_scrolls);
+            sample("mouse_scrolls_total", d, ",direction=\"up\"", d.reading.upward_scrolls);
+        }
+
+        family("mouse_dpi", "gauge", "Current DPI setting.");
+        for (const Device &d : snapshot)
+        {
+            if (d.mouse)
+                sample("mouse_dpi", d, "", d.reading.current_dpi);
+        }
+
+        family("mouse_battery_millivolts", "gauge", "Battery voltage.");
+        for (const Device &d : snapshot)
+            sample("mouse_battery_millivolts", d, "", d.reading.battery_mv);
+
+        family("mouse_battery_percent", "gauge", "Battery charge.");
+        for (const Device &d : snapshot)
+            sample("mouse_battery_percent", d, "", d.reading.battery_percent);
+
+        family("mouse_last_reading_timestamp_seconds", "gauge", "Unix time of the latest reading.");
+        for (const Device &d : snapshot)
+            sample("mouse_last_reading_timestamp_seconds", d, "", d.reading.time);
+
+        // Trailing windows of the shown mouse from the rollup engine
+        Stats::Counts lastMinute{}, lastHour{};
+        {
+            std::lock_guard<std::mutex> lock(rollupsMutex);
+            if (rollups.is_open())
+            {
+                const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                                        std::chrono::system_clock::now().time_since_epoch())
+                                        .count();
+                lastMinute = rollups.last_minute(now);
+                lastHour = rollups.last_hour(now);
+            }
+        }
+        static const char *recentLabels[Stats::counterCount] = {
+            "button=\"left\"", "button=\"right\"", "button=\"middle\"", "button=\"backward\"",
+            "button=\"forward\"", "direction=\"down\"", "direction=\"up\""};
+        auto recent = [&](const char *name, size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; ++i)
+            {
+                for (auto [window, counts] : {std::pair{"1m", &lastMinute}, std::pair{"1h", &lastHour}})
+                {
+                    std::snprintf(line, sizeof(line), "%s{window=\"%s\",%s} %llu\n", name, window, recentLabels[i],
+                                  static_cast<unsigned long long>((*counts)[i]));
+                    out << line;
+                }
+            }
+        };
+        family("mouse_recent_clicks", "gauge", "Clicks of the shown mouse in the last minute or hour.");
+        recent("mouse_recent_clicks", 0, 5);
+        family("mouse_recent_scrolls", "gauge", "Wheel steps of the shown mouse in the last minute or hour.");
+        recent("mouse_recent_scrolls", 5, Stats::counterCount);
+
+        Metrics::write_openmetrics(out);
+        out << "# EOF\n";
+    }
+
+    // -------------------- Device monitoring thread --------------------
+    static void deviceMonitoringThread()
+    {
+        if (options.mousePort.empty() && options.receiverPort.empty())
+            reconnectKnownPorts();
+
+        while (true)
+        {
+            uint32_t events = scheduler.wait(Scheduler::EVENT_HOTPLUG | Scheduler::EVENT_RECONNECT);
+            if (!events)
+                break; // Quit
+
+            Scheduler::Event cause = (events & Scheduler::EVENT_HOTPLUG) ? Scheduler::EVENT_HOTPLUG : Scheduler::EVENT_RECONNECT;
+            if (cause == Scheduler::EVENT_RECONNECT)
+            {
+                // Give a device that just stopped answering a moment, a hotplug cuts this short
+                if (scheduler.wait_for(Scheduler::EVENT_HOTPLUG, reconnectDelay))
+                    cause = Scheduler::EVENT_HOTPLUG;
+                if (scheduler.stopped())
+                    break;
+            }
+
+            size_t count = syncDevices();
+            if (count == 0)
+            {
+                std::cout << "Could not detect any device" << std::endl;
+                show(ComPort::Reading{});
+                continue;
+            }
+
+            auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(Scheduler::Clock::now() - scheduler.posted_at(cause));
+            std::cout << count << " device(s) connected " << latency.count() << " ms after the "
+                      << (cause == Scheduler::EVENT_HOTPLUG ? "hotplug event" : "reconnect request") << std::endl;
+        }
+    }
+
+    // -------------------- COM port notification thread --------------------
+#ifdef _WIN32
+    static void comPortNotificationThread()
+    {
+        const wchar_t CLASS_NAME[] = L"ComPortNotifyWindow";
+        HINSTANCE hInstance = GetModuleHandle(nullptr);
+
+        WNDCLASS wc{};
+        wc.lpfnWndProc = [](HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) -> LRESULT
+        {
+            switch (uMsg)
+            {
+            case WM_DEVICECHANGE:
+                if (wParam == DBT_DEVICEARRIVAL || wParam == DBT_DEVICEREMOVECOMPLETE)
+                {
+                    PDEV_BROADCAST_HDR pHdr = (PDEV_BROADCAST_HDR)lParam;
+                    if (pHdr && pHdr->dbch_devicetype == DBT_DEVTYP_DEVICEINTERFACE)
+                        onComPortEvent();
+                }
+                break;
+
+            case WM_DESTROY:
+                PostQuitMessage(0);
+                return 0;
+            }
+
+            return DefWindowProc(hwnd, uMsg, wParam, lParam);
+        };
+
+        wc.hInstance = hInstance;
+        wc.lpszClassName = CLASS_NAME;
+
+        if (!RegisterClass(&wc))
+        {
+            std::cerr << "Failed to register window class" << std::endl;
+            return;
+        }
+
+        HWND hwnd = CreateWindowEx(
+            0, CLASS_NAME, L"COM Port Notification Window",
+            0, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT,
+            nullptr, nullptr, hInstance, nullptr);
+
+        comNotifyHwnd = hwnd;
+
+        if (!hwnd)
+        {
+            std::cerr << "Failed to create window" << std::endl;
+            return;
+        }
+
+        DEV_BROADCAST_DEVICEINTERFACE NotificationFilter{};
+        NotificationFilter.dbcc_size = sizeof(DEV_BROADCAST_DEVICEINTERFACE);
+        NotificationFilter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+        NotificationFilter.dbcc_classguid = GUID_DEVINTERFACE_COMPORT;
+
+        HDEVNOTIFY hDevNotify = RegisterDeviceNotification(
+            hwnd, &NotificationFilter, DEVICE_NOTIFY_WINDOW_HANDLE);
+
+        if (!hDevNotify)
+        {
+            std::cerr << "Failed to register device notification" << std::endl;
+            return;
+        }
+
+        MSG msg{};
+        while (GetMessage(&msg, nullptr, 0, 0))
+        {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+
+        UnregisterDeviceNotification(hDevNotify);
+    }
+#endif
+
+    // -------------------- Public interface --------------------
+    bool parse_option(int argc, char *argv[], int &i, Options &options)
+    {
+        if (std::strcmp(argv[i], "--mouse-port") == 0 && i + 1 < argc)
+        {
+            std::string port(argv[++i]);
+            options.mousePort = std::wstring(port.begin(), port.end());
+        }
+        else if (std::strcmp(argv[i], "--receiver-port") == 0 && i + 1 < argc)
+        {
+            std::string port(argv[++i]);
+            options.receiverPort = std::wstring(port.begin(), port.end());
+        }
+        else if (std::strcmp(argv[i], "--history-dir") == 0 && i + 1 < argc)
+        {
+            options.historyDir = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--stats-dir") == 0 && i + 1 < argc)
+        {
+            options.statsDir = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--text-protocol") == 0)
+        {
+            options.binaryProtocol = false;
+        }
+        else if (std::strcmp(argv[i], "--no-subscribe") == 0)
+        {
+            options.subscribe = false;
+        }
+        else if (std::strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc)
+        {
+            options.metricsPort = static_cast<uint16_t>(std::atoi(argv[++i]));
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    std::string executable_dir()
+    {
+#ifdef _WIN32
+        wchar_t path[MAX_PATH];
+        DWORD n = GetModuleFileNameW(nullptr, path, MAX_PATH);
+        if (n == 0 || n == MAX_PATH)
+            return ".";
+        return std::filesystem::path(path).parent_path().string();
+#else
+        std::error_code ec;
+        std::filesystem::path path = std::filesystem::read_symlink("/proc/self/exe", ec);
+        if (ec)
+            return ".";
+        return path.parent_path().string();
+#endif
+    }
+
+    bool open_stats(const Options &options)
+    {
+        std::filesystem::path dir = options.statsDir.empty() ? executable_dir() : options.statsDir;
+        statsStorePath = (dir / "mouse_stats.bin").string();
+        statsSnapshotPath = (dir / "mouse_stats.last").string();
+        knownPortsPath = (dir / "mouse_ports.last").string();
+        loadKnownPorts();
+        const std::string csvPath = (dir / "mouse_stats.txt").string();
+
+        if (!statsStore.open(statsStorePath))
+        {
+            std::cerr << "Failed to open stats file: " << statsStorePath << std::endl;
+            return false;
+        }
+
+        // mouse_stats.txt from older versions is imported once and left in place
+        std::error_code ec;
+        if (statsStore.empty() && std::filesystem::exists(csvPath, ec))
+        {
+            int64_t rows = Stats::import_csv(csvPath, statsStore);
+            std::cout << "Imported " << rows << " rows from " << csvPath << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(rollupsMutex);
+        auto start = std::chrono::steady_clock::now();
+        if (!rollups.open(statsStorePath, statsStore))
+            std::cerr << "Failed to open the rollups of " << statsStorePath << std::endl;
+        else if (rollups.caught_up() > 1000)
+            std::cout << "Rolled up " << rollups.caught_up() << " history records in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                      << " ms" << std::endl;
+        return true;
+    }
+
+    // The snapshot if there is one, else the newest history record (no DPI or battery)
+    bool last_reading(Stats::Snapshot &snapshot)
+    {
+        if (!statsSnapshotPath.empty() && Stats::read_snapshot(statsSnapshotPath, snapshot))
+            return true;
+        if (statsStore.empty())
+            return false;
+        snapshot = {};
+        snapshot.time = statsStore.latest().time;
+        snapshot.counters = statsStore.latest().counters;
+        return true;
+    }
+
+    bool scan_history(Stats::Resolution resolution, int64_t from, int64_t to,
+                      const std::function<void(const Stats::Bucket &)> &onBucket)
+    {
+        std::lock_guard<std::mutex> lock(rollupsMutex);
+        return rollups.is_open() && rollups.scan(resolution, from, to, onBucket);
+    }
+
+    void start(const Options &daemonOptions, OnReading readingCallback)
+    {
+        if (running)
+            return;
+        options = daemonOptions;
+        onReading = std::move(readingCallback);
+        running = true;
+        livePublisher.open();
+        if (options.metricsPort)
+            metricsExporter.start(options.metricsPort, writeMetrics);
+
+#ifdef _WIN32
+        comNotifyThread = std::thread(comPortNotificationThread);
+#else
+        if (!ComPort::startEventLoop(onComPortEvent))
+            std::cerr << "Hotplug monitoring unavailable, devices are only scanned at startup" << std::endl;
+#endif
+        ComPort::DeviceManager::Options managerOptions;
+        managerOptions.pollPeriod = pollPeriod;
+        managerOptions.historyDir = options.historyDir;
+        managerOptions.binaryProtocol = options.binaryProtocol;
+        managerOptions.subscribe = options.subscribe;
+        deviceManager = std::make_unique<ComPort::DeviceManager>(managerOptions);
+        deviceManager->start(onDeviceReading, onDeviceLost, onDeviceNegotiated);
+        scheduler.post(Scheduler::EVENT_HOTPLUG); // initial scan
+        monitorThread = std::thread(deviceMonitoringThread);
+    }
+
+    void stop()
+    {
+        if (!running)
+            return;
+        running = false;
+        metricsExporter.stop();
+        scheduler.stop();
+
+#ifdef _WIN32
+        if (comNotifyHwnd)
+            PostMessage(comNotifyHwnd, WM_QUIT, 0, 0);
+#endif
+
+        if (monitorThread.joinable())
+            monitorThread.join();
+        deviceManager->stop();
+#ifdef _WIN32
+        if (comNotifyThread.joinable())
+            comNotifyThread.join();
+#else
+        ComPort::stopEventLoop();
+#endif
+        statsStore.close();
+        {
+            std::lock_guard<std::mutex> lock(rollupsMutex);
+            rollups.close();
+        }
+        livePublisher.close();
+    }
+
+    // -------------------- Headless --------------------
+#ifdef _WIN32
+    static std::mutex shutdownMutex;
+    static std::condition_variable shutdownCv;
+    static bool shutdownRequested = false;
+    static bool shutdownDone = false;
+#endif
+
+    int run_headless(const Options &options)
+    {
+#ifdef _WIN32
+        SetConsoleCtrlHandler([](DWORD) -> BOOL
+                              {
+                                  {
+                                      std::lock_guard<std::mutex> lock(shutdownMutex);
+                                      shutdownRequested = true;
+                                  }
+                                  shutdownCv.notify_all();
+
+                                  // Windows ends the process once this returns from a console close
+                                  std::unique_lock<std::mutex> lock(shutdownMutex);
+                                  shutdownCv.wait(lock, []
+                                                  { return shutdownDone; });
+                                  return TRUE; }, TRUE);
+#else
+        // Blocked before any thread starts so every thread inherits the mask and sigwait() below
+        // is the only place they are delivered
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+
+        open_stats(options);
+
+        std::cout << "Running headless, Ctrl+C to stop" << std::endl;
+        start(options, nullptr);
+
+#ifdef _WIN32
+        {
+            std::unique_lock<std::mutex> lock(shutdownMutex);
+            shutdownCv.wait(lock, []
+                            { return shutdownRequested; });
+        }
+#else
+        int received = 0;
+        sigwait(&signals, &received);
+#endif
+
+        std::cout << "Stopping" << std::endl;
+        stop();
+
+#ifdef _WIN32
+        {
+            std::lock_guard<std::mutex> lock(shutdownMutex);
+            shutdownDone = true;
+        }
+        shutdownCv.notify_all();
+#endif
+        return 0;
+    }
+}
@@ -0,0 +1,28 @@
+#include <cstring>
+#include <iostream>
+
+#include "include/daemon.hpp"
+#include "include/metrics.hpp"
+
+// mouse_clientd: polls, logs and records like the tray application, without a window
+int main(int argc, char *argv[])
+{
+    Metrics::startup_begin();
+
+    Daemon::Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+            continue; // accepted so the tray application's command line works unchanged
+        if (!Daemon::parse_option(argc, argv, i, options))
+        {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            std::cerr << "Usage: mouse_clientd [--mouse-port <port>] [--receiver-port <port>] "
+                         "[--history-dir <dir>] [--stats-dir <dir>] [--metrics-port <port>] "
+                         "[--text-protocol] [--no-subscribe]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    return Daemon::run_headless(options);
+}
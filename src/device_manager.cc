@@ -0,0 +1,665 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+#include "include/device_manager.hpp"
+#include "include/device_protocol.hpp"
+#include "include/metrics.hpp"
+#include "include/response_parser.hpp"
+
+namespace ComPort
+{
+    // Transports that cannot notify are read this often while a response is due
+    static constexpr std::chrono::milliseconds pollInterval(10);
+
+    static std::string narrow(const std::wstring &s)
+    {
+        return std::string(s.begin(), s.end());
+    }
+
+    static int64_t unix_now()
+    {
+        using namespace std::chrono;
+        return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    // mouse_<serial>.bin, or mouse_ttyACM0.bin for a device without a serial number
+    static std::string history_file_name(const DeviceInfo &info)
+    {
+        std::string key = device_name(info);
+        for (char &c : key)
+        {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_')
+                c = '_';
+        }
+        return "mouse_" + key + ".bin";
+    }
+
+    // -------------------- Public interface --------------------
+    void DeviceManager::start(OnReading readingCallback, OnLost lostCallback, OnNegotiated negotiatedCallback)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running)
+            return;
+        onReading = std::move(readingCallback);
+        onLost = std::move(lostCallback);
+        onNegotiated = std::move(negotiatedCallback);
+        running = true;
+        stopping = false;
+        thread = std::thread(&DeviceManager::run, this);
+    }
+
+    void DeviceManager::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running)
+                return;
+            stopping = true;
+        }
+        cv.notify_one();
+        thread.join();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        known.clear();
+    }
+
+    void DeviceManager::add(const DeviceInfo &info, std::unique_ptr<Transport> transport, std::optional<Protocol> protocol)
+    {
+        if (!transport)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            commands.push_back({nextId++, info, std::move(transport), protocol});
+            known.insert(info.port);
+        }
+        cv.notify_one();
+    }
+
+    void DeviceManager::remove(const std::wstring &port)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            DeviceInfo info;
+            info.port = port;
+            commands.push_back({0, info, nullptr, std::nullopt});
+            known.erase(port);
+        }
+        cv.notify_one();
+    }
+
+    void DeviceManager::poll_now()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pollAll = true;
+        }
+        cv.notify_one();
+    }
+
+    std::set<std::wstring> DeviceManager::ports() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return known;
+    }
+
+    // Any thread, called by the transports
+    void DeviceManager::wake(uint32_t id)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(id);
+        }
+        cv.notify_one();
+    }
+
+    // -------------------- Manager thread --------------------
+    void DeviceManager::run()
+    {
+        std::vector<uint32_t> woken;
+        std::vector<Command> todo;
+        while (true)
+        {
+            bool pollEverything = false;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                auto hasWork = [this]
+                { return stopping || pollAll || !ready.empty() || !commands.empty(); };
+
+                if (!hasWork())
+                {
+                    Clock::time_point until = Clock::time_point::max();
+                    if (!timers.empty())
+                        until = timers.top().deadline;
+                    until = std::min(until, next_polled_read());
+
+                    if (until == Clock::time_point::max())
+                        cv.wait(lock, hasWork);
+                    else
+                        cv.wait_until(lock, until, hasWork);
+                }
+                if (stopping)
+                    break;
+
+                Metrics::count(Metrics::COUNTER_MANAGER_WAKEUPS);
+                woken.swap(ready);
+                todo.swap(commands);
+                pollEverything = pollAll;
+                pollAll = false;
+            }
+
+            for (Command &command : todo)
+            {
+                if (command.transport)
+                {
+                    attach(command);
+                }
+                else if (auto it = byPort.find(command.info.port); it != byPort.end())
+                {
+                    detach(it->second);
+                }
+            }
+            todo.clear();
+
+            // A device may have been notified several times since the last round
+            std::sort(woken.begin(), woken.end());
+            woken.erase(std::unique(woken.begin(), woken.end()), woken.end());
+            for (uint32_t id : woken)
+            {
+                if (auto it = devices.find(id); it != devices.end())
+                    service(id, it->second);
+            }
+            woken.clear();
+
+            if (!polled.empty())
+            {
+                const Clock::time_point now = Clock::now();
+                std::vector<uint32_t> due = polled; // service() may lose a device
+                for (uint32_t id : due)
+                {
+                    if (auto it = devices.find(id); it != devices.end() && polled_read_due(it->second, now))
+                    {
+                        it->second.lastRead = now;
+                        service(id, it->second);
+                    }
+                }
+            }
+
+            if (pollEverything)
+            {
+                std::vector<uint32_t> idle;
+                for (auto &[id, device] : devices)
+                {
+                    if (device.state == State::IDLE)
+                        idle.push_back(id);
+                }
+                for (uint32_t id : idle)
+                {
+                    if (auto it = devices.find(id); it != devices.end())
+                        start_poll(id, it->second);
+                }
+            }
+
+            const Clock::time_point now = Clock::now();
+            while (!timers.empty() && timers.top().deadline <= now)
+            {
+                Timer timer = timers.top();
+                timers.pop();
+                auto it = devices.find(timer.id);
+                if (it != devices.end() && it->second.timerGeneration == timer.generation)
+                    on_deadline(timer.id, it->second);
+            }
+        }
+
+        // Outside the lock, closing a transport may wait for its I/O thread
+        devices.clear();
+        byPort.clear();
+        polled.clear();
+        timers = {};
+    }
+
+    // A response that is due is read every pollInterval, a subscription only every
+    // subscribedReadInterval, so an idle subscribed mouse does not keep the thread busy
+    bool DeviceManager::polled_read_due(const Device &device, Clock::time_point now) const
+    {
+        switch (device.state)
+        {
+        case State::IDLE:
+            return false;
+        case State::SUBSCRIBED:
+            return now >= device.lastRead + options.subscribedReadInterval;
+        default:
+            return now >= device.lastRead + pollInterval;
+        }
+    }
+
+    DeviceManager::Clock::time_point DeviceManager::next_polled_read() const
+    {
+        Clock::time_point next = Clock::time_point::max();
+        for (uint32_t id : polled)
+        {
+            const Device &device = devices.at(id);
+            if (device.state == State::SUBSCRIBED)
+                next = std::min(next, device.lastRead + options.subscribedReadInterval);
+            else if (device.state != State::IDLE)
+                next = std::min(next, device.lastRead + pollInterval);
+        }
+        return next;
+    }
+
+    void DeviceManager::attach(Command &command)
+    {
+        if (auto it = byPort.find(command.info.port); it != byPort.end())
+            detach(it->second);
+
+        const uint32_t id = command.id;
+        const Protocol protocol = options.binaryProtocol ? command.protocol.value_or(Protocol::BINARY) : Protocol::TEXT;
+        Device &device = devices.try_emplace(id, command.info, std::move(command.transport), protocol).first->second;
+        device.notifies = device.transport->set_notify([this, id]
+                                                       { wake(id); });
+        if (!device.notifies)
+            polled.push_back(id);
+        byPort[device.info.port] = id;
+
+        if (!options.historyDir.empty() && device.info.subject == Subject::MOUSE)
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(options.historyDir, ec);
+            std::string path = (std::filesystem::path(options.historyDir) / history_file_name(device.info)).string();
+            device.history = std::make_unique<Stats::Store>();
+            if (!device.history->open(path))
+            {
+                std::cerr << "Failed to open stats file: " << path << std::endl;
+                device.history.reset();
+            }
+            else
+            {
+                device.rollups = std::make_unique<Stats::Rollups>();
+                if (!device.rollups->open(path, *device.history))
+                    device.rollups.reset();
+            }
+        }
+
+        if (options.log)
+            std::cout << "Managing " << (device.info.subject == Subject::MOUSE ? "MOUSE" : "RECEIVER")
+                      << " on " << narrow(device.info.port)
+                      << (device.info.serial.empty() ? "" : " serial " + device.info.serial) << std::endl;
+        schedule(id, device, Clock::now());
+    }
+
+    void DeviceManager::detach(uint32_t id)
+    {
+        auto it = devices.find(id);
+        if (it == devices.end())
+            return;
+        byPort.erase(it->second.info.port);
+        polled.erase(std::remove(polled.begin(), polled.end(), id), polled.end());
+        devices.erase(it); // closes the transport, its pending timers are skipped
+    }
+
+    void DeviceManager::schedule(uint32_t id, Device &device, Clock::time_point deadline)
+    {
+        timers.push({deadline, id, ++device.timerGeneration});
+        device.scheduledFor = deadline;
+    }
+
+    void DeviceManager::start_poll(uint32_t id, Device &device)
+    {
+        device.transport->discard_input();
+        device.rx.reset();
+        device.found = FIELD_NONE;
+        device.parseTime = {};
+        Metrics::count(Metrics::COUNTER_POLLS);
+
+        device.pollStart = Clock::now();
+        device.pollStartNs = Metrics::now_ns();
+        device.subscribing = options.subscribe && device.protocol == Protocol::BINARY && !device.noSubscribe;
+        const char command = device.subscribing                     ? subscribeCommand
+                             : device.protocol == Protocol::BINARY ? binaryStatusCommand
+                                                                   : '1';
+        if (!device.transport->send(std::string_view(&command, 1)))
+        {
+            Metrics::count(Metrics::COUNTER_TRANSPORT_ERRORS);
+            lose(id, device);
+            return;
+        }
+        device.sent = Clock::now();
+        Metrics::record(Metrics::STAGE_WRITE, device.sent - device.pollStart);
+
+        // Firmware without 'S' or 'B' is found out quickly, it is only answered by '1'
+        const bool negotiating = (device.subscribing && !device.subscribed) ||
+                                 (device.protocol == Protocol::BINARY && !device.negotiated);
+        device.state = State::WAITING;
+        schedule(id, device, device.sent + std::chrono::milliseconds(negotiating ? negotiateTimeoutMs : firstByteTimeoutMs));
+    }
+
+    // Reads whatever the transport has without waiting
+    void DeviceManager::service(uint32_t id, Device &device)
+    {
+        char discard[256];
+        bool gotData = false;
+        while (true)
+        {
+            std::span<char> span = device.rx.write_span();
+            const bool dropping = span.empty();
+            if (dropping)
+                span = std::span<char>(discard, sizeof(discard));
+
+            int n = device.transport->receive(span, 0);
+            if (n < 0)
+            {
+                Metrics::count(Metrics::COUNTER_TRANSPORT_ERRORS);
+                lose(id, device);
+                return;
+            }
+            if (n == 0)
+                break;
+            if (device.state == State::IDLE)
+                continue; // the tail of a response that already timed out
+
+            if (dropping)
+                Metrics::count(Metrics::COUNTER_DROPPED_BYTES, n);
+            else
+                device.rx.commit(static_cast<size_t>(n));
+
+            gotData = true;
+            device.lastByte = Clock::now();
+            if (device.state == State::SUBSCRIBED)
+            {
+                parse_frames(device);
+                continue;
+            }
+            if (device.state == State::WAITING)
+            {
+                device.firstByte = device.lastByte;
+                device.state = State::RECEIVING;
+            }
+
+            parse_frames(device);
+            if (device.protocol == Protocol::BINARY && !device.negotiated && device.rx.dropped_bytes())
+            {
+                fall_back_to_text(id, device); // answered 'B' with something that is not a frame
+                return;
+            }
+            const uint32_t expected = expected_fields(device.info.subject);
+            if ((device.found & expected) == expected)
+            {
+                finish_poll(id, device);
+                return;
+            }
+        }
+
+        if (gotData && device.state == State::SUBSCRIBED)
+        {
+            report(device, device.lastByte, false);
+            schedule_subscribed(id, device, device.lastByte);
+        }
+        else if (gotData)
+        {
+            schedule(id, device, device.lastByte + std::chrono::milliseconds(interByteTimeoutMs));
+        }
+    }
+
+    void DeviceManager::on_deadline(uint32_t id, Device &device)
+    {
+        switch (device.state)
+        {
+        case State::IDLE:
+            start_poll(id, device);
+            break;
+
+        case State::WAITING:
+            if (device.subscribing && !device.subscribed)
+            {
+                // Could also be firmware without 'B', the next poll finds out
+                if (options.log)
+                    std::cout << "No subscription on " << narrow(device.info.port) << ", polling" << std::endl;
+                device.noSubscribe = true;
+                device.state = State::IDLE;
+                schedule(id, device, Clock::now());
+                break;
+            }
+            if (device.protocol == Protocol::BINARY && !device.negotiated)
+            {
+                fall_back_to_text(id, device);
+                break;
+            }
+            Metrics::count(Metrics::COUNTER_TIMEOUTS);
+            if (options.log)
+                std::cout << "No response from " << narrow(device.info.port) << std::endl;
+            device.state = State::IDLE;
+            schedule(id, device, std::max(device.pollStart + options.pollPeriod, Clock::now()));
+            break;
+
+        case State::RECEIVING:
+        {
+            // The line went quiet before every field arrived
+            if (device.protocol == Protocol::TEXT)
+            {
+                auto parseStart = Clock::now();
+                device.found |= parse_line(device.rx.take_partial(), device.status);
+                device.parseTime += Clock::now() - parseStart;
+            }
+            finish_poll(id, device);
+            break;
+        }
+
+        case State::SUBSCRIBED:
+            on_subscribed_deadline(id, device);
+            break;
+        }
+    }
+
+    void DeviceManager::parse_frames(Device &device)
+    {
+        auto parseStart = Clock::now();
+        std::string_view frame;
+        while (device.rx.next_frame(frame))
+        {
+            if (device.protocol == Protocol::TEXT)
+            {
+                device.found |= parse_line(frame, device.status);
+            }
+            else if (frame_type(frame) == FRAME_CHANGE)
+            {
+                // Outside SUBSCRIBED these arrived with the answer to 'S' and are part of it
+                if (decode_change_frame(frame, device.status) == FIELD_NONE)
+                {
+                    Metrics::count(Metrics::COUNTER_CRC_ERRORS);
+                    continue;
+                }
+                Metrics::count(Metrics::COUNTER_PUSHED_CHANGES);
+                if (device.state == State::SUBSCRIBED)
+                    mark_changed(device);
+            }
+            else if (uint32_t fields = decode_status_frame(frame, device.status))
+            {
+                device.found |= fields;
+                if (!device.negotiated)
+                {
+                    if (options.log)
+                        std::cout << "Using the binary protocol with " << narrow(device.info.port) << std::endl;
+                    if (onNegotiated)
+                        onNegotiated(device.info, Protocol::BINARY);
+                }
+                device.negotiated = true;
+                if (device.state == State::SUBSCRIBED)
+                {
+                    device.resyncSent = {};
+                    mark_changed(device);
+                }
+            }
+            else
+            {
+                Metrics::count(Metrics::COUNTER_CRC_ERRORS);
+            }
+        }
+        device.parseTime += Clock::now() - parseStart;
+    }
+
+    void DeviceManager::finish_poll(uint32_t id, Device &device)
+    {
+        Metrics::record(Metrics::STAGE_FIRST_BYTE, device.firstByte - device.sent);
+        Metrics::record(Metrics::STAGE_LAST_BYTE, device.lastByte - device.firstByte);
+        Metrics::record(Metrics::STAGE_PARSE, device.parseTime);
+
+        uint32_t missing = expected_fields(device.info.subject) & ~device.found;
+        if (missing)
+        {
+            Metrics::count(Metrics::COUNTER_TRUNCATED_FRAMES);
+            if (options.log)
+                std::cout << "Partial response from " << narrow(device.info.port) << ", missing: "
+                          << describe_fields(missing) << std::endl;
+        }
+
+        Reading reading = make_reading(device.status, device.info.subject, unix_now());
+        reading.polled_at_ns = device.pollStartNs;
+        append_history(device, reading.time);
+
+        if (device.subscribing && device.found != FIELD_NONE)
+        {
+            if (options.log && !device.subscribed)
+                std::cout << "Subscribed to changes from " << narrow(device.info.port) << std::endl;
+            device.subscribed = true;
+            device.state = State::SUBSCRIBED;
+            const Clock::time_point now = Clock::now();
+            device.lastReading = device.lastPersist = now;
+            device.readingDue = device.persistDue = false;
+            device.changedAtNs = 0;
+            device.resyncSent = {};
+            schedule_subscribed(id, device, now);
+        }
+        else
+        {
+            device.state = State::IDLE;
+            schedule(id, device, std::max(device.pollStart + options.pollPeriod, Clock::now()));
+        }
+
+        if (onReading)
+            onReading(device.info, reading);
+    }
+
+    void DeviceManager::append_history(Device &device, int64_t time)
+    {
+        if (!device.history)
+            return;
+        const Stats::Record record = Stats::from_status(device.status, time);
+        bool ok = device.history->append(record);
+        if (device.rollups)
+            ok &= device.rollups->add(record);
+        if (!ok)
+            std::cerr << "Failed to write stats for " << narrow(device.info.port) << std::endl;
+    }
+
+    // -------------------- Subscribed devices --------------------
+    void DeviceManager::on_subscribed_deadline(uint32_t id, Device &device)
+    {
+        const Clock::time_point now = Clock::now();
+        if (device.resyncSent != Clock::time_point{} &&
+            now >= device.resyncSent + std::chrono::milliseconds(firstByteTimeoutMs))
+        {
+            // Gone quiet, polled again and resubscribed by that poll if it answers
+            Metrics::count(Metrics::COUNTER_TIMEOUTS);
+            if (options.log)
+                std::cout << "No response from " << narrow(device.info.port) << std::endl;
+            report(device, now, true);
+            device.resyncSent = {};
+            device.state = State::IDLE;
+            schedule(id, device, now + options.pollPeriod);
+            return;
+        }
+
+        if (device.resyncSent == Clock::time_point{} && now >= device.lastByte + options.resyncPeriod)
+        {
+            // Also corrects a CHANGE frame lost to a CRC error
+            if (!device.transport->send(std::string_view(&subscribeCommand, 1)))
+            {
+                Metrics::count(Metrics::COUNTER_TRANSPORT_ERRORS);
+                lose(id, device);
+                return;
+            }
+            device.resyncSent = now;
+        }
+
+        report(device, now, false);
+        schedule_subscribed(id, device, now);
+    }
+
+    // Earliest of the coalesced reading, the coalesced history record and the resync
+    void DeviceManager::schedule_subscribed(uint32_t id, Device &device, Clock::time_point now)
+    {
+        Clock::time_point deadline = device.resyncSent != Clock::time_point{}
+                                         ? device.resyncSent + std::chrono::milliseconds(firstByteTimeoutMs)
+                                         : device.lastByte + options.resyncPeriod;
+        if (device.readingDue)
+            deadline = std::min(deadline, device.lastReading + options.readingInterval);
+        if (device.persistDue)
+            deadline = std::min(deadline, device.lastPersist + options.pollPeriod);
+
+        // Every byte moves the resync back, its timer is only replaced by an earlier one
+        if (device.scheduledFor > now && device.scheduledFor <= deadline)
+            return;
+        schedule(id, device, deadline);
+    }
+
+    void DeviceManager::mark_changed(Device &device)
+    {
+        device.readingDue = device.persistDue = true;
+        if (!device.changedAtNs)
+            device.changedAtNs = Metrics::now_ns();
+    }
+
+    // Hands on the changes that are due, all of them if force
+    void DeviceManager::report(Device &device, Clock::time_point now, bool force)
+    {
+        const bool persist = device.persistDue && (force || now >= device.lastPersist + options.pollPeriod);
+        const bool show = persist || (device.readingDue && (force || now >= device.lastReading + options.readingInterval));
+        if (!show)
+            return;
+
+        Reading reading = make_reading(device.status, device.info.subject, unix_now());
+        reading.polled_at_ns = device.changedAtNs;
+        reading.persist = persist;
+        if (persist)
+        {
+            append_history(device, reading.time);
+            device.lastPersist = now;
+            device.persistDue = false;
+        }
+        device.lastReading = now;
+        device.readingDue = false;
+        device.changedAtNs = 0;
+
+        if (onReading)
+            onReading(device.info, reading);
+    }
+
+    // Older firmware: 'B' went unanswered or came back as text, this connection stays on '1'
+    void DeviceManager::fall_back_to_text(uint32_t id, Device &device)
+    {
+        if (options.log)
+            std::cout << "No binary protocol on " << narrow(device.info.port) << ", using text" << std::endl;
+        device.protocol = Protocol::TEXT;
+        device.rx = FrameReader("\n");
+        device.state = State::IDLE;
+        if (onNegotiated)
+            onNegotiated(device.info, Protocol::TEXT);
+        schedule(id, device, Clock::now());
+    }
+
+    void DeviceManager::lose(uint32_t id, Device &device)
+    {
+        if (options.log)
+            std::cout << "Lost " << narrow(device.info.port) << std::endl;
+        DeviceInfo info = device.info;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            known.erase(info.port);
+        }
+        detach(id);
+        if (onLost)
+            onLost(info);
+    }
+}
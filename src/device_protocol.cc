@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "include/device_protocol.hpp"
+#include "include/metrics.hpp"
+#include "include/response_parser.hpp"
+
+namespace ComPort
+{
+    // Reads once into rx. A full ring means an over-long line the parser gets truncated,
+    // whatever does not fit is read and dropped.
+    static int receive_into(Transport &transport, FrameReader &rx, int timeoutMs)
+    {
+        char discard[256];
+        std::span<char> span = rx.write_span();
+        const bool dropping = span.empty();
+        if (dropping)
+            span = std::span<char>(discard, sizeof(discard));
+
+        int n = transport.receive(span, timeoutMs);
+        if (n > 0 && !dropping)
+            rx.commit(static_cast<size_t>(n));
+        else if (n > 0)
+            Metrics::count(Metrics::COUNTER_DROPPED_BYTES, n);
+        else if (n < 0)
+            Metrics::count(Metrics::COUNTER_TRANSPORT_ERRORS);
+        return n;
+    }
+
+    // Both firmwares answer '1' with a "Key: value" report, only the expected keys differ
+    bool query_status(Transport &transport, FrameReader &rx, Subject subject, MouseStatus &status,
+                      Protocol protocol)
+    {
+        const bool binary = protocol == Protocol::BINARY;
+        const char *name = (subject == Subject::MOUSE) ? "mouse" : "receiver";
+        const uint32_t expected = expected_fields(subject);
+
+        // Drop whatever is left of the previous response before asking for a new one
+        transport.discard_input();
+        rx.reset();
+        Metrics::count(Metrics::COUNTER_POLLS);
+
+        using namespace std::chrono;
+        const auto start = steady_clock::now();
+        const char command = binary ? binaryStatusCommand : '1';
+        if (!transport.send(std::string_view(&command, 1)))
+        {
+            std::cout << "Failed to send ENTER to " << name << std::endl;
+            Metrics::count(Metrics::COUNTER_TRANSPORT_ERRORS);
+            return false;
+        }
+        const auto sent = steady_clock::now();
+        Metrics::record(Metrics::STAGE_WRITE, sent - start);
+
+        const auto firstByteDeadline = sent + milliseconds(firstByteTimeoutMs);
+        steady_clock::time_point firstByte, lastByte;
+        steady_clock::duration parseTime{};
+        bool gotData = false;
+        uint32_t found = FIELD_NONE;
+
+        while (true)
+        {
+            auto parseStart = steady_clock::now();
+            std::string_view frame;
+            while (rx.next_frame(frame))
+            {
+                if (!binary)
+                    found |= parse_line(frame, status);
+                else if (uint32_t fields = decode_status_frame(frame, status))
+                    found |= fields;
+                else
+                    Metrics::count(Metrics::COUNTER_CRC_ERRORS);
+            }
+            parseTime += steady_clock::now() - parseStart;
+            if ((found & expected) == expected)
+                break;
+
+            int timeoutMs = interByteTimeoutMs;
+            if (!gotData)
+            {
+                auto left = duration_cast<milliseconds>(firstByteDeadline - steady_clock::now());
+                if (left.count() <= 0)
+                    break;
+                timeoutMs = static_cast<int>(left.count());
+            }
+
+            int n = receive_into(transport, rx, timeoutMs);
+            if (n < 0)
+                return false;
+            if (n == 0 && gotData)
+                break; // line went quiet before every field arrived
+            if (n > 0)
+            {
+                lastByte = steady_clock::now();
+                if (!gotData)
+                    firstByte = lastByte;
+                gotData = true;
+            }
+        }
+
+        if (!binary)
+        {
+            auto parseStart = steady_clock::now();
+            found |= parse_line(rx.take_partial(), status);
+            parseTime += steady_clock::now() - parseStart;
+        }
+
+        if (gotData)
+        {
+            Metrics::record(Metrics::STAGE_FIRST_BYTE, firstByte - sent);
+            Metrics::record(Metrics::STAGE_LAST_BYTE, lastByte - firstByte);
+            Metrics::record(Metrics::STAGE_PARSE, parseTime);
+        }
+        else
+        {
+            Metrics::count(Metrics::COUNTER_TIMEOUTS);
+        }
+
+        uint32_t missing = expected & ~found;
+        if (missing)
+        {
+            if (gotData)
+                Metrics::count(Metrics::COUNTER_TRUNCATED_FRAMES);
+            std::cout << "Partial response from " << name << ", missing: " << describe_fields(missing) << std::endl;
+        }
+        return true;
+    }
+
+    // How often a probe that has not heard back yet looks at its stop flag
+    static constexpr int probeSliceMs = 10;
+
+    Subject identify(Transport &transport, int timeoutMs)
+    {
+        const std::atomic<bool> never = false;
+        return identify(transport, timeoutMs, never);
+    }
+
+    Subject identify(Transport &transport, int timeoutMs, const std::atomic<bool> &stop)
+    {
+        transport.discard_input();
+        if (!transport.send("1"))
+            return Subject::NONE;
+
+        using namespace std::chrono;
+        const auto deadline = steady_clock::now() + milliseconds(timeoutMs);
+        FrameReader rx("\n");
+        MouseStatus status;
+        uint32_t found = FIELD_NONE;
+        bool identified = false;
+        while (true)
+        {
+            std::string_view frame;
+            while (rx.next_frame(frame))
+                found |= parse_line(frame, status);
+            identified = found != FIELD_NONE;
+
+            // Stops at the deadline even while the device keeps talking, e.g. a motion stream
+            const auto left = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+            if (left <= 0)
+                break;
+            if (stop)
+                return Subject::NONE;
+            const int wait = identified ? interByteTimeoutMs : static_cast<int>(std::min<int64_t>(left, probeSliceMs));
+            int n = receive_into(transport, rx, wait);
+            if (n < 0)
+                return Subject::NONE;
+            if (n == 0 && identified)
+                break;
+        }
+        transport.discard_input();
+
+        // The receiver reports its battery and nothing else, the mouse's counters come before it
+        constexpr uint32_t mouseOnly = (MOUSE_FIELDS | FIELD_FIRMWARE_BUILD_DATE) & ~RECEIVER_FIELDS;
+        if (found & mouseOnly)
+            return Subject::MOUSE;
+        return identified ? Subject::RECEIVER : Subject::NONE;
+    }
+
+    size_t probe_ports(const std::vector<DeviceInfo> &candidates, int timeoutMs, const OnProbed &onFound,
+                       const PortOpener &open)
+    {
+        std::mutex mutex;
+        size_t answered = 0;
+        std::atomic<bool> done = false; // onFound is not called anymore, the other probes give up
+
+        std::vector<std::thread> probes;
+        probes.reserve(candidates.size());
+        for (const DeviceInfo &candidate : candidates)
+        {
+            probes.emplace_back([&]
+                                {
+                                    if (done)
+                                        return;
+                                    std::unique_ptr<Transport> transport = open(candidate.port);
+                                    const Subject subject = transport ? identify(*transport, timeoutMs, done) : Subject::NONE;
+                                    if (done)
+                                        return;
+                                    const bool matches = subject != Subject::NONE &&
+                                                         (candidate.subject == Subject::NONE || subject == candidate.subject);
+                                    if (transport && subject == Subject::NONE)
+                                        std::cout << transport->name() << " did not identify itself" << std::endl;
+                                    else if (transport && !matches)
+                                        std::cout << transport->name() << " answered as "
+                                                  << (subject == Subject::MOUSE ? "MOUSE" : "RECEIVER") << ", not as "
+                                                  << (candidate.subject == Subject::MOUSE ? "MOUSE" : "RECEIVER") << std::endl;
+
+                                    std::lock_guard<std::mutex> lock(mutex);
+                                    if (matches && !done)
+                                    {
+                                        ++answered;
+                                        if (!onFound(candidate, std::move(transport)))
+                                            done = true;
+                                    } });
+        }
+
+        for (std::thread &probe : probes)
+            probe.join();
+        return answered;
+    }
+
+    bool stream_motion(Transport &transport, FrameReader &rx, const std::function<void(std::string_view)> &onLine,
+                       int idleTimeoutMs, const std::atomic<bool> &stop)
+    {
+        transport.discard_input();
+        rx.reset();
+
+        if (!transport.send("2"))
+        {
+            std::cout << "Failed to start the motion stream" << std::endl;
+            return false;
+        }
+
+        using namespace std::chrono;
+        auto lastData = steady_clock::now();
+        while (!stop)
+        {
+            std::string_view line;
+            while (rx.next_frame(line))
+                onLine(line);
+
+            // Short waits so stop is noticed, the OS keeps buffering meanwhile
+            int n = receive_into(transport, rx, 100);
+            if (n < 0)
+                return false;
+            if (n > 0)
+                lastData = steady_clock::now();
+            else if (steady_clock::now() - lastData >= milliseconds(idleTimeoutMs))
+                break;
+        }
+
+        std::string_view rest = rx.take_partial();
+        if (!rest.empty())
+            onLine(rest);
+        return true;
+    }
+}
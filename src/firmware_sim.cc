@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#include "include/binary_protocol.hpp"
+#include "include/firmware_sim.hpp"
+
+namespace Sim
+{
+    namespace
+    {
+        // "11111111-11111110 0xFF-0xFE", how the firmware prints one axis
+        void append_axis(std::string &out, int16_t value)
+        {
+            uint16_t raw = static_cast<uint16_t>(value);
+            for (int bit = 15; bit >= 0; --bit)
+            {
+                out.push_back((raw >> bit) & 1 ? '1' : '0');
+                if (bit == 8)
+                    out.push_back('-');
+            }
+            char hex[16];
+            std::snprintf(hex, sizeof(hex), " 0x%02X-0x%02X", raw >> 8, raw & 0xFF);
+            out += hex;
+        }
+
+        void append_xy(std::string &out, const char *label, int16_t x, int16_t y)
+        {
+            out += label;
+            out += "|X:";
+            append_axis(out, x);
+            out += " - Y:";
+            append_axis(out, y);
+            out += "\r\n";
+        }
+    }
+
+    FirmwareSim::FirmwareSim(ComPort::Transport &transport, const Options &options)
+        : transport(transport), options(options), rng(options.seed)
+    {
+        status.firmware_build_date = "Aug 31 2025 12:41:07";
+        status.left_clicks = 116982;
+        status.right_clicks = 372741;
+        status.middle_clicks = 31681;
+        status.backward_clicks = 804;
+        status.forward_clicks = 77;
+        status.downward_scrolls = 47768;
+        status.upward_scrolls = 18027;
+        status.battery_mv = 3876;
+        status.battery_percent = 64;
+        status.current_dpi = 1600;
+    }
+
+    std::string FirmwareSim::status_report() const
+    {
+        std::string out;
+        if (options.personality == ComPort::Subject::RECEIVER)
+        {
+            out += "==================== Receiver Stats ====================\r\n";
+        }
+        else
+        {
+            out += "==================== Mouse Stats ====================\r\n";
+            out += "Firmware build date: " + status.firmware_build_date + "\r\n";
+        }
+
+        // Filler goes first so the client has to parse through all of it
+        const std::string footer = "=====================================================\r\n";
+        const size_t fieldBytes = options.personality == ComPort::Subject::RECEIVER ? 40 : 250;
+        for (uint32_t line = 0; out.size() + fieldBytes + footer.size() < options.responseBytes; ++line)
+            out += "Debug " + std::to_string(line) + ": ........................................\r\n";
+
+        if (options.personality == ComPort::Subject::MOUSE)
+        {
+            out += "Left clicks: " + std::to_string(status.left_clicks) + "\r\n";
+            out += "Right clicks: " + std::to_string(status.right_clicks) + "\r\n";
+            out += "Middle clicks: " + std::to_string(status.middle_clicks) + "\r\n";
+            out += "Backward clicks: " + std::to_string(status.backward_clicks) + "\r\n";
+            out += "Forward clicks: " + std::to_string(status.forward_clicks) + "\r\n";
+            out += "Downward scrolls: " + std::to_string(status.downward_scrolls) + "\r\n";
+            out += "Upward scrolls: " + std::to_string(status.upward_scrolls) + "\r\n";
+        }
+        out += "Battery level: " + std::to_string(status.battery_mv) + "mV = " +
+               std::to_string(status.battery_percent) + "%\r\n";
+        if (options.personality == ComPort::Subject::MOUSE)
+            out += "Current DPI [400, 800, 1600, 3200]: " + std::to_string(status.current_dpi) + "\r\n";
+        out += footer;
+        return out;
+    }
+
+    std::string FirmwareSim::status_frame() const
+    {
+        return ComPort::encode_status_frame(status, options.personality);
+    }
+
+    std::string FirmwareSim::motion_block()
+    {
+        std::uniform_int_distribution<int> step(-3, 3);
+        motionX = static_cast<int16_t>(std::clamp(motionX + step(rng), -300, 300));
+        motionY = static_cast<int16_t>(std::clamp(motionY + step(rng), -300, 300));
+
+        std::string out = "\r[ " + std::to_string(motionBlock++) + " ] -------------\r\n";
+        out.push_back('\0');
+        append_xy(out, "before: ", motionX, motionY);
+        append_xy(out, "after:  ", motionX, motionY);
+        out += "x_cond: 0 - y_cond: 0\r\n\r\n";
+        return out;
+    }
+
+    void FirmwareSim::run(const std::atomic<bool> &stop)
+    {
+        using namespace std::chrono;
+        char commands[64];
+        while (!stop)
+        {
+            int timeoutMs = 100;
+            if (subscribed)
+            {
+                auto untilClick = duration_cast<milliseconds>(nextClick - steady_clock::now()).count();
+                timeoutMs = static_cast<int>(std::clamp<int64_t>(untilClick, 0, timeoutMs));
+            }
+
+            int n = transport.receive(commands, timeoutMs);
+            if (n < 0)
+                return;
+            for (int i = 0; i < n && !stop; ++i)
+                answer(commands[i], stop);
+
+            if (subscribed && steady_clock::now() >= nextClick)
+            {
+                click();
+                schedule_click();
+            }
+        }
+    }
+
+    void FirmwareSim::answer(char command, const std::atomic<bool> &stop)
+    {
+        if (command == '1')
+        {
+            use_mouse();
+            respond_delay();
+            send_paced(status_report());
+        }
+        else if (command == ComPort::binaryStatusCommand && options.binaryProtocol)
+        {
+            use_mouse();
+            respond_delay();
+            send_paced(status_frame());
+        }
+        else if (command == ComPort::subscribeCommand && options.binaryProtocol && options.subscribe)
+        {
+            use_mouse();
+            respond_delay();
+            send_paced(status_frame());
+            if (!subscribed)
+            {
+                subscribed = true;
+                nextClick = std::chrono::steady_clock::now();
+                schedule_click();
+            }
+        }
+        else if (command == '2' && options.personality == ComPort::Subject::MOUSE)
+        {
+            stream_motion(stop);
+        }
+    }
+
+    // Someone has been using the mouse since the last poll
+    void FirmwareSim::use_mouse()
+    {
+        ++requestCount;
+
+        std::uniform_int_distribution<int> clicks(0, 4);
+        status.left_clicks += clicks(rng);
+        status.right_clicks += clicks(rng);
+        status.downward_scrolls += clicks(rng);
+        status.upward_scrolls += clicks(rng) / 2;
+        if (requestCount % 50 == 0 && status.battery_mv > 3300)
+            status.battery_mv -= 1;
+        status.battery_percent = std::clamp((status.battery_mv - 3300) * 100 / (4200 - 3300), 0, 100);
+    }
+
+    // One click or scroll while subscribed, pushed as a CHANGE frame
+    void FirmwareSim::click()
+    {
+        const ComPort::MouseStatus before = status;
+        switch (std::uniform_int_distribution<int>(0, 3)(rng))
+        {
+        case 0:
+            ++status.left_clicks;
+            break;
+        case 1:
+            ++status.right_clicks;
+            break;
+        case 2:
+            ++status.downward_scrolls;
+            break;
+        default:
+            ++status.upward_scrolls;
+            break;
+        }
+
+        std::string frame = ComPort::encode_change_frame(before, status, options.personality);
+        if (!frame.empty())
+            send_paced(frame);
+    }
+
+    void FirmwareSim::schedule_click()
+    {
+        if (options.clicksPerSecond <= 0)
+        {
+            nextClick = std::chrono::steady_clock::time_point::max();
+            return;
+        }
+        std::exponential_distribution<double> gap(options.clicksPerSecond);
+        nextClick += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(gap(rng)));
+    }
+
+    // Streams until stop or until the host sends anything, which is then answered as a command
+    void FirmwareSim::stream_motion(const std::atomic<bool> &stop)
+    {
+        respond_delay();
+        if (!send_paced("--------------------------------------------------- START\r\n\r\n"))
+            return;
+
+        using namespace std::chrono;
+        auto nextBlock = steady_clock::now();
+        char input[64];
+        int pending = 0;
+        while (!stop)
+        {
+            if (!send_paced(motion_block()))
+                return;
+
+            if (options.motionBlocksPerSecond > 0)
+            {
+                nextBlock += nanoseconds(1'000'000'000 / options.motionBlocksPerSecond);
+                std::this_thread::sleep_until(nextBlock);
+            }
+
+            pending = transport.receive(input, 0);
+            if (pending != 0)
+                break;
+        }
+
+        for (int i = 0; i < pending; ++i)
+            answer(input[i], stop);
+    }
+
+    void FirmwareSim::respond_delay()
+    {
+        int delayMs = options.latencyMs;
+        if (options.jitterMs > 0)
+            delayMs += std::uniform_int_distribution<int>(0, options.jitterMs)(rng);
+        if (delayMs > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+    }
+
+    bool FirmwareSim::send_paced(std::string_view bytes)
+    {
+        sentBytes += bytes.size();
+        if (options.baud <= 0)
+            return transport.send(bytes);
+
+        using namespace std::chrono;
+        const double nsPerByte = 1e9 * 10 / options.baud; // 8N1 is ten bits per byte
+        while (!bytes.empty())
+        {
+            std::string_view chunk = bytes.substr(0, 64);
+            bytes.remove_prefix(chunk.size());
+
+            auto now = steady_clock::now();
+            if (lineFreeAt > now)
+                std::this_thread::sleep_until(lineFreeAt);
+            else
+                lineFreeAt = now;
+
+            if (!transport.send(chunk))
+                return false;
+            lineFreeAt += nanoseconds(static_cast<int64_t>(nsPerByte * chunk.size()));
+        }
+        return true;
+    }
+}
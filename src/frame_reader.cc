@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "include/frame_reader.hpp"
+
+namespace ComPort
+{
+    // -------------------- RingBuffer --------------------
+    RingBuffer::RingBuffer(size_t capacity)
+        : data(new char[std::bit_ceil(std::max<size_t>(capacity, 16))]),
+          mask(std::bit_ceil(std::max<size_t>(capacity, 16)) - 1)
+    {
+    }
+
+    std::span<char> RingBuffer::write_span()
+    {
+        size_t pos = tail & mask;
+        size_t contiguous = std::min(capacity() - size(), capacity() - pos);
+        return {data.get() + pos, contiguous};
+    }
+
+    size_t RingBuffer::find(std::string_view needle, size_t from) const
+    {
+        if (needle.empty() || size() < needle.size())
+            return npos;
+
+        const size_t last = size() - needle.size();
+        for (size_t i = from; i <= last;)
+        {
+            // memchr over the contiguous run starting at i for the first needle byte
+            size_t pos = (head + i) & mask;
+            size_t run = std::min(last + 1 - i, capacity() - pos);
+            const char *hit = static_cast<const char *>(std::memchr(data.get() + pos, needle[0], run));
+            if (!hit)
+            {
+                i += run;
+                continue;
+            }
+
+            i += static_cast<size_t>(hit - (data.get() + pos));
+            size_t k = 1;
+            while (k < needle.size() && at(i + k) == needle[k])
+                ++k;
+            if (k == needle.size())
+                return i;
+            ++i;
+        }
+        return npos;
+    }
+
+    std::string_view RingBuffer::view(size_t n)
+    {
+        n = std::min(n, size());
+        size_t pos = head & mask;
+        if (pos + n > capacity())
+        {
+            // Rare: the frame wraps, rotate the storage so the buffered bytes start at 0
+            std::rotate(data.get(), data.get() + pos, data.get() + capacity());
+            tail = size();
+            head = 0;
+            pos = 0;
+        }
+        return {data.get() + pos, n};
+    }
+
+    // -------------------- FrameReader --------------------
+    FrameReader::FrameReader(std::string_view terminator, size_t capacity)
+        : ring(capacity), terminator(terminator)
+    {
+    }
+
+    FrameReader::FrameReader(size_t headerSize, LengthFn frameLength, size_t capacity)
+        : ring(capacity), headerSize(headerSize), frameLength(frameLength)
+    {
+    }
+
+    void FrameReader::release_pending()
+    {
+        ring.consume(pending);
+        pending = 0;
+        lastTruncated = false;
+    }
+
+    bool FrameReader::next_frame(std::string_view &frame)
+    {
+        release_pending();
+
+        if (!frameLength)
+        {
+            size_t at = ring.find(terminator, scanned);
+            if (at != RingBuffer::npos)
+            {
+                frame = ring.view(at + terminator.size()).substr(0, at);
+                pending = at + terminator.size();
+                scanned = 0;
+                return true;
+            }
+
+            // Resume after what was already searched, keeping a possibly split terminator
+            scanned = ring.size() >= terminator.size() ? ring.size() - terminator.size() + 1 : 0;
+            if (!ring.full())
+                return false;
+
+            frame = ring.view(ring.size());
+            pending = ring.size();
+            scanned = 0;
+            lastTruncated = true;
+            truncatedCount++;
+            return true;
+        }
+
+        while (ring.size() >= headerSize)
+        {
+            size_t length = frameLength(ring.view(headerSize));
+            if (length < headerSize || length > ring.capacity())
+            {
+                // Not a frame start, slide one byte to resynchronise
+                ring.consume(1);
+                droppedCount++;
+                continue;
+            }
+            if (ring.size() < length)
+                return false;
+
+            frame = ring.view(length);
+            pending = length;
+            return true;
+        }
+        return false;
+    }
+
+    std::string_view FrameReader::take_partial()
+    {
+        release_pending();
+        scanned = 0;
+        pending = ring.size();
+        return ring.view(pending);
+    }
+
+    void FrameReader::reset()
+    {
+        ring.clear();
+        pending = 0;
+        scanned = 0;
+        lastTruncated = false;
+    }
+}
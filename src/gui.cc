@@ -0,0 +1,772 @@
+#include <QAction>
+#include <QApplication>
+#include <QCloseEvent>
+#include <QComboBox>
+#include <QDateTime>
+#include <QDebug>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFont>
+#include <QFontDatabase>
+#include <QFrame>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QIcon>
+#include <QLabel>
+#include <QMenu>
+#include <QMenuBar>
+#include <QMessageBox>
+#include <QMouseEvent>
+#include <QMovie>
+#include <QPalette>
+#include <QPainter>
+#include <QPushButton>
+#include <QResource>
+#include <QScrollArea>
+#include <QSystemTrayIcon>
+#include <QTextBrowser>
+#include <QTextStream>
+#include <QTimer>
+#include <QTimeZone>
+#include <QtMultimedia/QAudioOutput>
+#include <QtMultimedia/QMediaPlayer>
+#include <QVBoxLayout>
+#include <QWheelEvent>
+#include <QDesktopServices>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "include/daemon.hpp"
+#include "include/gui.hpp"
+#include "include/metrics.hpp"
+#include "include/motion_analysis.hpp"
+#include "include/motion_store.hpp"
+#include "include/seqlock.hpp"
+#include "include/stats_store.hpp"
+
+#define APP_VERSION "0.9"
+#define WINDOW_SIZE_X 300
+#define WINDOW_SIZE_Y 280
+#define THALES_FILENAME "mouse_thales.txt"
+#define BEEP_FILENAME "beep.wav"
+#define GIF_FILENAME "mouse_life_downsized.gif"
+#define MEDIA_FILENAME "mouse_client_media.rcc"
+
+// Static pointers
+QMainWindow *mainWindow = nullptr;
+QSystemTrayIcon *trayIcon = nullptr;
+QLabel *dataLabel = nullptr;
+QPushButton *connectButton = nullptr;
+QIcon *connectedIcon = nullptr;
+QIcon *disconnectedIcon = nullptr;
+QMediaPlayer *lowBatteryPlayer = nullptr;
+QAudioOutput *lowBatteryAudio = nullptr;
+
+// -------------------- Stats window --------------------
+// Rows of the stats grid, the counters first in Stats::counterNames order
+enum StatField
+{
+    STAT_LEFT_CLICKS,
+    STAT_RIGHT_CLICKS,
+    STAT_MIDDLE_CLICKS,
+    STAT_BACKWARD_CLICKS,
+    STAT_FORWARD_CLICKS,
+    STAT_DOWN_SCROLLS,
+    STAT_UP_SCROLLS,
+    STAT_CURRENT_DPI,
+    STAT_BATTERY_LEVEL,
+    STAT_LAST_READING,
+    STAT_COUNT
+};
+
+static const std::array<const char *, STAT_COUNT> statNames = {
+    "Left clicks", "Right clicks", "Middle clicks",
+    "Backward clicks", "Forward clicks",
+    "Down scrolls", "Up scrolls",
+    "Current DPI", "Battery level", "Last reading"};
+
+struct StatValue
+{
+    int64_t value = StatCell::noValue;
+    StatCell::State state = StatCell::STATE_STALE;
+};
+
+// Follows every reading, the cells only while the window is open
+static std::array<StatValue, STAT_COUNT> statModel;
+static std::array<StatCell *, STAT_COUNT> statCells{};
+
+static void show_stats()
+{
+    for (size_t i = 0; i < STAT_COUNT; ++i)
+        statCells[i]->display(statModel[i].value, statModel[i].state);
+}
+
+StatCell::StatCell(Format format, QWidget *parent) : QLabel("-", parent), format(format)
+{
+    setTextFormat(Qt::PlainText);
+    setMargin(1);
+    QFont cellFont = font();
+    cellFont.setPixelSize(14);
+    cellFont.setBold(true);
+    setFont(cellFont);
+    QPalette cellPalette = palette();
+    cellPalette.setColor(QPalette::WindowText, Qt::gray);
+    setPalette(cellPalette);
+}
+
+void StatCell::display(int64_t newValue, State newState)
+{
+    if (newValue != value)
+    {
+        value = newValue;
+        if (value == noValue)
+            setText("-");
+        else if (format == FORMAT_TIME)
+            setText(QDateTime::fromSecsSinceEpoch(value).toString("yyyy-MM-dd hh:mm:ss"));
+        else if (format == FORMAT_PERCENT)
+            setText(QString::number(value) + '%');
+        else
+            setText(QString::number(value));
+    }
+    if (newState != state)
+    {
+        state = newState;
+        QPalette cellPalette = palette();
+        cellPalette.setColor(QPalette::WindowText, state == STATE_ALERT  ? Qt::red
+                                                   : state == STATE_LIVE ? Qt::black
+                                                                         : Qt::gray);
+        setPalette(cellPalette);
+    }
+}
+
+// -------------------- Connection and media --------------------
+// Window title and tray tooltip, kept for a window built later
+static QString connectionText = "Not connected";
+static bool connectionUp = false;
+
+static void show_connection(const QString &text, bool up)
+{
+    if (text == connectionText && up == connectionUp)
+        return;
+    connectionText = text;
+    connectionUp = up;
+    const QIcon &icon = up ? *connectedIcon : *disconnectedIcon;
+    trayIcon->setIcon(icon);
+    trayIcon->setToolTip(text);
+    if (mainWindow)
+    {
+        mainWindow->setWindowTitle(text);
+        mainWindow->setWindowIcon(icon);
+    }
+}
+
+// The beep and the About animation are in a resource file of their own next to the
+// executable, registered the first time one of them is needed rather than at every start
+static void load_media()
+{
+    static bool loaded = false;
+    if (loaded)
+        return;
+    loaded = true;
+    const QString path = QCoreApplication::applicationDirPath() + "/" + MEDIA_FILENAME;
+    if (!QResource::registerResource(path))
+        qDebug() << "Warning: failed to load" << path;
+}
+
+static void play_low_battery()
+{
+    if (!lowBatteryPlayer)
+    {
+        load_media();
+        lowBatteryPlayer = new QMediaPlayer(trayIcon);
+        lowBatteryAudio = new QAudioOutput(trayIcon);
+        lowBatteryAudio->setVolume(1.0);
+        lowBatteryPlayer->setAudioOutput(lowBatteryAudio);
+        lowBatteryPlayer->setSource(QUrl(QStringLiteral("qrc:/res/") + BEEP_FILENAME));
+    }
+    lowBatteryPlayer->play();
+}
+
+Gui::Gui(QApplication &app, QObject *parent) : QObject(parent), app(app) {}
+Gui::~Gui() {}
+
+bool Gui::guiOpen = false;
+
+// -------------------- Worker thread handoff --------------------
+static SeqLock<ComPort::Reading> latestReading;
+static std::mutex publishMutex; // the monitor and reader threads both publish, SeqLock takes one writer
+static std::atomic<bool> updatePending(false);
+
+void Gui::publish(const ComPort::Reading &reading)
+{
+    ComPort::Reading stamped = reading;
+    stamped.published_at_ns = Metrics::now_ns();
+    {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        latestReading.store(stamped);
+    }
+
+    // A burst of readings queues a single call, which renders whatever is newest when it runs
+    if (updatePending.exchange(true))
+    {
+        Metrics::count(Metrics::COUNTER_COALESCED_UPDATES);
+        return;
+    }
+    QMetaObject::invokeMethod(trayIcon, []()
+                              {
+                                  updatePending = false;
+                                  Gui::updateGui(latestReading.load()); }, Qt::QueuedConnection);
+}
+
+void Gui::updateGui(const ComPort::Reading &reading)
+{
+    const uint64_t renderStart = Metrics::now_ns();
+    if (reading.published_at_ns)
+        Metrics::record(Metrics::STAGE_PUBLISH, reading.published_at_ns, renderStart);
+
+    if (reading.connected)
+    {
+        if (reading.subject == ComPort::Subject::MOUSE)
+        {
+            show_connection("Connected to MOUSE", true);
+
+            const uint64_t counters[Stats::counterCount] = {
+                reading.left_clicks, reading.right_clicks, reading.middle_clicks,
+                reading.backward_clicks, reading.forward_clicks,
+                reading.downward_scrolls, reading.upward_scrolls};
+            for (size_t i = 0; i < Stats::counterCount; ++i)
+                statModel[i] = {static_cast<int64_t>(counters[i]), StatCell::STATE_LIVE};
+            statModel[STAT_CURRENT_DPI] = {reading.current_dpi, StatCell::STATE_LIVE};
+        }
+        else if (reading.subject == ComPort::Subject::RECEIVER)
+        {
+            show_connection("Connected to RECEIVER", true);
+
+            // The receiver has no counters of its own, keep the last ones
+            for (size_t i = 0; i < Stats::counterCount; ++i)
+                statModel[i].state = StatCell::STATE_STALE;
+            statModel[STAT_CURRENT_DPI] = {StatCell::noValue, StatCell::STATE_STALE};
+        }
+        else
+        {
+            show_connection(connectionText, true);
+        }
+
+        // Pushed changes arrive many times a second, beep once when the battery turns low
+        // (or is found low after a reconnect), not with every reading
+        const bool lowBattery = reading.battery_percent < 30;
+        const bool wasLow = statModel[STAT_BATTERY_LEVEL].state == StatCell::STATE_ALERT;
+        statModel[STAT_BATTERY_LEVEL] = {reading.battery_percent, lowBattery ? StatCell::STATE_ALERT : StatCell::STATE_LIVE};
+        statModel[STAT_LAST_READING] = {reading.time, StatCell::STATE_LIVE};
+        if (lowBattery && !wasLow)
+            play_low_battery();
+    }
+    else
+    {
+        show_connection("Not connected", false);
+
+        // Keep last values, but gray
+        for (StatValue &stat : statModel)
+            stat.state = StatCell::STATE_STALE;
+    }
+
+    // A hidden window is brought up to date when it is opened
+    if (Gui::guiOpen)
+        show_stats();
+
+    std::cout << "GUI updated" << std::endl;
+
+    if (reading.connected)
+    {
+        const uint64_t renderEnd = Metrics::now_ns();
+        Metrics::record(Metrics::STAGE_RENDER, renderStart, renderEnd);
+        if (reading.polled_at_ns)
+            Metrics::record(Metrics::STAGE_CYCLE, reading.polled_at_ns, renderEnd);
+    }
+}
+
+void MainWindow::closeEvent(QCloseEvent *event)
+{
+    this->hide();
+    event->ignore();
+    Gui::guiOpen = false;
+}
+
+// -------------------- History chart --------------------
+static constexpr int64_t chartMinSpan = 10 * 60;
+static constexpr int64_t chartMaxSpan = 20 * 365 * 86400LL;
+
+HistoryChart::HistoryChart(QWidget *parent) : QWidget(parent)
+{
+    setMinimumSize(WINDOW_SIZE_X, 150);
+    const int64_t now = QDateTime::currentSecsSinceEpoch();
+    setRange(now - 86400, now);
+}
+
+void HistoryChart::setRange(int64_t rangeFrom, int64_t rangeTo)
+{
+    const int64_t now = QDateTime::currentSecsSinceEpoch();
+    const int64_t span = std::clamp<int64_t>(rangeTo - rangeFrom, chartMinSpan, chartMaxSpan);
+    to = std::min(rangeFrom + span, now);
+    from = to - span;
+    following = to == now;
+    stale = true;
+    update();
+}
+
+void HistoryChart::setCounters(uint32_t counterMask)
+{
+    mask = counterMask;
+    stale = true;
+    update();
+}
+
+void HistoryChart::refresh()
+{
+    if (following)
+    {
+        const int64_t span = to - from;
+        to = QDateTime::currentSecsSinceEpoch();
+        from = to - span;
+    }
+    stale = true;
+    update();
+}
+
+QRect HistoryChart::plotArea() const
+{
+    return rect().adjusted(4, 18, -4, -18);
+}
+
+// Only the columns of this width are kept, whatever the range
+void HistoryChart::load(int width)
+{
+    resolution = Stats::chart_resolution(from, to, width);
+    downsampler.begin(from, to, width, resolution, mask);
+    Daemon::scan_history(resolution, from, to, [this](const Stats::Bucket &bucket)
+                         { downsampler.add(bucket); });
+    columns = downsampler.finish();
+    peak = downsampler.peak();
+    stale = false;
+}
+
+void HistoryChart::paintEvent(QPaintEvent *)
+{
+    const QRect plot = plotArea();
+    if (stale || static_cast<int>(columns.size()) != plot.width())
+        load(plot.width());
+
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+    painter.setPen(palette().mid().color());
+    painter.drawRect(plot.adjusted(0, 0, -1, -1));
+
+    static const char *units[Stats::RESOLUTION_COUNT] = {"minute", "hour", "day"};
+    const QString format = to - from > 2 * 86400 ? "yyyy-MM-dd" : "MM-dd hh:mm";
+    painter.setPen(palette().text().color());
+    painter.drawText(rect().adjusted(4, 0, -4, 0), Qt::AlignLeft | Qt::AlignTop,
+                     QString("%1 per %2").arg(peak).arg(units[resolution]));
+    painter.drawText(rect().adjusted(4, 0, -4, 0), Qt::AlignLeft | Qt::AlignBottom,
+                     QDateTime::fromSecsSinceEpoch(from).toString(format));
+    painter.drawText(rect().adjusted(4, 0, -4, 0), Qt::AlignRight | Qt::AlignBottom,
+                     following ? QString("now") : QDateTime::fromSecsSinceEpoch(to).toString(format));
+    if (peak == 0)
+    {
+        painter.setPen(palette().mid().color());
+        painter.drawText(plot, Qt::AlignCenter, "No activity");
+        return;
+    }
+
+    // A vertical line from the quietest to the busiest bucket under every pixel column
+    painter.setPen(QColor(0x30, 0x80, 0xd0));
+    const double scale = double(plot.height() - 1) / double(peak);
+    for (size_t x = 0; x < columns.size(); ++x)
+    {
+        const Stats::ChartColumn &column = columns[x];
+        if (!column.buckets)
+            continue;
+        const int px = plot.left() + static_cast<int>(x);
+        const int top = plot.bottom() - static_cast<int>(double(column.max) * scale);
+        const int bottom = plot.bottom() - static_cast<int>(double(column.min) * scale);
+        painter.drawLine(px, bottom, px, top);
+    }
+}
+
+void HistoryChart::wheelEvent(QWheelEvent *event)
+{
+    const QRect plot = plotArea();
+    const double factor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+    const double at = std::clamp((event->position().x() - plot.left()) / std::max(plot.width(), 1), 0.0, 1.0);
+    const int64_t pivot = from + static_cast<int64_t>(at * double(to - from));
+    setRange(pivot - static_cast<int64_t>(double(pivot - from) * factor),
+             pivot + static_cast<int64_t>(double(to - pivot) * factor));
+    event->accept();
+}
+
+void HistoryChart::mousePressEvent(QMouseEvent *event)
+{
+    dragX = static_cast<int>(event->position().x());
+    dragFrom = from;
+    dragTo = to;
+}
+
+void HistoryChart::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!(event->buttons() & Qt::LeftButton))
+        return;
+    const double secondsPerPixel = double(dragTo - dragFrom) / std::max(plotArea().width(), 1);
+    const int64_t shift = static_cast<int64_t>((dragX - event->position().x()) * secondsPerPixel);
+    setRange(dragFrom + shift, dragTo + shift);
+}
+
+// Everything the window holds, built on its first opening
+static void build_window()
+{
+    mainWindow = new MainWindow();
+    mainWindow->setWindowTitle(connectionText);
+    mainWindow->setWindowIcon(connectionUp ? *connectedIcon : *disconnectedIcon);
+    mainWindow->setFixedWidth(WINDOW_SIZE_X);
+    // mainWindow->setFixedHeight(WINDOW_SIZE_Y);
+
+    // Owned by the window from the start, so nothing leaks if it is never shown
+    QMenuBar *menuBar = new QMenuBar(mainWindow);
+    QMenu *aboutMenu = new QMenu("About", menuBar);
+    QAction *openFolderAction = new QAction("Open location", aboutMenu);
+    QAction *thalesAction = new QAction("Thales", aboutMenu);
+    QAction *historyAction = new QAction("History", aboutMenu);
+    QAction *motionAction = new QAction("Motion analysis", aboutMenu);
+    QAction *diagnosticsAction = new QAction("Diagnostics", aboutMenu);
+    QAction *aboutAction = new QAction("About", aboutMenu);
+    aboutMenu->addAction(openFolderAction);
+    aboutMenu->addAction(thalesAction);
+    aboutMenu->addAction(historyAction);
+    aboutMenu->addAction(motionAction);
+    aboutMenu->addAction(diagnosticsAction);
+    aboutMenu->addAction(aboutAction);
+
+    menuBar->addMenu(aboutMenu);
+    mainWindow->setMenuBar(menuBar);
+
+    QGridLayout *mainLayout = new QGridLayout();
+    mainLayout->setSpacing(2);
+    mainLayout->setContentsMargins(2, 2, 2, 2);
+    mainLayout->setAlignment(Qt::AlignTop);
+
+    QGridLayout *grid = new QGridLayout();
+    grid->setSpacing(2);
+    grid->setContentsMargins(0, 0, 0, 0);
+    grid->setAlignment(Qt::AlignTop);
+    grid->setColumnStretch(0, 0);
+    grid->setColumnStretch(1, 1);
+
+    QString nameStyle = "padding: 1px; font-size: 12px;";
+
+    for (int i = 0; i < STAT_COUNT; ++i)
+    {
+        QLabel *nameLabel = new QLabel(QString(statNames[i]) + ":");
+        nameLabel->setStyleSheet(nameStyle);
+        statCells[i] = new StatCell(i == STAT_BATTERY_LEVEL  ? StatCell::FORMAT_PERCENT
+                                    : i == STAT_LAST_READING ? StatCell::FORMAT_TIME
+                                                             : StatCell::FORMAT_NUMBER);
+        grid->addWidget(nameLabel, i, 0, Qt::AlignLeft | Qt::AlignTop);
+        grid->addWidget(statCells[i], i, 1, Qt::AlignLeft | Qt::AlignTop);
+    }
+
+    QFrame *gridFrame = new QFrame();
+    QVBoxLayout *frameLayout = new QVBoxLayout(gridFrame);
+    frameLayout->setContentsMargins(0, 0, 0, 0);
+    frameLayout->setAlignment(Qt::AlignTop);
+    frameLayout->addLayout(grid);
+    mainLayout->addWidget(gridFrame, 0, 0, 1, 2, Qt::AlignTop);
+
+    dataLabel = new QLabel();
+    dataLabel->setTextFormat(Qt::RichText);
+    dataLabel->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+    dataLabel->setMaximumHeight(40);
+    mainLayout->addWidget(dataLabel, 1, 0, 1, 2, Qt::AlignTop);
+
+    QWidget *centralWidget = new QWidget();
+    centralWidget->setLayout(mainLayout);
+    mainWindow->setCentralWidget(centralWidget);
+
+    QObject::connect(aboutAction, &QAction::triggered, []()
+                     {
+                         load_media();
+                         QMovie *movie = new QMovie(QString(":/res/") + GIF_FILENAME);
+                         if (!movie->isValid()) {
+                             QMessageBox::warning(mainWindow, "Error", QString("Failed to load GIF: ") + GIF_FILENAME);
+                             return;
+                         }
+                         QLabel *gifLabel = new QLabel();
+                         movie->jumpToFrame(0);
+                         QSize gifSize = movie->currentImage().size();
+                         gifLabel->setFixedSize(gifSize);
+                         gifLabel->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+                         gifLabel->setMovie(movie);
+                         movie->start();
+
+                         QString buildInfo = QString("<b>Mouse Client</b><br>Display and backup mouse stats<br><br>Version: %1<br>Compiled on: %2 %3 %4")
+                                                .arg(APP_VERSION)
+                                                .arg(__DATE__)
+                                                .arg(__TIME__)
+                                                .arg(QTimeZone::systemTimeZone().displayName(QDateTime::currentDateTime(), QTimeZone::ShortName));
+
+                         QLabel *infoLabel = new QLabel(buildInfo);
+                         infoLabel->setAlignment(Qt::AlignCenter);
+                         infoLabel->setTextFormat(Qt::RichText);
+                         infoLabel->setStyleSheet("font-size: 12px; padding: 4px;");
+
+                         QDialog dialog(mainWindow);
+                         dialog.setWindowTitle("About");
+                         dialog.setFixedSize(400, 150);
+
+                         QHBoxLayout *hbox = new QHBoxLayout();
+                         hbox->addWidget(gifLabel, 0, Qt::AlignLeft | Qt::AlignVCenter);
+                         hbox->addSpacing(10);
+                         hbox->addWidget(infoLabel, 1, Qt::AlignCenter);
+                         dialog.setLayout(hbox);
+                         dialog.exec(); });
+
+    QObject::connect(openFolderAction, &QAction::triggered, []()
+                     {
+                         QString programPath = QCoreApplication::applicationDirPath();
+                         QDesktopServices::openUrl(QUrl::fromLocalFile(programPath)); });
+
+    QObject::connect(thalesAction, &QAction::triggered, []()
+                     {
+                         QFile file(QString(":/res/") + THALES_FILENAME);
+                         QString text = "Could not load text.";
+                         if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+                             text = QTextStream(&file).readAll();
+
+                         QTextBrowser* browser = new QTextBrowser;
+                         browser->setText(text);
+                         browser->setFrameStyle(QFrame::NoFrame);
+                         browser->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+                         browser->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+                         browser->setTextInteractionFlags(Qt::NoTextInteraction);
+                         browser->setStyleSheet("background: palette(window); color: palette(text);");
+
+                         QDialog dialog(mainWindow);
+                         QVBoxLayout* vbox = new QVBoxLayout(&dialog);
+                         vbox->addWidget(browser);
+                         dialog.setWindowTitle("Mouse Thales");
+                         dialog.resize(400, 300);
+                         dialog.exec(); });
+
+    QObject::connect(historyAction, &QAction::triggered, []()
+                     {
+                         HistoryChart *chart = new HistoryChart();
+
+                         QComboBox *series = new QComboBox();
+                         series->addItem("Clicks", 0x1fu);
+                         series->addItem("Scrolls", 0x60u);
+                         for (size_t i = 0; i < Stats::counterCount; ++i)
+                             series->addItem(Stats::counterNames[i], 1u << i);
+
+                         QHBoxLayout *controls = new QHBoxLayout();
+                         controls->addWidget(series);
+                         controls->addStretch(1);
+                         const int64_t day = 86400;
+                         for (auto [name, span] : {std::pair{"Day", day}, std::pair{"Week", 7 * day},
+                                                   std::pair{"Month", 30 * day}, std::pair{"Year", 365 * day}})
+                         {
+                             QPushButton *button = new QPushButton(name);
+                             QObject::connect(button, &QPushButton::clicked, [chart, span]()
+                                              {
+                                                  const int64_t now = QDateTime::currentSecsSinceEpoch();
+                                                  chart->setRange(now - span, now); });
+                             controls->addWidget(button);
+                         }
+                         QPushButton *allButton = new QPushButton("All");
+                         QObject::connect(allButton, &QPushButton::clicked, [chart]()
+                                          {
+                                              // Oldest day with activity, the day rollups are the shortest file
+                                              const int64_t now = QDateTime::currentSecsSinceEpoch();
+                                              int64_t first = now - 86400;
+                                              bool found = false;
+                                              Daemon::scan_history(Stats::RESOLUTION_DAY, INT64_MIN, now, [&](const Stats::Bucket &bucket)
+                                                                   {
+                                                                       if (!found)
+                                                                           first = bucket.start;
+                                                                       found = true; });
+                                              chart->setRange(first, now); });
+                         controls->addWidget(allButton);
+
+                         QDialog dialog(mainWindow);
+                         dialog.setWindowTitle("History");
+                         dialog.resize(700, 320);
+                         QVBoxLayout *vbox = new QVBoxLayout(&dialog);
+                         vbox->addLayout(controls);
+                         vbox->addWidget(chart, 1);
+
+                         QObject::connect(series, &QComboBox::currentIndexChanged, [chart, series](int)
+                                          { chart->setCounters(series->currentData().toUInt()); });
+
+                         // New readings land in the open buckets, reread them while open
+                         QTimer refresh;
+                         QObject::connect(&refresh, &QTimer::timeout, [chart]()
+                                          { chart->refresh(); });
+                         refresh.start(2000);
+                         dialog.exec(); });
+
+    QObject::connect(motionAction, &QAction::triggered, []()
+                     {
+                         QString path = QFileDialog::getOpenFileName(mainWindow, "Analyze motion capture",
+                                                                     QCoreApplication::applicationDirPath(),
+                                                                     "Motion captures (*.txt *.mcol);;All files (*)");
+                         if (path.isEmpty())
+                             return;
+
+                         Motion::Capture capture;
+                         if (!Motion::read_capture(path.toStdString(), capture))
+                         {
+                             QMessageBox::warning(mainWindow, "Error", "Failed to read " + path);
+                             return;
+                         }
+                         std::ostringstream out;
+                         Motion::write_report(out, Motion::analyze(capture));
+
+                         QLabel *reportLabel = new QLabel(QString::fromStdString(out.str()));
+                         reportLabel->setTextFormat(Qt::PlainText);
+                         reportLabel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+                         reportLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+                         QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+                         QDialog dialog(mainWindow);
+                         dialog.setWindowTitle("Motion analysis - " + QFileInfo(path).fileName());
+                         QVBoxLayout *vbox = new QVBoxLayout(&dialog);
+                         vbox->addWidget(reportLabel);
+                         vbox->addWidget(buttons);
+                         QObject::connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+                         dialog.exec(); });
+
+    QObject::connect(diagnosticsAction, &QAction::triggered, []()
+                     {
+                         auto report = []()
+                         {
+                             std::ostringstream out;
+                             Metrics::write_report(out);
+                             return QString::fromStdString(out.str());
+                         };
+
+                         QLabel *reportLabel = new QLabel(report());
+                         reportLabel->setTextFormat(Qt::PlainText);
+                         reportLabel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+                         reportLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+                         QDialogButtonBox *buttons = new QDialogButtonBox();
+                         QPushButton *resetButton = buttons->addButton("Reset", QDialogButtonBox::ResetRole);
+                         QPushButton *printButton = buttons->addButton("Print", QDialogButtonBox::ActionRole);
+                         QPushButton *saveButton = buttons->addButton("Save...", QDialogButtonBox::ActionRole);
+                         buttons->addButton(QDialogButtonBox::Close);
+
+                         QDialog dialog(mainWindow);
+                         dialog.setWindowTitle("Diagnostics");
+                         QVBoxLayout *vbox = new QVBoxLayout(&dialog);
+                         vbox->addWidget(reportLabel);
+                         vbox->addWidget(buttons);
+
+                         // Live while open, the numbers only change once per poll anyway
+                         QTimer refresh;
+                         QObject::connect(&refresh, &QTimer::timeout, [&]()
+                                          { reportLabel->setText(report()); });
+                         refresh.start(1000);
+
+                         QObject::connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+                         QObject::connect(resetButton, &QPushButton::clicked, [&]()
+                                          { Metrics::reset(); reportLabel->setText(report()); });
+                         QObject::connect(printButton, &QPushButton::clicked, []()
+                                          { Metrics::write_report(std::cout); });
+                         QObject::connect(saveButton, &QPushButton::clicked, [&]()
+                                          {
+                                              QString path = QFileDialog::getSaveFileName(&dialog, "Save diagnostics", "mouse_diagnostics.txt");
+                                              if (path.isEmpty())
+                                                  return;
+                                              std::ofstream out(path.toStdString(), std::ios::trunc);
+                                              Metrics::write_report(out);
+                                              if (!out.good())
+                                                  QMessageBox::warning(&dialog, "Error", "Failed to write " + path); });
+                         dialog.exec(); });
+}
+
+static void open_window()
+{
+    if (!mainWindow)
+        build_window();
+    show_stats();
+    mainWindow->show();
+    mainWindow->raise();
+    mainWindow->activateWindow();
+    Gui::guiOpen = true;
+}
+
+void gui_init(QApplication &app, QAction **quitActionOut)
+{
+    Gui::guiOpen = false;
+
+    // Load icons with QString() to ensure proper resource path
+    connectedIcon = new QIcon(QString(":/res/icons/mouse.png"));
+    disconnectedIcon = new QIcon(QString(":/res/icons/mouse_not.png"));
+    if (connectedIcon->isNull() || disconnectedIcon->isNull())
+    {
+        qDebug() << "Warning: One or both icons failed to load.";
+    }
+    app.setWindowIcon(*disconnectedIcon);
+
+    // The tray icon first, the window is built the first time it is opened
+    trayIcon = new QSystemTrayIcon(&app);
+    trayIcon->setIcon(*disconnectedIcon);
+    trayIcon->setToolTip("Not connected");
+
+    // QSystemTrayIcon does not own its menu, and there may never be a window to parent it
+    QMenu *trayMenu = new QMenu();
+    QAction *openAction = new QAction("Open", trayMenu);
+    QAction *quitAction = new QAction("Quit", trayMenu);
+    trayMenu->addAction(openAction);
+    trayMenu->addAction(quitAction);
+    trayIcon->setContextMenu(trayMenu);
+    trayIcon->show();
+    Metrics::startup_mark(Metrics::MILESTONE_TRAY);
+
+    if (quitActionOut)
+        *quitActionOut = quitAction;
+
+    QObject::connect(openAction, &QAction::triggered, []()
+                     { open_window(); });
+
+    // Before the tray icon goes with app, and the window while the application still exists
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, [trayMenu]()
+                     {
+                         trayIcon->setContextMenu(nullptr);
+                         delete trayMenu;
+                         delete mainWindow;
+                         mainWindow = nullptr;
+                         Gui::guiOpen = false; });
+
+    new Gui(app, trayIcon);
+}
+
+void gui_restore_last_reading()
+{
+    // Kept by the daemon in mouse_stats.last and mouse_stats.bin, gray until a new one
+    Stats::Snapshot last;
+    if (Daemon::last_reading(last))
+    {
+        statModel[STAT_LAST_READING].value = last.time;
+        for (size_t i = 0; i < Stats::counterCount; ++i)
+            statModel[i].value = static_cast<int64_t>(last.counters[i]);
+        if (last.currentDpi > 0)
+            statModel[STAT_CURRENT_DPI].value = last.currentDpi;
+        if (last.batteryPercent > 0)
+            statModel[STAT_BATTERY_LEVEL].value = last.batteryPercent;
+    }
+}
\ No newline at end of file
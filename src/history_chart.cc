@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cmath>
+
+#include "include/history_chart.hpp"
+
+namespace Stats
+{
+    int64_t bucket_seconds(Resolution resolution)
+    {
+        switch (resolution)
+        {
+        case RESOLUTION_MINUTE:
+            return 60;
+        case RESOLUTION_HOUR:
+            return 3600;
+        default:
+            return 86400;
+        }
+    }
+
+    Resolution chart_resolution(int64_t from, int64_t to, int width)
+    {
+        const int64_t budget = int64_t(std::max(width, 1)) * bucketsPerColumn;
+        for (int r = RESOLUTION_MINUTE; r < RESOLUTION_DAY; ++r)
+        {
+            if ((to - from) / bucket_seconds(static_cast<Resolution>(r)) <= budget)
+                return static_cast<Resolution>(r);
+        }
+        return RESOLUTION_DAY;
+    }
+
+    void Downsampler::begin(int64_t rangeFrom, int64_t rangeTo, int width, Resolution resolution, uint32_t counterMask)
+    {
+        from = rangeFrom;
+        to = std::max(rangeTo, rangeFrom + 1);
+        bucketLength = bucket_seconds(resolution);
+        mask = counterMask;
+        highest = 0;
+        columns.assign(static_cast<size_t>(std::max(width, 1)), ChartColumn{});
+        columnSeconds = double(to - from) / double(columns.size());
+    }
+
+    void Downsampler::add(const Bucket &bucket)
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i < counterCount; ++i)
+            if (mask & (1u << i))
+                value += bucket.counts[i];
+        if (value == 0)
+            return;
+
+        // Zoomed in past the resolution a bucket spans several columns and is drawn as a step
+        const int64_t end = bucket.start + bucketLength;
+        if (end <= from || bucket.start >= to)
+            return;
+        const auto column = [&](int64_t time)
+        {
+            return std::clamp<int64_t>(static_cast<int64_t>(std::floor(double(time - from) / columnSeconds)), 0,
+                                       static_cast<int64_t>(columns.size()) - 1);
+        };
+        const int64_t first = column(bucket.start);
+        const int64_t last = std::max(first, column(end - 1));
+        for (int64_t c = first; c <= last; ++c)
+        {
+            ChartColumn &target = columns[static_cast<size_t>(c)];
+            target.min = target.buckets ? std::min(target.min, value) : value;
+            target.max = std::max(target.max, value);
+            ++target.buckets;
+        }
+        highest = std::max(highest, value);
+    }
+
+    const std::vector<ChartColumn> &Downsampler::finish()
+    {
+        // Idle buckets are not stored, a column that spans more buckets than it got had a 0
+        const double spanned = columnSeconds / double(bucketLength);
+        for (ChartColumn &column : columns)
+        {
+            if (column.buckets && double(column.buckets) < spanned)
+                column.min = 0;
+        }
+        return columns;
+    }
+}
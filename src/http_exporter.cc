@@ -0,0 +1,198 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "include/http_exporter.hpp"
+
+namespace Metrics
+{
+#ifdef _WIN32
+    using Socket = SOCKET;
+    static constexpr int sendFlags = 0;
+    static void close_socket(Socket s) { closesocket(s); }
+    static int last_error() { return WSAGetLastError(); }
+#else
+    using Socket = int;
+    static constexpr Socket INVALID_SOCKET = -1;
+    static constexpr int SD_BOTH = SHUT_RDWR;
+    static constexpr int sendFlags = MSG_NOSIGNAL;
+    static void close_socket(Socket s) { ::close(s); }
+    static int last_error() { return errno; }
+#endif
+
+    // A client that stops sending mid request is dropped after this long
+    static constexpr int requestTimeoutMs = 2000;
+    static constexpr size_t maxRequestBytes = 8192;
+
+    static bool send_all(Socket s, std::string_view data)
+    {
+        while (!data.empty())
+        {
+            int n = send(s, data.data(), static_cast<int>(data.size()), sendFlags);
+            if (n <= 0)
+                return false;
+            data.remove_prefix(static_cast<size_t>(n));
+        }
+        return true;
+    }
+
+    static void respond(Socket s, const char *status, const char *contentType, const std::string &body)
+    {
+        std::string head = std::string("HTTP/1.1 ") + status + "\r\n" +
+                           "Content-Type: " + contentType + "\r\n" +
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+                           "Connection: close\r\n\r\n";
+        if (send_all(s, head))
+            send_all(s, body);
+    }
+
+    bool HttpExporter::start(uint16_t port, Render renderBody)
+    {
+        stop();
+
+#ifdef _WIN32
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+        {
+            std::cerr << "Failed to start Winsock" << std::endl;
+            return false;
+        }
+#endif
+
+        Socket s = socket(AF_INET, SOCK_STREAM, 0);
+        if (s == INVALID_SOCKET)
+        {
+            std::cerr << "Failed to create metrics socket: error " << last_error() << std::endl;
+            return false;
+        }
+
+        int reuse = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&reuse), sizeof(reuse));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        socklen_t length = sizeof(addr);
+        if (bind(s, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(s, 8) != 0 ||
+            getsockname(s, reinterpret_cast<sockaddr *>(&addr), &length) != 0)
+        {
+            std::cerr << "Failed to listen on 127.0.0.1:" << port << ": error " << last_error() << std::endl;
+            close_socket(s);
+            return false;
+        }
+
+        listener = static_cast<intptr_t>(s);
+        boundPort = ntohs(addr.sin_port);
+        render = std::move(renderBody);
+        stopping = false;
+        thread = std::thread(&HttpExporter::run, this);
+        std::cout << "Serving metrics on http://127.0.0.1:" << boundPort << "/metrics" << std::endl;
+        return true;
+    }
+
+    void HttpExporter::stop()
+    {
+        if (!thread.joinable())
+            return;
+
+        // Wakes the blocking accept()
+        stopping = true;
+        shutdown(static_cast<Socket>(listener), SD_BOTH);
+        close_socket(static_cast<Socket>(listener));
+        thread.join();
+        listener = -1;
+        boundPort = 0;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    void HttpExporter::run()
+    {
+        while (!stopping)
+        {
+            Socket connection = accept(static_cast<Socket>(listener), nullptr, nullptr);
+            if (connection == INVALID_SOCKET)
+            {
+                // Out of descriptors or an aborted handshake, don't spin on it
+                if (!stopping)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            serve(static_cast<intptr_t>(connection));
+            close_socket(connection);
+        }
+    }
+
+    void HttpExporter::serve(intptr_t handle)
+    {
+        Socket s = static_cast<Socket>(handle);
+
+#ifdef _WIN32
+        DWORD timeout = requestTimeoutMs;
+#else
+        timeval timeout{requestTimeoutMs / 1000, (requestTimeoutMs % 1000) * 1000};
+#endif
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+
+        // Only the request line matters, the headers are read to be polite and ignored
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos)
+        {
+            if (request.size() > maxRequestBytes)
+            {
+                respond(s, "431 Request Header Fields Too Large", "text/plain", "");
+                return;
+            }
+            int n = recv(s, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+                return;
+            request.append(buffer, static_cast<size_t>(n));
+        }
+
+        std::string_view line(request.data(), request.find("\r\n"));
+        size_t methodEnd = line.find(' ');
+        size_t pathEnd = line.find(' ', methodEnd + 1);
+        if (methodEnd == std::string_view::npos || pathEnd == std::string_view::npos)
+        {
+            respond(s, "400 Bad Request", "text/plain", "");
+            return;
+        }
+        std::string_view method = line.substr(0, methodEnd);
+        std::string_view path = line.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+        path = path.substr(0, path.find('?'));
+
+        if (path != "/metrics")
+        {
+            respond(s, "404 Not Found", "text/plain", "Try /metrics\n");
+            return;
+        }
+        if (method != "GET")
+        {
+            respond(s, "405 Method Not Allowed", "text/plain", "");
+            return;
+        }
+
+        std::ostringstream body;
+        if (render)
+            render(body);
+        respond(s, "200 OK", "application/openmetrics-text; version=1.0.0; charset=utf-8", body.str());
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "../include/com_port.hpp"
+
+// Binary status frames, negotiated per connection. The client sends 'B' where it would send
+// '1'; firmware that knows the command answers with one STATUS frame, older firmware ignores
+// it (or answers in text) and the client keeps to the text report for that connection.
+//
+//   frame    0xA5 'M', type u8, payload length u16, payload, CRC-16/CCITT-FALSE u16 over
+//            type, length and payload. Integers are little endian.
+//   STATUS   subject u8 (1 mouse, 2 receiver), reserved u8, current DPI u16, battery mV u16,
+//            battery % u8, reserved u8, then the seven counters as u32 in Stats order
+//   CHANGE   changed fields u16 (the FIELD_* masks of response_parser.hpp), then a u32 per
+//            set bit from the lowest. FIELD_BATTERY carries mV | % << 16.
+//
+// 'S' subscribes: the firmware answers with a STATUS frame like 'B' and from then on sends a
+// CHANGE frame whenever a counter moves, until the port is closed. Sending 'S' again gets
+// a fresh STATUS frame without ending the subscription. Firmware without it ignores 'S'.
+//
+// A status poll is 43 bytes instead of the ~380 of the text report, and decoding it is a
+// CRC and a few loads instead of matching every "Key: value" line.
+namespace ComPort
+{
+    enum class Protocol
+    {
+        TEXT,   // '1' and the "Key: value" report
+        BINARY, // 'B' and a STATUS frame
+    };
+
+    constexpr char binaryStatusCommand = 'B';
+    constexpr char subscribeCommand = 'S';
+    constexpr uint8_t frameMagic0 = 0xA5;
+    constexpr uint8_t frameMagic1 = 'M';
+    constexpr uint8_t FRAME_STATUS = 0x01;
+    constexpr uint8_t FRAME_CHANGE = 0x02;
+
+    constexpr size_t frameHeaderSize = 5; // magic, type, length
+    constexpr size_t frameTrailerSize = 2; // CRC
+    constexpr size_t statusPayloadSize = 36;
+    constexpr size_t statusFrameSize = frameHeaderSize + statusPayloadSize + frameTrailerSize;
+
+    uint16_t crc16(std::string_view bytes);
+
+    // FrameReader::LengthFn: whole frame length from its header, 0 if it is not a frame start
+    size_t binary_frame_length(std::string_view header);
+    // FRAME_STATUS, FRAME_CHANGE, ... of a whole frame
+    inline uint8_t frame_type(std::string_view frame) { return static_cast<uint8_t>(frame[2]); }
+
+    std::string encode_status_frame(const MouseStatus &status, Subject subject);
+
+    // Fills status from a whole STATUS frame and returns the fields it set, the same masks
+    // parse_line() reports. FIELD_NONE if the CRC, type or size is wrong.
+    uint32_t decode_status_frame(std::string_view frame, MouseStatus &status);
+
+    // The fields of after that differ from before, empty if none did
+    std::string encode_change_frame(const MouseStatus &before, const MouseStatus &after, Subject subject);
+    // Applies a CHANGE frame to status and returns the fields it changed, FIELD_NONE if the
+    // frame is bad
+    uint32_t decode_change_frame(std::string_view frame, MouseStatus &status);
+}
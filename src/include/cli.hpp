@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Command line modes that run instead of the tray application
+namespace Cli
+{
+    // --motion-capture <file>: streams motion data from the mouse ('2') into a text log in the
+    // same format scripts/1.read_mouse_motion_data.py writes, or a columnar file if the name
+    // ends in .mcol. port may be empty to autodetect.
+    int motion_capture(const std::wstring &port, const std::string &outputPath);
+
+    // --motion-replay <file>: decodes a saved capture (text or .mcol) and reports what it contains
+    int motion_replay(const std::string &path);
+
+    // --motion-ingest <archive.mcol> <capture.txt | dir>... [--threads N]: text captures, and
+    // the *.txt files of directories, decoded in parallel into one archive
+    int motion_ingest(const std::string &archivePath, const std::vector<std::string> &inputs, unsigned threads);
+
+    // --motion-convert <in.txt> <out.mcol>: text capture to the columnar format
+    int motion_convert(const std::string &textPath, const std::string &columnarPath);
+
+    // --motion-analyze <file>: velocity, jitter, filter deltas and x_cond/y_cond rates of a saved
+    // capture (text or .mcol)
+    int motion_analyze(const std::string &path);
+
+    // --export-stats <mouse_stats.bin> <out.csv>: counter history in the old mouse_stats.txt layout
+    int export_stats(const std::string &storePath, const std::string &csvPath);
+
+    // --stats-rollup <mouse_stats.bin> <minute|hour|day> [days]: how much every counter went up
+    // per minute, hour or day over the last days (7), as CSV from the rollups, which are built
+    // from the history first if they do not exist yet
+    int stats_rollup(const std::string &storePath, const std::string &resolution, int days);
+}
@@ -1,12 +1,18 @@
 #pragma once
+#include <atomic>
 #include <expected>
 #include <functional>
 #include <inttypes.h>
 #include <iostream>
-#include <regex>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #include "../include/com_port.hpp"
 
@@ -41,21 +47,56 @@ namespace ComPort
         int current_dpi = 0;
     };
 
-    static HANDLE hSerial = INVALID_HANDLE_VALUE;
+    // One attached mouse or receiver
+    struct DeviceInfo
+    {
+        std::wstring port;
+        std::string serial; // USB serial number, empty if the device has none
+        Subject subject = Subject::NONE;
+    };
+
+    // The USB serial number, else the file name of the port (ttyACM0, COM3)
+    std::string device_name(const DeviceInfo &info);
+
+    class Transport;
+
     extern Subject connectedTo;
     extern bool (*read_data_X)(MouseStatus &status);
-    static bool ret = false;
 
     static const std::wstring receiverVidPid = L"VID_2FE3&PID_0002&REV_0303";
     static const std::wstring mouseVidPid = L"VID_2FE3&PID_0003&REV_0303";
     static const std::wstring receiverDescription = L"Cool mouse receiver";
     static const std::wstring mouseDescription = L"Cool mouse";
 
+    // Every attached mouse and receiver, sorted by port
+    bool detectAllDevices(std::vector<DeviceInfo> &devices);
+    // Whether known.port is still there and its USB ids say it is known.subject, with
+    // known.serial if that is set, without opening the port or listing the others.
+    // On Windows a device without a serial number cannot be looked up and never matches.
+    bool portMatches(const DeviceInfo &known);
+    // The first mouse and the first receiver of detectAllDevices() to answer the identification
+    // handshake, all of them probed at once
     bool detectDevices(std::wstring& mouseComPort, std::wstring& receiverComPort);
     bool connect(Subject targetSubject, std::wstring comPortName);
+    // Talks to targetSubject over any transport, e.g. a simulator on a MemoryTransport
+    bool attach(Subject targetSubject, std::unique_ptr<Transport> transport);
     void disconnect();
     bool set_device(Subject &subject);
     bool read_data_mouse(MouseStatus &status);
     bool read_data_receiver(MouseStatus &status);
     void print_status(MouseStatus &status);
+
+    // Sends '2' to the mouse and hands every line of the motion stream to onLine, until the
+    // mouse has been quiet for idleTimeoutMs or stop is set. Lines are views into the receive ring.
+    bool stream_motion(const std::function<void(std::string_view)> &onLine, int idleTimeoutMs,
+                       const std::atomic<bool> &stop);
+
+#ifndef _WIN32
+    // Linux: one epoll loop serves the serial port and the udev hotplug monitor,
+    // onHotplug runs on the loop thread whenever a tty is added or removed
+    bool startEventLoop(std::function<void()> onHotplug);
+    // Joins the loop thread. Opening a port starts the loop too, so whatever opened one calls
+    // this before main() returns.
+    void stopEventLoop();
+#endif
 }
\ No newline at end of file
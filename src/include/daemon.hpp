@@ -0,0 +1,50 @@
+#pragma once
+#include <functional>
+#include <string>
+
+#include "../include/reading.hpp"
+#include "../include/rollup.hpp"
+#include "../include/stats_store.hpp"
+
+// Everything but the window: hotplug monitoring, the device manager and the counter history.
+// Qt free, the tray application runs it behind its window and mouse_clientd or
+// mouse_client --headless run it on its own.
+namespace Daemon
+{
+    struct Options
+    {
+        std::wstring mousePort, receiverPort; // --mouse-port / --receiver-port, skip detection
+        std::string historyDir;               // --history-dir, a history file per mouse
+        std::string statsDir;                 // mouse_stats.bin and .last of the shown mouse, executable_dir() if empty
+        uint16_t metricsPort = 0;             // --metrics-port, OpenMetrics on 127.0.0.1, off if 0
+        bool binaryProtocol = true;           // --text-protocol turns it off
+        bool subscribe = true;                // --no-subscribe polls even devices that can push changes
+    };
+
+    // Readings of the shown device, the first mouse else the first receiver, and a
+    // disconnected Reading when it goes away. Runs on the daemon threads.
+    using OnReading = std::function<void(const ComPort::Reading &)>;
+
+    // Consumes the daemon's flags at argv[i], advancing i past their values. False if
+    // argv[i] is not one of them.
+    bool parse_option(int argc, char *argv[], int &i, Options &options);
+
+    // Opens mouse_stats.bin in options.statsDir, importing mouse_stats.txt on the first start
+    bool open_stats(const Options &options);
+    // Latest stored reading for the window to show before the first poll
+    bool last_reading(Stats::Snapshot &snapshot);
+    // Rollup buckets of the shown mouse overlapping [from, to], oldest first, for the history
+    // chart. False if there are no rollups.
+    bool scan_history(Stats::Resolution resolution, int64_t from, int64_t to,
+                      const std::function<void(const Stats::Bucket &)> &onBucket);
+
+    void start(const Options &options, OnReading onReading);
+    // Joins every daemon thread and closes the devices and the history
+    void stop();
+
+    // start() without a window, until SIGINT or SIGTERM (Ctrl+C or closing the console on Windows)
+    int run_headless(const Options &options);
+
+    // Where the executable lives, the default statsDir
+    std::string executable_dir();
+}
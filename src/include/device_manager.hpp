@@ -0,0 +1,181 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <set>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../include/binary_protocol.hpp"
+#include "../include/com_port.hpp"
+#include "../include/frame_reader.hpp"
+#include "../include/reading.hpp"
+#include "../include/rollup.hpp"
+#include "../include/stats_store.hpp"
+#include "../include/transport.hpp"
+
+// Polls any number of mice and receivers from one thread. Every device is a small state
+// machine (idle, waiting for the first byte, receiving) driven by input notifications from
+// its transport and by deadlines, so nothing blocks on a single device and an idle device
+// costs nothing but its buffers.
+//
+// Devices that accept 'S' push their changes instead and are only asked again after a long
+// silence. Their changes are coalesced: OnReading sees a device at most every readingInterval,
+// its history and the persisted snapshot at most every pollPeriod, the same as when polling.
+namespace ComPort
+{
+    class DeviceManager
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Options
+        {
+            std::chrono::milliseconds pollPeriod{2000};
+            std::string historyDir; // a Stats::Store and its Stats::Rollups per mouse in here, none if empty
+            bool binaryProtocol = true; // offer 'B' first, false to always poll with '1'
+            bool subscribe = true;      // offer 'S' to binary devices, false to keep polling them
+            std::chrono::milliseconds readingInterval{100}; // pushed changes reach OnReading at most this often
+            std::chrono::milliseconds resyncPeriod{30000};  // a subscribed device quiet this long is sent 'S' again
+            // A subscribed device whose transport cannot notify (Windows) is read this often,
+            // its changes wait in the driver's buffer meanwhile
+            std::chrono::milliseconds subscribedReadInterval{250};
+            bool log = true; // progress lines on stdout, false to keep them out of e.g. a benchmark's output
+        };
+
+        // Both run on the manager thread
+        using OnReading = std::function<void(const DeviceInfo &, const Reading &)>;
+        using OnLost = std::function<void(const DeviceInfo &)>; // transport failed, device dropped
+        // The protocol a device turned out to speak, worth handing to add() when it comes back
+        using OnNegotiated = std::function<void(const DeviceInfo &, Protocol)>;
+
+        explicit DeviceManager(const Options &options) : options(options) {}
+        ~DeviceManager() { stop(); }
+
+        void start(OnReading onReading, OnLost onLost, OnNegotiated onNegotiated = nullptr);
+        // Joins the thread and closes every transport
+        void stop();
+
+        // From any thread. A device already known under the same port is replaced. With the
+        // protocol it spoke last time it is not negotiated again.
+        void add(const DeviceInfo &info, std::unique_ptr<Transport> transport,
+                 std::optional<Protocol> protocol = std::nullopt);
+        void remove(const std::wstring &port);
+        // Polls every idle device now instead of at its next period
+        void poll_now();
+
+        std::set<std::wstring> ports() const;
+
+    private:
+        enum class State
+        {
+            IDLE,
+            WAITING,    // '1', 'B' or 'S' sent, nothing back yet
+            RECEIVING,  // response coming in
+            SUBSCRIBED, // 'S' answered, changes arrive as they happen
+        };
+
+        struct Device
+        {
+            Device(const DeviceInfo &info, std::unique_ptr<Transport> transport, Protocol protocol)
+                : info(info), transport(std::move(transport)), protocol(protocol),
+                  rx(protocol == Protocol::BINARY ? FrameReader(frameHeaderSize, binary_frame_length) : FrameReader("\n")) {}
+
+            DeviceInfo info;
+            std::unique_ptr<Transport> transport;
+            bool notifies = false;
+            Protocol protocol;
+            bool negotiated = false; // a STATUS frame came back, no more falling back to text
+            bool subscribing = false; // the request in flight is 'S'
+            bool subscribed = false;  // 'S' was answered on this connection
+            bool noSubscribe = false; // 'S' went unanswered, polled with 'B' from now on
+            FrameReader rx;
+            MouseStatus status;
+            std::unique_ptr<Stats::Store> history;
+            std::unique_ptr<Stats::Rollups> rollups;
+
+            State state = State::IDLE;
+            uint32_t timerGeneration = 0; // timers of older generations are stale
+            Clock::time_point scheduledFor{}; // deadline of the current generation
+            Clock::time_point lastRead{};     // of a device whose transport cannot notify
+            uint32_t found = 0;
+            Clock::time_point pollStart, sent, firstByte, lastByte;
+            Clock::duration parseTime{};
+            uint64_t pollStartNs = 0;
+
+            // Subscribed only
+            Clock::time_point resyncSent{}; // unanswered 'S' of a resync, zero if none
+            Clock::time_point lastReading{}, lastPersist{};
+            bool readingDue = false, persistDue = false; // changes not reported yet
+            uint64_t changedAtNs = 0;                    // arrival of the oldest of them
+        };
+
+        struct Timer
+        {
+            Clock::time_point deadline;
+            uint32_t id;
+            uint32_t generation;
+            bool operator>(const Timer &other) const { return deadline > other.deadline; }
+        };
+
+        // add() and remove() in the order they were called, transport is null for a removal
+        struct Command
+        {
+            uint32_t id;
+            DeviceInfo info;
+            std::unique_ptr<Transport> transport;
+            std::optional<Protocol> protocol;
+        };
+
+        void run();
+        void wake(uint32_t id);
+        void attach(Command &command);
+        void detach(uint32_t id);
+        Clock::time_point next_polled_read() const;
+        bool polled_read_due(const Device &device, Clock::time_point now) const;
+        void schedule(uint32_t id, Device &device, Clock::time_point deadline);
+        void start_poll(uint32_t id, Device &device);
+        void service(uint32_t id, Device &device);
+        void on_deadline(uint32_t id, Device &device);
+        void finish_poll(uint32_t id, Device &device);
+        void lose(uint32_t id, Device &device);
+        void fall_back_to_text(uint32_t id, Device &device);
+        void parse_frames(Device &device);
+        void on_subscribed_deadline(uint32_t id, Device &device);
+        void schedule_subscribed(uint32_t id, Device &device, Clock::time_point now);
+        void report(Device &device, Clock::time_point now, bool force);
+        void append_history(Device &device, int64_t time);
+        static void mark_changed(Device &device);
+
+        Options options;
+        OnReading onReading;
+        OnLost onLost;
+        OnNegotiated onNegotiated;
+        std::thread thread;
+
+        // Shared with other threads
+        mutable std::mutex mutex;
+        std::condition_variable cv;
+        bool running = false;
+        bool stopping = false;
+        bool pollAll = false;
+        uint32_t nextId = 1;
+        std::vector<uint32_t> ready;
+        std::vector<Command> commands;
+        std::set<std::wstring> known;
+
+        // Manager thread only
+        std::unordered_map<uint32_t, Device> devices;
+        std::unordered_map<std::wstring, uint32_t> byPort;
+        std::vector<uint32_t> polled; // devices whose transport cannot notify
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../include/binary_protocol.hpp"
+#include "../include/com_port.hpp"
+#include "../include/frame_reader.hpp"
+#include "../include/transport.hpp"
+
+// The firmware's commands on top of any transport
+namespace ComPort
+{
+    // A response is complete once every expected field arrived. Firmware that sends less
+    // is caught by these: wait this long for the first byte, then for the line to go quiet.
+    constexpr int firstByteTimeoutMs = 1000;
+    constexpr int interByteTimeoutMs = 50;
+    // Firmware that knows 'S' or 'B' answers it at once, this much silence means it does not
+    constexpr int negotiateTimeoutMs = 250;
+    // How long discovery gives a port to answer identify()
+    constexpr int probeTimeoutMs = 500;
+
+    // Sends '1' and parses the "Key: value" report into status, false if the transport failed.
+    // With Protocol::BINARY it sends 'B' and decodes a STATUS frame instead, rx must then
+    // be a length-prefixed reader over binary_frame_length().
+    bool query_status(Transport &transport, FrameReader &rx, Subject subject, MouseStatus &status,
+                      Protocol protocol = Protocol::TEXT);
+
+    // Sends '1' and waits up to timeoutMs for a line the report parser knows, then for the rest
+    // of the report to pass, so the next command starts on a quiet line. Returns what answered,
+    // told apart by the fields only the mouse reports, or NONE if nothing of the firmware's came
+    // back, i.e. the port is something else or the device is not answering.
+    Subject identify(Transport &transport, int timeoutMs);
+    // Same, giving up with NONE as soon as stop is set
+    Subject identify(Transport &transport, int timeoutMs, const std::atomic<bool> &stop);
+
+    // Runs on the probing thread of a port as soon as it answered, with the port still open.
+    // Calls are one at a time. Returning false says nothing more is wanted.
+    using OnProbed = std::function<bool(const DeviceInfo &, std::unique_ptr<Transport>)>;
+    using PortOpener = std::function<std::unique_ptr<Transport>(const std::wstring &port)>;
+
+    // Opens every candidate at once and identifies each on its own thread, so the devices on a
+    // host with many serial ports answer within one round trip and the ports that stay silent
+    // cost one timeout in total instead of one each. Ports that do not answer, or answer as
+    // something other than the candidate's subject, are closed.
+    // Returns how many answered, once all of them are done or onFound returned false; the
+    // probes still running then give up within a few milliseconds and close their ports,
+    // every probing thread is joined before the return.
+    size_t probe_ports(const std::vector<DeviceInfo> &candidates, int timeoutMs, const OnProbed &onFound,
+                       const PortOpener &open = open_serial_transport);
+
+    // Sends '2' and hands every line of the motion stream to onLine, until the mouse has been
+    // quiet for idleTimeoutMs or stop is set
+    bool stream_motion(Transport &transport, FrameReader &rx, const std::function<void(std::string_view)> &onLine,
+                       int idleTimeoutMs, const std::atomic<bool> &stop);
+}
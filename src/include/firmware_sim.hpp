@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "../include/com_port.hpp"
+#include "../include/transport.hpp"
+
+// Stands in for the mouse and receiver firmware on the other end of a transport
+namespace Sim
+{
+    struct Options
+    {
+        ComPort::Subject personality = ComPort::Subject::MOUSE;
+        size_t responseBytes = 0;       // pad the '1' report with filler lines up to about this size
+        int latencyMs = 0;              // before the first byte of every response
+        int jitterMs = 0;               // plus up to this much, uniformly distributed
+        int baud = 115200;              // 8N1 line rate the output is paced at, 0 = as fast as possible
+        int motionBlocksPerSecond = 500; // '2' stream rate, 0 = as fast as the line allows
+        bool binaryProtocol = true;     // answer 'B' with a STATUS frame, false to ignore it like older firmware
+        bool subscribe = true;          // answer 'S' and push changes, false to ignore it
+        double clicksPerSecond = 2;     // activity while subscribed, Poisson distributed
+        uint32_t seed = 1;
+    };
+
+    class FirmwareSim
+    {
+    public:
+        FirmwareSim(ComPort::Transport &transport, const Options &options);
+
+        // Answers commands until stop is set or the transport hangs up
+        void run(const std::atomic<bool> &stop);
+
+        // The reply to '1' with the current counters, also handy as benchmark input
+        std::string status_report() const;
+        // The reply to 'B'
+        std::string status_frame() const;
+
+        // The next block of the '2' stream
+        std::string motion_block();
+
+        uint64_t requests() const { return requestCount; }
+        uint64_t bytes_sent() const { return sentBytes; }
+
+    private:
+        void answer(char command, const std::atomic<bool> &stop);
+        void use_mouse();
+        void click();
+        void schedule_click();
+        void stream_motion(const std::atomic<bool> &stop);
+        void respond_delay();
+        bool send_paced(std::string_view bytes);
+
+        ComPort::Transport &transport;
+        Options options;
+        std::mt19937 rng;
+
+        ComPort::MouseStatus status;
+        uint32_t motionBlock = 0;
+        int16_t motionX = 0;
+        int16_t motionY = 0;
+        uint64_t requestCount = 0;
+        uint64_t sentBytes = 0;
+
+        bool subscribed = false;
+        std::chrono::steady_clock::time_point nextClick{};
+
+        // Line pacing, bytes go out no faster than baud / 10 per second
+        std::chrono::steady_clock::time_point lineFreeAt{};
+    };
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace ComPort
+{
+    // Byte ring with a power of two capacity. Serial reads land directly in write_span(),
+    // frames are handed out as views into the ring so nothing is copied on the way to the parser.
+    class RingBuffer
+    {
+    public:
+        explicit RingBuffer(size_t capacity);
+
+        size_t size() const { return tail - head; }
+        size_t capacity() const { return mask + 1; }
+        bool full() const { return size() == capacity(); }
+
+        // Largest contiguous free region at the write position, then commit() what was filled
+        std::span<char> write_span();
+        void commit(size_t n) { tail += n; }
+
+        // Offset of the first occurrence of needle at or after from, or npos
+        size_t find(std::string_view needle, size_t from) const;
+
+        // First n buffered bytes as one contiguous view, rotates the storage if they wrap
+        std::string_view view(size_t n);
+
+        void consume(size_t n) { head += n; }
+        void clear() { head = tail = 0; }
+
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+    private:
+        char at(size_t offset) const { return data[(head + offset) & mask]; }
+
+        std::unique_ptr<char[]> data;
+        size_t mask;
+        size_t head = 0; // both indexes grow monotonically and are masked on access
+        size_t tail = 0;
+    };
+
+    // Splits the byte stream of a connection into frames, either ending with a terminator
+    // or carrying their own length in a fixed size header
+    class FrameReader
+    {
+    public:
+        // Returns the whole frame length announced by header, 0 if header is not a valid start
+        using LengthFn = size_t (*)(std::string_view header);
+
+        explicit FrameReader(std::string_view terminator, size_t capacity = 4096);
+        FrameReader(size_t headerSize, LengthFn frameLength, size_t capacity = 4096);
+
+        std::span<char> write_span() { return ring.write_span(); }
+        void commit(size_t n) { ring.commit(n); }
+
+        // Next complete frame without its terminator. The view stays valid until the next call
+        // to next_frame(), take_partial() or reset(). A frame that cannot fit in the ring is
+        // returned cut at capacity and flagged by truncated().
+        bool next_frame(std::string_view &frame);
+
+        // Whatever is left of an unterminated frame, used once the line went quiet
+        std::string_view take_partial();
+
+        bool truncated() const { return lastTruncated; }
+        size_t buffered() const { return ring.size() - pending; }
+        uint64_t truncated_frames() const { return truncatedCount; }
+        uint64_t dropped_bytes() const { return droppedCount; }
+
+        void reset();
+
+    private:
+        void release_pending();
+
+        RingBuffer ring;
+        std::string terminator;
+        size_t headerSize = 0;
+        LengthFn frameLength = nullptr;
+
+        size_t pending = 0; // bytes of the frame handed out last, consumed on the next call
+        size_t scanned = 0; // terminator search resumes here
+        bool lastTruncated = false;
+        uint64_t truncatedCount = 0;
+        uint64_t droppedCount = 0;
+    };
+}
@@ -2,17 +2,23 @@
 #pragma once
 #include <QMainWindow>
 #include <QApplication>
+#include <QLabel>
 #include <QObject>
+#include <QWidget>
+#include <vector>
 #include "../include/com_port.hpp" // adjust include if needed
+#include "../include/history_chart.hpp"
+#include "../include/reading.hpp"
 
 class Gui : public QObject
 {
 public:
     Gui(QApplication &app, QObject *parent = nullptr);
     ~Gui();
-    static void updateGui(ComPort::MouseStatus &data, bool connected);
+    // Safe from any thread: stores the reading and queues at most one repaint on the GUI thread
+    static void publish(const ComPort::Reading &reading);
+    static void updateGui(const ComPort::Reading &reading);
     static bool guiOpen;
-    static QString lastReadingTime;
 
 private:
     QApplication &app;
@@ -28,4 +34,73 @@ protected:
     void closeEvent(QCloseEvent *event) override;
 };
 
+// One value of the stats window. It keeps the value it shows and only formats it again when
+// the value changed; live, stale and alert only switch the palette and the weight of the font.
+class StatCell : public QLabel
+{
+public:
+    enum Format
+    {
+        FORMAT_NUMBER,
+        FORMAT_PERCENT,
+        FORMAT_TIME // unix seconds
+    };
+
+    enum State
+    {
+        STATE_STALE, // gray, the last known value
+        STATE_LIVE,
+        STATE_ALERT // red
+    };
+
+    static constexpr int64_t noValue = -1; // shown as "-"
+
+    explicit StatCell(Format format, QWidget *parent = nullptr);
+
+    void display(int64_t value, State state);
+
+private:
+    Format format;
+    int64_t value = noValue;
+    State state = STATE_STALE;
+};
+
+// Counters of the shown mouse over any range, a min/max column per pixel from the rollups.
+// Wheel zooms around the cursor, dragging pans, a range that ends now follows it.
+class HistoryChart : public QWidget
+{
+public:
+    explicit HistoryChart(QWidget *parent = nullptr);
+
+    void setRange(int64_t from, int64_t to);
+    // mask picks the counters summed, bit n for Stats::counterNames[n]
+    void setCounters(uint32_t mask);
+    // Rereads the rollups, moving a range that ends now along with it
+    void refresh();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    QRect plotArea() const;
+    void load(int width);
+
+    int64_t from = 0, to = 0;
+    bool following = true;
+    uint32_t mask = 0x1f;
+    Stats::Resolution resolution = Stats::RESOLUTION_MINUTE;
+    Stats::Downsampler downsampler;
+    std::vector<Stats::ChartColumn> columns;
+    uint64_t peak = 0;
+    bool stale = true;
+    int dragX = 0;
+    int64_t dragFrom = 0, dragTo = 0;
+};
+
+// Shows the tray icon, the window is only built when it is first opened
 void gui_init(QApplication &app, QAction **quitActionOut);
+// The stored last reading for the window, after Daemon::open_stats() and before Daemon::start()
+void gui_restore_last_reading();
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "../include/rollup.hpp"
+
+// Level of detail for the history chart. The minute, hour and day rollups are the pyramid:
+// a range is drawn from the finest of them that has at most a few buckets per pixel column,
+// and those buckets are reduced to one min/max column per pixel as they stream past. What a
+// redraw reads and keeps is bounded by the chart width, not by the length of the history.
+namespace Stats
+{
+    constexpr int bucketsPerColumn = 4;
+
+    // Nominal length of a bucket, days are 23 or 25 hours twice a year
+    int64_t bucket_seconds(Resolution resolution);
+
+    // The finest resolution that draws [from, to) width pixels wide
+    Resolution chart_resolution(int64_t from, int64_t to, int width);
+
+    struct ChartColumn
+    {
+        uint64_t min = 0; // per bucket of the resolution, 0 where a bucket saw no activity
+        uint64_t max = 0;
+        uint32_t buckets = 0; // with activity
+    };
+
+    class Downsampler
+    {
+    public:
+        // counterMask picks the counters summed per bucket, bit n for counter n
+        void begin(int64_t from, int64_t to, int width, Resolution resolution, uint32_t counterMask);
+        void add(const Bucket &bucket);
+        // The columns, left to right
+        const std::vector<ChartColumn> &finish();
+
+        uint64_t peak() const { return highest; }
+
+    private:
+        int64_t from = 0, to = 0;
+        int64_t bucketLength = 60;
+        double columnSeconds = 1;
+        uint32_t mask = 0;
+        uint64_t highest = 0;
+        std::vector<ChartColumn> columns;
+    };
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <thread>
+
+namespace Metrics
+{
+    // Serves GET /metrics on 127.0.0.1 only, one connection at a time from its own thread.
+    // render writes the body for every scrape on that thread, so it should only read state
+    // that is already in memory.
+    class HttpExporter
+    {
+    public:
+        using Render = std::function<void(std::ostream &)>;
+
+        HttpExporter() = default;
+        ~HttpExporter() { stop(); }
+        HttpExporter(const HttpExporter &) = delete;
+        HttpExporter &operator=(const HttpExporter &) = delete;
+
+        // port 0 picks a free one, see port()
+        bool start(uint16_t port, Render render);
+        void stop();
+
+        uint16_t port() const { return boundPort; }
+
+    private:
+        void run();
+        void serve(intptr_t connection);
+
+        Render render;
+        std::thread thread;
+        std::atomic<bool> stopping = false;
+        intptr_t listener = -1;
+        uint16_t boundPort = 0;
+    };
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+
+#include "../include/live_ring.hpp"
+#include "../include/motion_capture.hpp"
+#include "../include/reading.hpp"
+
+namespace Live
+{
+    // Writer side of the live region. Status and motion each take one publishing thread, they
+    // may be in different processes (the daemon and --motion-capture).
+    class Publisher
+    {
+    public:
+        Publisher() = default;
+        ~Publisher() { close(); }
+        Publisher(const Publisher &) = delete;
+        Publisher &operator=(const Publisher &) = delete;
+
+        // Creates the region, or attaches to the one of an earlier run and continues its rings
+        bool open();
+        void close();
+        bool is_open() const { return region != nullptr; }
+
+        void publish(const ComPort::DeviceInfo &info, const ComPort::Reading &reading);
+        // Sample index of capture
+        void publish(const Motion::Capture &capture, size_t index);
+
+    private:
+        Region *region = nullptr;
+#ifdef _WIN32
+        void *mapping = nullptr;
+#endif
+    };
+}
@@ -0,0 +1,256 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Live readings for other local processes, published through shared memory
+//
+//   region   "Local\mouse_client_live" on Windows, /dev/shm/mouse_client_live on Linux
+//   header   magic, layout version and region size, checked by readers before anything else
+//   rings    one for status readings of every device, one for motion samples. Each slot is a
+//            seqlock (see seqlock.hpp): odd while the writer fills it, 2n + 2 once it holds
+//            record n. head counts the records ever published.
+//
+// The writer never waits for readers. A reader that falls more than a ring behind skips
+// ahead and counts what it missed. Readers map the region read-only and need nothing but this
+// header, no library and no system call per record.
+namespace Live
+{
+    constexpr uint32_t magic = 0x56494C4D; // "MLIV"
+    constexpr uint32_t version = 1;
+#ifdef _WIN32
+    constexpr const char *regionName = "Local\\mouse_client_live";
+#else
+    constexpr const char *regionName = "/mouse_client_live";
+#endif
+
+    enum Subject : uint8_t
+    {
+        SUBJECT_NONE,
+        SUBJECT_MOUSE,
+        SUBJECT_RECEIVER,
+    };
+
+    // One poll of one device
+    struct StatusRecord
+    {
+        int64_t time = 0;          // unix seconds
+        uint64_t polled_at_ns = 0; // steady clock of the poll start, for latency measurements
+        uint64_t left_clicks = 0;
+        uint64_t right_clicks = 0;
+        uint64_t middle_clicks = 0;
+        uint64_t backward_clicks = 0;
+        uint64_t forward_clicks = 0;
+        uint64_t downward_scrolls = 0;
+        uint64_t upward_scrolls = 0;
+        int32_t battery_mv = 0;
+        int32_t battery_percent = 0;
+        int32_t current_dpi = 0;
+        uint8_t subject = SUBJECT_NONE;
+        uint8_t reserved[3] = {};
+        char device[32] = {}; // USB serial number or port name, NUL terminated
+    };
+
+    // One block of the motion stream ('2'), the columns of Motion::Capture
+    struct MotionRecord
+    {
+        uint32_t block = 0;
+        int16_t before_x = 0;
+        int16_t before_y = 0;
+        int16_t after_x = 0;
+        int16_t after_y = 0;
+        uint8_t x_cond = 0;
+        uint8_t y_cond = 0;
+        uint16_t reserved = 0;
+    };
+
+    template <typename T, uint32_t N>
+        requires std::is_trivially_copyable_v<T>
+    struct Ring
+    {
+        static constexpr uint32_t slots = N;
+        static constexpr size_t wordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        struct Slot
+        {
+            std::atomic<uint64_t> sequence;
+            std::atomic<uint64_t> words[wordCount];
+        };
+
+        alignas(64) std::atomic<uint64_t> head;
+        alignas(64) Slot ring[N];
+
+        // Single writer
+        void push(const T &value)
+        {
+            uint64_t raw[wordCount] = {};
+            std::memcpy(raw, &value, sizeof(T));
+
+            const uint64_t n = head.load(std::memory_order_relaxed);
+            Slot &slot = ring[n % N];
+            slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < wordCount; ++i)
+                slot.words[i].store(raw[i], std::memory_order_relaxed);
+            slot.sequence.store(2 * n + 2, std::memory_order_release);
+            head.store(n + 1, std::memory_order_release);
+        }
+
+        // Record cursor into value and advances cursor, false once it caught up with the
+        // writer. Records overwritten before they were read are skipped and added to missed.
+        bool pop(uint64_t &cursor, T &value, uint64_t &missed) const
+        {
+            for (;;)
+            {
+                const uint64_t published = head.load(std::memory_order_acquire);
+                if (cursor > published)
+                    cursor = published; // the writer started over
+                if (cursor == published)
+                    return false;
+                if (published - cursor > N)
+                {
+                    missed += published - N - cursor;
+                    cursor = published - N;
+                }
+
+                const Slot &slot = ring[cursor % N];
+                const uint64_t expected = 2 * cursor + 2;
+                uint64_t raw[wordCount];
+                if (slot.sequence.load(std::memory_order_acquire) == expected)
+                {
+                    for (size_t i = 0; i < wordCount; ++i)
+                        raw[i] = slot.words[i].load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (slot.sequence.load(std::memory_order_relaxed) == expected)
+                    {
+                        std::memcpy(&value, raw, sizeof(T));
+                        ++cursor;
+                        return true;
+                    }
+                }
+                // Lapped while reading this slot, look at head again
+                ++missed;
+                ++cursor;
+            }
+        }
+    };
+
+    struct Region
+    {
+        std::atomic<uint32_t> magic; // set last by the writer, once the rest is initialised
+        uint32_t version;
+        uint64_t size; // sizeof(Region) of the writer
+        Ring<StatusRecord, 1024> status;
+        Ring<MotionRecord, 16384> motion;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the rings are shared between processes");
+
+    // Maps the region read-only, any number of readers may be open at once
+    class Reader
+    {
+    public:
+        Reader() = default;
+        ~Reader() { close(); }
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        // False if no client is running or it is a different version. Only records published
+        // from now on are returned, latest_status() has the one before.
+        bool open()
+        {
+            close();
+#ifdef _WIN32
+            mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, regionName);
+            if (!mapping)
+                return false;
+            void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(Region));
+#else
+            int fd = shm_open(regionName, O_RDONLY, 0);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < sizeof(Region))
+            {
+                ::close(fd); // from an older, smaller layout
+                return false;
+            }
+            void *view = mmap(nullptr, sizeof(Region), PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (view == MAP_FAILED)
+                view = nullptr;
+#endif
+            region = static_cast<const Region *>(view);
+            if (!region || region->magic.load(std::memory_order_acquire) != magic ||
+                region->version != version || region->size != sizeof(Region))
+            {
+                close();
+                return false;
+            }
+
+            statusCursor = region->status.head.load(std::memory_order_acquire);
+            motionCursor = region->motion.head.load(std::memory_order_acquire);
+            return true;
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            if (region)
+                UnmapViewOfFile(region);
+            if (mapping)
+                CloseHandle(mapping);
+            mapping = nullptr;
+#else
+            if (region)
+                munmap(const_cast<Region *>(region), sizeof(Region));
+#endif
+            region = nullptr;
+        }
+
+        bool is_open() const { return region != nullptr; }
+
+        // Oldest unread record first, false once caught up
+        bool next_status(StatusRecord &record) { return region && region->status.pop(statusCursor, record, missedRecords); }
+        bool next_motion(MotionRecord &record) { return region && region->motion.pop(motionCursor, record, missedRecords); }
+
+        // Newest status record of any device, false if there is none yet
+        bool latest_status(StatusRecord &record) const
+        {
+            if (!region)
+                return false;
+            for (int attempt = 0; attempt < 4; ++attempt)
+            {
+                uint64_t head = region->status.head.load(std::memory_order_acquire);
+                if (head == 0)
+                    return false;
+                uint64_t cursor = head - 1, ignored = 0;
+                if (region->status.pop(cursor, record, ignored) && cursor == head)
+                    return true;
+            }
+            return false;
+        }
+
+        // Records overwritten before this reader got to them
+        uint64_t missed() const { return missedRecords; }
+
+    private:
+        const Region *region = nullptr;
+#ifdef _WIN32
+        HANDLE mapping = nullptr;
+#endif
+        uint64_t statusCursor = 0;
+        uint64_t motionCursor = 0;
+        uint64_t missedRecords = 0;
+    };
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file, pages are only read in when touched
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    const uint8_t *data() const { return base; }
+    size_t size() const { return length; }
+    bool is_open() const { return opened; }
+
+private:
+    const uint8_t *base = nullptr;
+    size_t length = 0;
+    bool opened = false; // an empty file is open but has no mapping
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Where the time of a poll cycle goes. Every stage has a histogram and the failure modes
+// have counters, recording is a few relaxed atomic adds so it stays on in release builds.
+namespace Metrics
+{
+    using Clock = std::chrono::steady_clock;
+
+    enum Stage
+    {
+        STAGE_WRITE,      // sending '1'
+        STAGE_FIRST_BYTE, // sent until the first byte of the response
+        STAGE_LAST_BYTE,  // first byte until the response was complete
+        STAGE_PARSE,      // parse_line over the whole response
+        STAGE_PUBLISH,    // handed to the GUI until the GUI thread picked it up
+        STAGE_RENDER,     // updating the window
+        STAGE_PERSIST,    // history record and snapshot
+        STAGE_CYCLE,      // '1' sent, or a pushed change in, until the window showed the reading
+        STAGE_COUNT
+    };
+
+    enum Counter
+    {
+        COUNTER_POLLS,
+        COUNTER_PUSHED_CHANGES,    // CHANGE frames from subscribed devices
+        COUNTER_TIMEOUTS,          // no first byte within firstByteTimeoutMs
+        COUNTER_TRUNCATED_FRAMES,  // responses that went quiet before every field arrived
+        COUNTER_DROPPED_BYTES,     // over-long lines that did not fit the receive ring
+        COUNTER_CRC_ERRORS,        // binary frames that failed their CRC
+        COUNTER_TRANSPORT_ERRORS,  // send failed or the device hung up
+        COUNTER_RECONNECTS,
+        COUNTER_COALESCED_UPDATES, // readings replaced by a newer one before the GUI drew them
+        COUNTER_MANAGER_WAKEUPS,   // rounds of the DeviceManager thread, none while every device is idle
+        COUNTER_COUNT
+    };
+
+    // Points of one start of the application, timed from startup_begin()
+    enum Milestone
+    {
+        MILESTONE_TRAY,          // tray icon shown
+        MILESTONE_KNOWN_PORT,    // a port from the last run answered again
+        MILESTONE_FIRST_READING, // first reading of the shown device
+        MILESTONE_COUNT
+    };
+
+    // HDR style histogram of nanosecond values: exact below 64, above that 32 linear
+    // sub-buckets per power of two, so any reported value is within about 3% of the truth.
+    // Values past two hours land in the last bucket.
+    class Histogram
+    {
+    public:
+        struct Summary
+        {
+            uint64_t count = 0;
+            uint64_t sum = 0;
+            uint64_t min = 0;
+            uint64_t mean = 0;
+            uint64_t p50 = 0;
+            uint64_t p90 = 0;
+            uint64_t p99 = 0;
+            uint64_t p999 = 0;
+            uint64_t max = 0;
+        };
+
+        void record(uint64_t ns);
+        uint64_t count() const { return total.load(std::memory_order_relaxed); }
+        // Smallest recorded value that at least p percent of the values are not above
+        uint64_t percentile(double p) const;
+        Summary summary() const;
+        void reset();
+
+    private:
+        static constexpr int subBucketBits = 5;
+        static constexpr int maxExponent = 42;
+        static constexpr size_t bucketCount = (2 << subBucketBits) + (maxExponent - subBucketBits) * (1 << subBucketBits);
+
+        static size_t bucket_of(uint64_t ns);
+        static uint64_t highest_in(size_t bucket);
+
+        std::array<std::atomic<uint64_t>, bucketCount> buckets{};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> minimum{UINT64_MAX};
+        std::atomic<uint64_t> maximum{0};
+    };
+
+    Histogram &histogram(Stage stage);
+    const char *stage_name(Stage stage);
+    const char *counter_name(Counter counter);
+
+    inline uint64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    inline void record(Stage stage, Clock::duration elapsed)
+    {
+        histogram(stage).record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    // Between two now_ns() values
+    inline void record(Stage stage, uint64_t startNs, uint64_t endNs)
+    {
+        histogram(stage).record(endNs > startNs ? endNs - startNs : 0);
+    }
+
+    void count(Counter counter, uint64_t n = 1);
+    uint64_t counter(Counter counter);
+
+    // Clears every histogram and counter
+    void reset();
+
+    // Call first thing in main()
+    void startup_begin();
+    // Only the first call per milestone counts, it also logs the time since startup_begin()
+    void startup_mark(Milestone milestone);
+    // 0 while not reached
+    uint64_t startup_ns(Milestone milestone);
+
+    // One line per stage with count and percentiles, then the counters and the startup milestones
+    void write_report(std::ostream &out);
+
+    // The stages as a mouse_client_stage_seconds summary and the counters as
+    // mouse_client_<name>_total, in OpenMetrics text without the closing "# EOF"
+    void write_openmetrics(std::ostream &out);
+}
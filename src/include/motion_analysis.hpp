@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "../include/motion_capture.hpp"
+
+// What the filter in the firmware does to the motion it reports, over decoded captures
+//
+//   velocity      the samples themselves, counts per sensor report
+//   acceleration  the difference of consecutive samples, its RMS is the jitter
+//   filter delta  after - before per axis, how much the filter moved a sample
+//
+// The kernels are SSE2 where the compiler targets it (every x86-64 build) and plain loops
+// elsewhere. Both give the same results, up to the rounding of the mean speeds.
+namespace Motion
+{
+    enum Axis
+    {
+        AXIS_BEFORE_X,
+        AXIS_BEFORE_Y,
+        AXIS_AFTER_X,
+        AXIS_AFTER_Y,
+        AXIS_COUNT
+    };
+
+    enum class Kernels
+    {
+        SCALAR,
+        VECTOR // SCALAR where SSE2 is not available
+    };
+
+    // "SSE2" or "scalar", what Kernels::VECTOR runs on this build
+    const char *vector_kernels();
+
+    struct AxisStats
+    {
+        int16_t min = 0;
+        int16_t max = 0;
+        double mean = 0;
+        double stddev = 0;
+        double accelRms = 0; // jitter
+        uint32_t accelMaxAbs = 0;
+    };
+
+    struct DeltaStats
+    {
+        double meanAbs = 0;
+        uint32_t maxAbs = 0;
+        uint64_t changed = 0; // samples the filter moved
+    };
+
+    // Filter deltas beyond the radius count in the edge bins
+    constexpr int histogramRadius = 8;
+    constexpr int histogramSide = 2 * histogramRadius + 1;
+
+    struct Analysis
+    {
+        uint64_t samples = 0;
+        std::array<AxisStats, AXIS_COUNT> axes{};
+        DeltaStats deltaX, deltaY;
+        uint64_t xCondTriggers = 0, yCondTriggers = 0;
+        double speedBefore = 0, speedAfter = 0; // mean length of the (x, y) motion
+        // [dy + radius][dx + radius], after - before
+        std::array<std::array<uint64_t, histogramSide>, histogramSide> deltaHistogram{};
+    };
+
+    Analysis analyze(const Capture &capture, Kernels kernels = Kernels::VECTOR);
+
+    void write_report(std::ostream &out, const Analysis &analysis);
+
+    // Series for plotting, out is resized to the number of samples
+    void speed(const std::vector<int16_t> &x, const std::vector<int16_t> &y, std::vector<float> &out,
+               Kernels kernels = Kernels::VECTOR);
+    // out[0] is 0
+    void acceleration(const std::vector<int16_t> &v, std::vector<int32_t> &out, Kernels kernels = Kernels::VECTOR);
+    void filter_delta(const std::vector<int16_t> &before, const std::vector<int16_t> &after, std::vector<int32_t> &out,
+                      Kernels kernels = Kernels::VECTOR);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Motion
+{
+    // Decoded motion samples, one array per column so analysis code can stream over them
+    struct Capture
+    {
+        std::vector<uint32_t> block;
+        std::vector<int16_t> before_x;
+        std::vector<int16_t> before_y;
+        std::vector<int16_t> after_x;
+        std::vector<int16_t> after_y;
+        std::vector<uint8_t> x_cond;
+        std::vector<uint8_t> y_cond;
+
+        void reserve(size_t samples);
+        void clear();
+        size_t size() const { return block.size(); }
+    };
+
+    // Turns the text the mouse streams after command '2' into samples:
+    //
+    //   [ 12 ] -------------
+    //    before: |X:11111111-11111101 0xFF-0xFD - Y:00000000-00000011 0x00-0x03
+    //   after:  |X:11111111-11111101 0xFF-0xFD - Y:00000000-00000011 0x00-0x03
+    //   x_cond: 0 - y_cond: 0
+    //
+    // Lines are fed one at a time as they arrive, nothing is allocated per sample
+    // as long as the capture was reserved large enough.
+    class Decoder
+    {
+    public:
+        explicit Decoder(Capture &capture) : capture(capture) {}
+
+        // One line without its terminator
+        void feed_line(std::string_view line);
+
+        // Stores a block the stream ended in the middle of, if it has both readings. A part of
+        // a capture that is not its end (endOfStream false) is cut before the next block instead,
+        // so its open block is incomplete the same way it would be read in one go.
+        void finish(bool endOfStream = true);
+
+        size_t incomplete_blocks() const { return incompleteBlocks; }
+        size_t malformed_lines() const { return malformedLines; }
+
+    private:
+        void store_sample(uint8_t xCond, uint8_t yCond);
+        void flush_block();
+
+        Capture &capture;
+        bool inBlock = false;
+        bool haveBefore = false;
+        bool haveAfter = false;
+        uint32_t block = 0;
+        int16_t beforeX = 0, beforeY = 0, afterX = 0, afterY = 0;
+        size_t incompleteBlocks = 0;
+        size_t malformedLines = 0;
+    };
+
+    // Feeds every line of text, without finish()
+    void decode_text(std::string_view text, Decoder &decoder);
+
+    // Offset of the first line at or after pos that starts a block ("[ n ]"), where a capture
+    // can be split and its parts decoded on their own. text.size() if there is none.
+    size_t next_block_start(std::string_view text, size_t pos);
+
+    // Feeds a whole capture file such as scripts/sample_motion_data/serial_output_*.txt
+    bool decode_file(const std::string &path, Decoder &decoder);
+}
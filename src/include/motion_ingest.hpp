@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Many text captures (serial_output_*.txt) into one .mcol archive at once
+//
+// Every file is split on "[ n ]" block lines into parts of about partBytes, and the parts are
+// decoded by a WorkPool. The worker that finishes the last part of a file joins them and
+// encodes the file's chunks. Only writing the encoded chunks in file order is left to one
+// thread, so throughput grows with the number of cores until the disk is the limit.
+namespace Motion
+{
+    struct IngestOptions
+    {
+        unsigned threads = 0;      // 0 is one per hardware thread
+        size_t partBytes = 1 << 20; // of text per decoded part
+    };
+
+    struct IngestResult
+    {
+        size_t files = 0;
+        size_t failed = 0; // could not be read, left out of the archive
+        uint64_t samples = 0;
+        uint64_t textBytes = 0;
+        uint64_t parts = 0;
+        uint64_t steals = 0;
+        uint64_t incompleteBlocks = 0;
+        uint64_t malformedLines = 0;
+    };
+
+    // False if the archive cannot be written
+    bool ingest_captures(const std::vector<std::string> &textPaths, const std::string &archivePath,
+                         const IngestOptions &options, IngestResult &result);
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../include/mapped_file.hpp"
+#include "../include/motion_capture.hpp"
+
+// Columnar motion capture files (.mcol)
+//
+//   header   "MCOL", version, chunk size, sample count, chunk count, index offset
+//   chunks   per chunk, the seven columns one after the other. Every value is stored as
+//            the zigzag varint of its difference to the previous value of the column.
+//   index    one entry per chunk: block range, sample count, file offset, column sizes
+//   sources  version 2, archives of several captures: per capture its file name, first sample,
+//            sample count and block range. Every capture starts a new chunk.
+//
+// Chunks decode independently, so a range read only touches the pages of the chunks
+// whose block range overlaps it.
+namespace Motion
+{
+    constexpr uint32_t defaultChunkSamples = 4096;
+
+    struct ChunkEntry
+    {
+        uint32_t minBlock;
+        uint32_t maxBlock;
+        uint32_t samples;
+        uint32_t bytes;
+        uint64_t offset;
+        uint32_t columnBytes[7];
+    };
+
+    // The chunks of one capture, encoded away from the writer so several can be at once
+    struct EncodedCapture
+    {
+        std::string bytes;
+        std::vector<ChunkEntry> chunks; // offsets into bytes
+        uint64_t samples = 0;
+        uint32_t minBlock = 0, maxBlock = 0;
+    };
+
+    EncodedCapture encode_capture(const Capture &capture, uint32_t chunkSamples = defaultChunkSamples);
+
+    class ColumnWriter
+    {
+    public:
+        bool open(const std::string &path, uint32_t chunkSamples = defaultChunkSamples);
+
+        // Takes every sample of capture, whole chunks are encoded and written out immediately
+        void append(const Capture &capture);
+
+        // Writes a whole capture as the archive entry source, after the partial chunk
+        void append_encoded(const std::string &source, const EncodedCapture &encoded);
+
+        // Writes the last partial chunk, the index and the final header
+        bool close();
+
+        uint64_t samples() const { return sampleCount; }
+
+        struct Source
+        {
+            std::string name;
+            uint64_t firstSample = 0;
+            uint64_t samples = 0;
+            uint32_t minBlock = 0, maxBlock = 0;
+        };
+
+    private:
+        void write_chunk();
+
+        std::ofstream out;
+        uint32_t chunkSamples = defaultChunkSamples;
+        Capture pending;
+        std::string encoded;
+        std::vector<ChunkEntry> index;
+        std::vector<Source> sources;
+        uint64_t sampleCount = 0;
+    };
+
+    class ColumnReader
+    {
+    public:
+        bool open(const std::string &path);
+
+        uint64_t size() const { return sampleCount; }
+        size_t chunks() const { return chunkCount; }
+
+        // Appends every sample to out
+        bool read_all(Capture &out) const;
+
+        // Appends the samples whose block number lies in [firstBlock, lastBlock]
+        bool read_range(uint32_t firstBlock, uint32_t lastBlock, Capture &out) const;
+
+        // Captures of an archive, empty for a single capture
+        const std::vector<ColumnWriter::Source> &sources() const { return sourceList; }
+        // Appends every sample of sources()[source]
+        bool read_source(size_t source, Capture &out) const;
+
+    private:
+        bool decode_chunk(size_t chunk, uint32_t firstBlock, uint32_t lastBlock, Capture &out) const;
+
+        MappedFile file;
+        const uint8_t *indexBase = nullptr;
+        uint64_t sampleCount = 0;
+        size_t chunkCount = 0;
+        bool sortedBlocks = true; // block numbers never go back, chunks can be binary searched
+        std::vector<ColumnWriter::Source> sourceList;
+        std::vector<uint64_t> chunkFirstSample;
+    };
+
+    // True when path starts with the .mcol magic
+    bool is_columnar_file(const std::string &path);
+
+    // Appends every sample of a text or .mcol capture
+    bool read_capture(const std::string &path, Capture &capture);
+
+    // Text capture (serial_output_*.txt) to .mcol, returns the number of samples written or -1
+    int64_t convert_text_capture(const std::string &textPath, const std::string &columnarPath);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+
+#include "../include/com_port.hpp"
+
+namespace ComPort
+{
+    // One poll result as a plain value, what the worker threads hand over to the GUI thread
+    struct Reading
+    {
+        bool connected = false;
+        Subject subject = Subject::NONE;
+        int64_t time = 0; // unix seconds of the read
+        uint64_t left_clicks = 0;
+        uint64_t right_clicks = 0;
+        uint64_t middle_clicks = 0;
+        uint64_t backward_clicks = 0;
+        uint64_t forward_clicks = 0;
+        uint64_t downward_scrolls = 0;
+        uint64_t upward_scrolls = 0;
+        int battery_mv = 0;
+        int battery_percent = 0;
+        int current_dpi = 0;
+        uint64_t polled_at_ns = 0;    // Metrics::now_ns() when the poll started or the change arrived, 0 if not timed
+        bool persist = true;          // false for pushed changes between two history records, show only
+        uint64_t published_at_ns = 0; // set by Gui::publish
+    };
+
+    inline Reading make_reading(const MouseStatus &status, Subject subject, int64_t time)
+    {
+        Reading reading;
+        reading.connected = true;
+        reading.subject = subject;
+        reading.time = time;
+        reading.left_clicks = status.left_clicks;
+        reading.right_clicks = status.right_clicks;
+        reading.middle_clicks = status.middle_clicks;
+        reading.backward_clicks = status.backward_clicks;
+        reading.forward_clicks = status.forward_clicks;
+        reading.downward_scrolls = status.downward_scrolls;
+        reading.upward_scrolls = status.upward_scrolls;
+        reading.battery_mv = status.battery_mv;
+        reading.battery_percent = status.battery_percent;
+        reading.current_dpi = status.current_dpi;
+        return reading;
+    }
+
+    inline MouseStatus to_status(const Reading &reading)
+    {
+        MouseStatus status;
+        status.left_clicks = reading.left_clicks;
+        status.right_clicks = reading.right_clicks;
+        status.middle_clicks = reading.middle_clicks;
+        status.backward_clicks = reading.backward_clicks;
+        status.forward_clicks = reading.forward_clicks;
+        status.downward_scrolls = reading.downward_scrolls;
+        status.upward_scrolls = reading.upward_scrolls;
+        status.battery_mv = reading.battery_mv;
+        status.battery_percent = reading.battery_percent;
+        status.current_dpi = reading.current_dpi;
+        return status;
+    }
+}
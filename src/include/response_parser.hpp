@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "../include/com_port.hpp"
+
+namespace ComPort
+{
+    // One bit per "Key: value" line of the firmware report
+    enum Field : uint32_t
+    {
+        FIELD_NONE = 0,
+        FIELD_LEFT_CLICKS = 1u << 0,
+        FIELD_RIGHT_CLICKS = 1u << 1,
+        FIELD_MIDDLE_CLICKS = 1u << 2,
+        FIELD_BACKWARD_CLICKS = 1u << 3,
+        FIELD_FORWARD_CLICKS = 1u << 4,
+        FIELD_DOWNWARD_SCROLLS = 1u << 5,
+        FIELD_UPWARD_SCROLLS = 1u << 6,
+        FIELD_BATTERY = 1u << 7,
+        FIELD_CURRENT_DPI = 1u << 8,
+        FIELD_FIRMWARE_BUILD_DATE = 1u << 9,
+    };
+
+    // Fields a complete response must contain, the build date is optional
+    constexpr uint32_t MOUSE_FIELDS = FIELD_LEFT_CLICKS | FIELD_RIGHT_CLICKS | FIELD_MIDDLE_CLICKS |
+                                      FIELD_BACKWARD_CLICKS | FIELD_FORWARD_CLICKS |
+                                      FIELD_DOWNWARD_SCROLLS | FIELD_UPWARD_SCROLLS |
+                                      FIELD_BATTERY | FIELD_CURRENT_DPI;
+    constexpr uint32_t RECEIVER_FIELDS = FIELD_BATTERY;
+
+    // Parses a single line (without its terminator) into status, returns the field it set
+    uint32_t parse_line(std::string_view line, MouseStatus &status);
+
+    // Parses every line of a response in one pass, returns the mask of fields found
+    uint32_t parse_response(std::string_view response, MouseStatus &status);
+
+    uint32_t expected_fields(Subject subject);
+
+    // Comma separated names of the fields in mask, for logging partial frames
+    std::string describe_fields(uint32_t mask);
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+
+#include "../include/stats_store.hpp"
+
+// Rates over the counter history without rescanning it
+//
+//   rollups  mouse_stats.bin.min, .hour and .day next to the history. Header, then one bucket
+//            per minute, local hour or local day that saw any activity, oldest first: its
+//            start and how much every counter went up in it. The header also holds the open
+//            bucket and the last history record folded in, so it is the only thing rewritten
+//            on an update and a restart replays only the history written since.
+//   windows  the last minute and the last hour in memory, rings of second and minute slots
+//            with a running total, O(1) per record
+//
+// A counter that goes down was reset (the EEPROM erase of April 2025 in res/mouse_thales.txt,
+// a firmware update) and counts from zero again, so its new value is the increase. The first
+// record of a history only sets the baseline.
+namespace Stats
+{
+    using Counts = std::array<uint64_t, counterCount>;
+
+    enum Resolution
+    {
+        RESOLUTION_MINUTE,
+        RESOLUTION_HOUR,
+        RESOLUTION_DAY,
+        RESOLUTION_COUNT
+    };
+
+    struct Bucket
+    {
+        int64_t start = 0; // unix seconds, local midnight for days
+        Counts counts{};
+    };
+
+    // What after added to before, a counter below its previous value was reset
+    Counts increase(const Counts &before, const Counts &after);
+
+    // Start of the minute, local hour or local day time falls in, and of the one after start
+    int64_t bucket_start(Resolution resolution, int64_t time);
+    int64_t bucket_end(Resolution resolution, int64_t start);
+
+    // Sum over the last Slots * SlotSeconds seconds
+    template <int64_t SlotSeconds, size_t Slots>
+    class RollingWindow
+    {
+    public:
+        void add(int64_t time, const Counts &counts)
+        {
+            advance(time / SlotSeconds);
+            const int64_t slot = time / SlotSeconds;
+            if (slot <= head - static_cast<int64_t>(Slots))
+                return; // already out of the window
+            Counts &target = slots[static_cast<size_t>(slot) % Slots];
+            for (size_t i = 0; i < counterCount; ++i)
+            {
+                target[i] += counts[i];
+                sum[i] += counts[i];
+            }
+        }
+
+        const Counts &total(int64_t now)
+        {
+            advance(now / SlotSeconds);
+            return sum;
+        }
+
+    private:
+        // Empties the slots that fell out of the window, at most every slot once
+        void advance(int64_t slot)
+        {
+            if (head == INT64_MIN)
+                head = slot;
+            if (slot <= head)
+                return;
+            const int64_t steps = std::min<int64_t>(slot - head, static_cast<int64_t>(Slots));
+            for (int64_t k = 1; k <= steps; ++k)
+            {
+                Counts &expired = slots[static_cast<size_t>(head + k) % Slots];
+                for (size_t i = 0; i < counterCount; ++i)
+                    sum[i] -= expired[i];
+                expired = {};
+            }
+            head = slot;
+        }
+
+        std::array<Counts, Slots> slots{};
+        Counts sum{};
+        int64_t head = INT64_MIN; // newest slot number, time / SlotSeconds
+    };
+
+    // One resolution of rollups
+    class RollupFile
+    {
+    public:
+        bool open(const std::string &path, Resolution resolution);
+        void close();
+        bool is_open() const { return file.is_open(); }
+
+        // Folds in the next history record. Without commit the header, and so the record, is
+        // only written by the next commit().
+        bool add(const Record &record, bool commit = true);
+        bool commit() { return write_header(); }
+
+        // Buckets that overlap [from, to], oldest first, the open one included
+        bool scan(int64_t from, int64_t to, const std::function<void(const Bucket &)> &onBucket) const;
+
+        // Last history record folded in, time 0 if none
+        const Record &fed() const { return last; }
+
+    private:
+        bool write_header();
+
+        std::string path;
+        Resolution resolution = RESOLUTION_MINUTE;
+        std::fstream file;
+        uint64_t closedBuckets = 0;
+        bool hasLast = false;
+        Record last;
+        bool hasOpen = false;
+        Bucket openBucket; // still collecting, lives in the header
+        int64_t openEnd = 0;
+    };
+
+    class Rollups
+    {
+    public:
+        // The rollups of the history at storePath, catching up with whatever store holds that
+        // they have not seen. Missing or damaged rollup files are rebuilt from the history.
+        bool open(const std::string &storePath, const Store &store);
+        void close();
+        bool is_open() const { return files[RESOLUTION_MINUTE].is_open(); }
+        // History records the last open() fed to the rollups to catch up, for the caller to report
+        uint64_t caught_up() const { return caughtUp; }
+
+        // Every record appended to the history, in order
+        bool add(const Record &record);
+
+        bool scan(Resolution resolution, int64_t from, int64_t to,
+                  const std::function<void(const Bucket &)> &onBucket) const;
+
+        // Increase over the last 60 seconds and the last 60 minutes up to now
+        Counts last_minute(int64_t now) { return minute.total(now); }
+        Counts last_hour(int64_t now) { return hour.total(now); }
+
+    private:
+        std::array<RollupFile, RESOLUTION_COUNT> files;
+        RollingWindow<1, 60> minute;
+        RollingWindow<60, 60> hour;
+        bool hasPrevious = false;
+        Record previous;
+        uint64_t caughtUp = 0;
+    };
+}
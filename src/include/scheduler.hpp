@@ -0,0 +1,43 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Event bits shared by the worker threads. A thread sleeps in wait() until one of its bits is
+// posted, its deadline passes or stop() is called, so an idle thread does not wake up at all.
+// Posting a bit that is already pending is a no-op: bursts collapse into one wakeup.
+class Scheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Event : uint32_t
+    {
+        EVENT_HOTPLUG = 1 << 0,   // a serial port appeared or went away
+        EVENT_RECONNECT = 1 << 1, // a connected device stopped answering
+    };
+
+    void post(uint32_t events);
+
+    // Returns and clears the posted bits of mask, 0 on timeout or stop
+    uint32_t wait(uint32_t mask);
+    uint32_t wait(uint32_t mask, Clock::time_point deadline);
+    uint32_t wait_for(uint32_t mask, std::chrono::milliseconds timeout)
+    {
+        return wait(mask, Clock::now() + timeout);
+    }
+
+    void stop();
+    bool stopped() const;
+
+    // Time the given bit went from clear to posted, for latency logging
+    Clock::time_point posted_at(Event event) const;
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t pending = 0;
+    bool stopping = false;
+    Clock::time_point postedAt[32];
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Single writer, many readers. The writer never waits, a reader retries if it raced with a
+// store. The value is kept in relaxed atomic words so a torn copy is never undefined behaviour,
+// it is just thrown away by the sequence check.
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+class SeqLock
+{
+public:
+    SeqLock()
+    {
+        store(T{});
+        sequence.store(0, std::memory_order_relaxed);
+    }
+
+    // Only one thread may store at a time
+    void store(const T &value)
+    {
+        uint64_t raw[wordCount] = {};
+        std::memcpy(raw, &value, sizeof(T));
+
+        uint64_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < wordCount; ++i)
+            words[i].store(raw[i], std::memory_order_relaxed);
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const
+    {
+        uint64_t raw[wordCount];
+        for (;;)
+        {
+            uint64_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < wordCount; ++i)
+                raw[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+                break;
+        }
+
+        T value;
+        std::memcpy(&value, raw, sizeof(T));
+        return value;
+    }
+
+    // Number of stores so far
+    uint64_t version() const { return sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t wordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> words[wordCount];
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "../include/com_port.hpp"
+
+// Counter history (mouse_stats.bin)
+//
+//   header   "MSTS", version, keyframe interval
+//   records  one change mask byte (bit n = counter n changed, bit 7 = keyframe), then the time
+//            and the changed counters as varints. Keyframes hold the absolute time and every
+//            counter, the records in between the zigzag deltas to the previous record.
+//   index    mouse_stats.bin.idx, one (time, offset) pair per keyframe
+//
+// A reading is only stored when one of its counters changed. Appends write a single record,
+// opening replays at most one keyframe interval to recover the latest values.
+namespace Stats
+{
+    constexpr size_t counterCount = 7;
+    constexpr uint32_t defaultKeyframeInterval = 256;
+
+    // Column names of the legacy mouse_stats.txt, in counter order
+    extern const std::array<const char *, counterCount> counterNames;
+
+    struct Record
+    {
+        int64_t time = 0; // unix seconds
+        std::array<uint64_t, counterCount> counters{};
+    };
+
+    Record from_status(const ComPort::MouseStatus &status, int64_t time);
+
+    // "yyyy-MM-dd hh:mm:ss" in local time, the timestamp format of mouse_stats.txt
+    std::string format_time(int64_t time);
+    bool parse_time(std::string_view text, int64_t &time);
+
+    class Store
+    {
+    public:
+        bool open(const std::string &path, uint32_t keyframeInterval = defaultKeyframeInterval);
+        void close();
+        bool is_open() const { return out.is_open(); }
+
+        // Writes record unless its counters equal the latest ones, false on I/O errors
+        bool append(const Record &record);
+
+        bool empty() const { return !hasLatest; }
+        const Record &latest() const { return last; }
+
+        // Calls onRecord for every record with from <= time <= to, starting at the closest keyframe
+        bool scan(int64_t from, int64_t to, const std::function<void(const Record &)> &onRecord) const;
+
+    private:
+        // Replays from a keyframe at offset and cuts off a damaged tail. False if nothing
+        // decodes there, unless offset is the start of the file.
+        bool recover(uint64_t offset);
+        bool append_index(int64_t time, uint64_t offset);
+
+        std::string path;
+        std::ofstream out;
+        uint32_t keyframeInterval = defaultKeyframeInterval;
+        uint32_t sinceKeyframe = 0;
+        uint64_t endOffset = 0;
+        bool hasLatest = false;
+        Record last;
+        std::string encoded;
+    };
+
+    // Latest reading, rewritten in place on every poll (mouse_stats.last). It is a fixed size
+    // record so startup restores it with one small read however long the history is.
+    struct Snapshot
+    {
+        int64_t time = 0;
+        std::array<uint64_t, counterCount> counters{};
+        int32_t currentDpi = 0;
+        int32_t batteryPercent = 0;
+    };
+
+    Snapshot snapshot_from_status(const ComPort::MouseStatus &status, int64_t time);
+    bool write_snapshot(const std::string &path, const Snapshot &snapshot);
+    // False if the file is missing, from another version or torn by a crash
+    bool read_snapshot(const std::string &path, Snapshot &snapshot);
+
+    // One-time import of the legacy CSV, returns the number of rows read or -1
+    int64_t import_csv(const std::string &csvPath, Store &store);
+
+    // Writes every stored record in the mouse_stats.txt layout, returns the row count or -1
+    int64_t export_csv(const Store &store, const std::string &csvPath);
+}
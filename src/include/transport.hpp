@@ -0,0 +1,106 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace ComPort
+{
+    // A byte stream to one device. The protocol code in device_protocol.cc only talks to this,
+    // so it runs the same over a serial port, a pseudo terminal or an in-memory pipe.
+    class Transport
+    {
+    public:
+        virtual ~Transport() = default;
+
+        // Writes every byte, false if the other end is gone
+        virtual bool send(std::string_view bytes) = 0;
+
+        // Waits up to timeoutMs for data and reads what is there into buffer.
+        // Returns the byte count, 0 on timeout and -1 once the other end hung up.
+        virtual int receive(std::span<char> buffer, int timeoutMs) = 0;
+
+        // Drops input received so far, e.g. the tail of an earlier response
+        virtual void discard_input() = 0;
+
+        virtual std::string name() const = 0;
+
+        // Has notify called, from whichever thread takes in the bytes, whenever input arrives or
+        // the other end hangs up, so one loop can sleep on many transports. False if this
+        // transport cannot, then it has to be polled with receive(buffer, 0).
+        virtual bool set_notify(std::function<void()> notify)
+        {
+            (void)notify;
+            return false;
+        }
+    };
+
+    // The platform serial port at path (COMx or /dev/tty*), nullptr if it cannot be opened
+    std::unique_ptr<Transport> open_serial_transport(const std::wstring &path);
+
+    // One end of an in-process pipe, see MemoryTransport::pair()
+    class MemoryTransport : public Transport
+    {
+    public:
+        // Two connected ends, what one sends the other receives. Destroying an end hangs up.
+        static std::pair<std::unique_ptr<MemoryTransport>, std::unique_ptr<MemoryTransport>> pair();
+
+        ~MemoryTransport() override;
+
+        bool send(std::string_view bytes) override;
+        int receive(std::span<char> buffer, int timeoutMs) override;
+        void discard_input() override;
+        std::string name() const override { return "memory"; }
+        bool set_notify(std::function<void()> notify) override;
+
+    private:
+        struct Channel
+        {
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::string data;
+            size_t head = 0;
+            bool closed = false;
+            std::function<void()> notify; // set by the receiving end
+        };
+
+        static void wake(Channel &channel);
+
+        MemoryTransport(std::shared_ptr<Channel> in, std::shared_ptr<Channel> out)
+            : in(std::move(in)), out(std::move(out)) {}
+
+        std::shared_ptr<Channel> in;
+        std::shared_ptr<Channel> out;
+    };
+
+#ifndef _WIN32
+    // Master side of a new pseudo terminal. The client opens slave_path() like a serial port,
+    // which is how the firmware simulator stands in for a real device.
+    class PtyTransport : public Transport
+    {
+    public:
+        static std::unique_ptr<PtyTransport> create();
+        ~PtyTransport() override;
+
+        bool send(std::string_view bytes) override;
+        int receive(std::span<char> buffer, int timeoutMs) override;
+        void discard_input() override;
+        std::string name() const override { return slavePath; }
+
+        const std::string &slave_path() const { return slavePath; }
+
+    private:
+        PtyTransport(int master, int slave, std::string slavePath)
+            : masterFd(master), slaveFd(slave), slavePath(std::move(slavePath)) {}
+
+        int masterFd;
+        int slaveFd; // kept open so the master does not see a hangup between client connections
+        std::string slavePath;
+    };
+#endif
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// LEB128 varints with zigzag for signed values, shared by the on-disk formats
+namespace Varint
+{
+    inline uint64_t zigzag(int64_t v)
+    {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t v)
+    {
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    inline void put(std::string &out, uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back(static_cast<char>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<char>(v));
+    }
+
+    inline void put_signed(std::string &out, int64_t v)
+    {
+        put(out, zigzag(v));
+    }
+
+    // Decodes one varint from [p, end), returns nullptr if it is truncated or too long
+    inline const uint8_t *get(const uint8_t *p, const uint8_t *end, uint64_t &v)
+    {
+        v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7)
+        {
+            uint8_t byte = *p++;
+            v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return p;
+        }
+        return nullptr;
+    }
+
+    inline const uint8_t *get_signed(const uint8_t *p, const uint8_t *end, int64_t &v)
+    {
+        uint64_t raw;
+        p = get(p, end, raw);
+        v = unzigzag(raw);
+        return p;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with a task deque each. A task submitted from a worker goes on
+// that worker's own deque, which it takes from the back (the newest, its data still in cache).
+// A worker with nothing left steals from the front of another deque, the oldest task, which is
+// usually the largest piece of what is left. Tasks from outside the pool are dealt round-robin.
+class WorkPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // 0 threads is one per hardware thread
+    explicit WorkPool(unsigned threads = 0);
+    // Runs what is still queued, then joins
+    ~WorkPool();
+    WorkPool(const WorkPool &) = delete;
+    WorkPool &operator=(const WorkPool &) = delete;
+
+    void submit(Task task);
+
+    // Until every task has run, including the ones tasks submitted. Not from a worker.
+    void wait();
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+    uint64_t steals() const { return stolen.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(unsigned index);
+    bool take(unsigned index, Task &task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    // queued counts tasks sitting in a deque. A worker claims one under the mutex before it
+    // looks, so it always finds one and an empty pool sleeps instead of spinning.
+    std::mutex mutex;
+    std::condition_variable workAvailable, allDone;
+    uint64_t queued = 0;
+    uint64_t unfinished = 0;
+    bool stopping = false;
+
+    std::atomic<unsigned> nextWorker{0};
+    std::atomic<uint64_t> stolen{0};
+};
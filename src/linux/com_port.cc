@@ -0,0 +1,519 @@
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../include/com_port.hpp"
+#include "../include/frame_reader.hpp"
+#include "../include/transport.hpp"
+
+namespace fs = std::filesystem;
+
+namespace ComPort
+{
+    // -------------------- Event loop state --------------------
+    static int epollFd = -1;
+    static int stopFd = -1;
+    static int ueventFd = -1;
+    static std::thread loopThread;
+    static std::function<void()> hotplugCallback;
+    static bool seenUdevMessage = false;
+
+    class SerialTransport;
+
+    // Open serial ports by fd, the loop hands their input over under loopMutex
+    static std::mutex loopMutex;
+    static std::unordered_map<int, SerialTransport *> serialPorts;
+
+    static std::string narrow(const std::wstring &s)
+    {
+        return std::string(s.begin(), s.end());
+    }
+
+    static std::string readAttribute(const fs::path &path)
+    {
+        std::ifstream in(path);
+        std::string value;
+        std::getline(in, value);
+        return value;
+    }
+
+    // The USB device a tty belongs to, empty if it is not a USB tty
+    static fs::path usbDevice(const fs::path &ttyClassPath)
+    {
+        std::error_code ec;
+        fs::path dev = fs::canonical(ttyClassPath / "device", ec);
+        if (ec)
+            return {};
+
+        for (; dev.has_relative_path(); dev = dev.parent_path())
+        {
+            if (fs::exists(dev / "idVendor", ec) && fs::exists(dev / "idProduct", ec))
+                return dev;
+        }
+        return {};
+    }
+
+    // Formats the USB ids the way SetupDi reports hardware ids,
+    // so mouseVidPid / receiverVidPid can be matched as they are on Windows
+    static std::wstring usbHardwareId(const fs::path &usbDev)
+    {
+        std::string id = "VID_" + readAttribute(usbDev / "idVendor") +
+                         "&PID_" + readAttribute(usbDev / "idProduct") +
+                         "&REV_" + readAttribute(usbDev / "bcdDevice");
+        for (char &c : id)
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        return std::wstring(id.begin(), id.end());
+    }
+
+    // -------------------- Port cache --------------------
+    // What each tty turned out to be, by the sysfs path of its device. A rescan reads one link
+    // and one inode per tty and only walks up to the USB device of a tty it has not seen yet,
+    // or whose sysfs node was created again since, e.g. another device on the same USB port.
+    struct CachedPort
+    {
+        ino_t node = 0;
+        bool ours = false; // a mouse or receiver, info is filled in
+        DeviceInfo info;
+    };
+
+    static std::mutex portCacheMutex;
+    static std::unordered_map<std::string, CachedPort> portCache;
+
+    static CachedPort examinePort(const fs::path &ttyClassPath, ino_t node)
+    {
+        CachedPort port;
+        port.node = node;
+        fs::path usbDev = usbDevice(ttyClassPath);
+        if (usbDev.empty())
+            return port;
+
+        std::wstring hwId = usbHardwareId(usbDev);
+        if (hwId.find(mouseVidPid) != std::wstring::npos)
+            port.info.subject = Subject::MOUSE;
+        else if (hwId.find(receiverVidPid) != std::wstring::npos)
+            port.info.subject = Subject::RECEIVER;
+        else
+            return port;
+
+        port.ours = true;
+        port.info.port = L"/dev/" + ttyClassPath.filename().wstring();
+        port.info.serial = readAttribute(usbDev / "serial");
+        return port;
+    }
+
+    bool detectAllDevices(std::vector<DeviceInfo> &devices)
+    {
+        devices.clear();
+
+        std::error_code ec;
+        fs::directory_iterator it("/sys/class/tty", ec);
+        if (ec)
+        {
+            std::cerr << "Cannot list /sys/class/tty: " << ec.message() << std::endl;
+            return false;
+        }
+
+        // Ttys that are gone drop out of the cache
+        std::lock_guard<std::mutex> lock(portCacheMutex);
+        std::unordered_map<std::string, CachedPort> present;
+        for (const fs::directory_entry &entry : it)
+        {
+            struct stat link{};
+            if (lstat(entry.path().c_str(), &link) != 0)
+                continue;
+            fs::path devicePath = fs::read_symlink(entry.path(), ec);
+            if (ec)
+                devicePath = entry.path(); // old sysfs layout, the class directory is the device
+
+            const std::string key = devicePath.string();
+            auto cached = portCache.find(key);
+            CachedPort port = (cached != portCache.end() && cached->second.node == link.st_ino)
+                                  ? std::move(cached->second)
+                                  : examinePort(entry.path(), link.st_ino);
+            if (port.ours)
+                devices.push_back(port.info);
+            present.emplace(key, std::move(port));
+        }
+        portCache = std::move(present);
+
+        std::sort(devices.begin(), devices.end(), [](const DeviceInfo &a, const DeviceInfo &b)
+                  { return a.port < b.port; });
+        return !devices.empty();
+    }
+
+    bool portMatches(const DeviceInfo &known)
+    {
+        const fs::path ttyClassPath = fs::path("/sys/class/tty") / fs::path(known.port).filename();
+        struct stat link{};
+        if (lstat(ttyClassPath.c_str(), &link) != 0)
+            return false;
+        std::error_code ec;
+        fs::path devicePath = fs::read_symlink(ttyClassPath, ec);
+        if (ec)
+            devicePath = ttyClassPath;
+
+        CachedPort port;
+        {
+            std::lock_guard<std::mutex> lock(portCacheMutex);
+            const std::string key = devicePath.string();
+            auto cached = portCache.find(key);
+            if (cached != portCache.end() && cached->second.node == link.st_ino)
+                port = cached->second;
+            else
+                port = portCache[key] = examinePort(ttyClassPath, link.st_ino);
+        }
+        return port.ours && port.info.port == known.port && port.info.subject == known.subject &&
+               (known.serial.empty() || port.info.serial == known.serial);
+    }
+
+    // -------------------- Serial transport --------------------
+    // The event loop reads the port as soon as bytes arrive, receive() hands them out
+    class SerialTransport : public Transport
+    {
+    public:
+        SerialTransport(int fd, std::string path) : fd(fd), path(std::move(path)), buffer(4096) {}
+        ~SerialTransport() override;
+
+        bool send(std::string_view bytes) override;
+        int receive(std::span<char> out, int timeoutMs) override;
+        void discard_input() override;
+        std::string name() const override { return path; }
+        bool set_notify(std::function<void()> notify) override;
+
+        // Loop thread
+        void on_readable(uint32_t events);
+
+    private:
+        int fd;
+        std::string path;
+        std::mutex mutex;
+        std::condition_variable cv;
+        RingBuffer buffer;
+        bool error = false;
+        std::function<void()> notify;
+    };
+
+    SerialTransport::~SerialTransport()
+    {
+        {
+            std::lock_guard<std::mutex> lock(loopMutex);
+            serialPorts.erase(fd);
+            if (epollFd >= 0)
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+        close(fd);
+    }
+
+    void SerialTransport::on_readable(uint32_t events)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        char discard[256];
+        while (true)
+        {
+            // Nobody picked up the last 4 KiB, drop the newest bytes
+            std::span<char> span = buffer.write_span();
+            if (span.empty())
+                span = std::span<char>(discard, sizeof(discard));
+
+            ssize_t n = read(fd, span.data(), span.size());
+            if (n > 0)
+            {
+                if (span.data() != discard)
+                    buffer.commit(static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && errno == EAGAIN && !(events & (EPOLLHUP | EPOLLERR)))
+                break;
+
+            // Hangup or I/O error: the device is gone, stop watching it
+            error = true;
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            break;
+        }
+        cv.notify_all();
+        if (notify)
+            notify();
+    }
+
+    bool SerialTransport::set_notify(std::function<void()> callback)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        notify = std::move(callback);
+        return true;
+    }
+
+    bool SerialTransport::send(std::string_view bytes)
+    {
+        while (!bytes.empty())
+        {
+            ssize_t n = write(fd, bytes.data(), bytes.size());
+            if (n > 0)
+            {
+                bytes.remove_prefix(static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && errno != EAGAIN)
+                return false;
+
+            pollfd pfd{fd, POLLOUT, 0};
+            if (poll(&pfd, 1, 1000) <= 0)
+                return false;
+        }
+        return true;
+    }
+
+    int SerialTransport::receive(std::span<char> out, int timeoutMs)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]
+                    { return error || buffer.size() > 0; });
+
+        size_t n = std::min(buffer.size(), out.size());
+        if (n == 0)
+            return error ? -1 : 0;
+
+        std::string_view bytes = buffer.view(n);
+        std::memcpy(out.data(), bytes.data(), n);
+        buffer.consume(n);
+        return static_cast<int>(n);
+    }
+
+    void SerialTransport::discard_input()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tcflush(fd, TCIFLUSH);
+        buffer.clear();
+    }
+
+    // -------------------- Event loop --------------------
+    static void handleSerial(int fd, uint32_t events)
+    {
+        std::lock_guard<std::mutex> lock(loopMutex);
+        auto it = serialPorts.find(fd);
+        if (it != serialPorts.end()) // else closed while we were waking up
+            it->second->on_readable(events);
+    }
+
+    static void handleUevent()
+    {
+        char buf[8192];
+        bool relevant = false;
+
+        while (true)
+        {
+            ssize_t n = recv(ueventFd, buf, sizeof(buf), 0);
+            if (n <= 0)
+                break;
+
+            // Kernel messages are "action@devpath\0KEY=value\0...", udevd ones carry a
+            // binary "libudev" header first. Both are NUL separated key=value lists.
+            std::string_view msg(buf, static_cast<size_t>(n));
+            bool fromUdev = msg.starts_with("libudev");
+            if (fromUdev)
+                seenUdevMessage = true;
+            else if (seenUdevMessage)
+                continue; // udevd is running, wait for it to finish creating the node
+
+            bool isTty = false, isAddOrRemove = false;
+            for (size_t pos = 0; pos < msg.size();)
+            {
+                size_t end = msg.find('\0', pos);
+                if (end == std::string_view::npos)
+                    end = msg.size();
+                std::string_view kv = msg.substr(pos, end - pos);
+                if (kv == "SUBSYSTEM=tty")
+                    isTty = true;
+                else if (kv == "ACTION=add" || kv == "ACTION=remove")
+                    isAddOrRemove = true;
+                pos = end + 1;
+            }
+            relevant |= isTty && isAddOrRemove;
+        }
+
+        if (relevant && hotplugCallback)
+            hotplugCallback();
+    }
+
+    static void eventLoop()
+    {
+        epoll_event events[8];
+        while (true)
+        {
+            int n = epoll_wait(epollFd, events, 8, -1);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                std::cerr << "epoll_wait failed: " << std::strerror(errno) << std::endl;
+                return;
+            }
+
+            for (int i = 0; i < n; ++i)
+            {
+                int fd = events[i].data.fd;
+                if (fd == stopFd)
+                    return;
+                if (fd == ueventFd)
+                    handleUevent();
+                else
+                    handleSerial(fd, events[i].events);
+            }
+        }
+    }
+
+    // Ports are opened from several probing threads at once
+    static std::mutex setupMutex;
+
+    static bool ensureEventLoop()
+    {
+        std::lock_guard<std::mutex> lock(setupMutex);
+        if (epollFd >= 0)
+            return true;
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (epollFd < 0 || stopFd < 0)
+        {
+            std::cerr << "Failed to create epoll loop: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = stopFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &ev);
+
+        loopThread = std::thread(eventLoop);
+        return true;
+    }
+
+    bool startEventLoop(std::function<void()> onHotplug)
+    {
+        hotplugCallback = std::move(onHotplug);
+        if (!ensureEventLoop())
+            return false;
+
+        // Group 1 = kernel uevents, group 2 = udevd after it processed the rules
+        ueventFd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+        sockaddr_nl addr{};
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = 1 | 2;
+        if (ueventFd < 0 || bind(ueventFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+            std::cerr << "Failed to open udev monitor: " << std::strerror(errno) << std::endl;
+            if (ueventFd >= 0)
+                close(ueventFd);
+            ueventFd = -1;
+            return false;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = ueventFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, ueventFd, &ev);
+        return true;
+    }
+
+    void stopEventLoop()
+    {
+        if (epollFd < 0)
+            return;
+
+        uint64_t one = 1;
+        if (write(stopFd, &one, sizeof(one)) < 0)
+            std::cerr << "Failed to signal event loop" << std::endl;
+        if (loopThread.joinable())
+            loopThread.join();
+
+        disconnect();
+        if (ueventFd >= 0)
+            close(ueventFd);
+        close(stopFd);
+        close(epollFd);
+        ueventFd = stopFd = epollFd = -1;
+    }
+
+    // -------------------- Connection --------------------
+    std::unique_ptr<Transport> open_serial_transport(const std::wstring &port)
+    {
+        if (!ensureEventLoop())
+            return nullptr;
+
+        std::string path = narrow(port);
+        int fd = open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+        {
+            std::cerr << "Failed to connect to " << path << ": " << std::strerror(errno) << std::endl;
+            return nullptr;
+        }
+
+        // Exclusive access, like opening the COM port without share flags on Windows
+        ioctl(fd, TIOCEXCL);
+
+        termios tty{};
+        if (tcgetattr(fd, &tty) != 0)
+        {
+            std::cerr << "tcgetattr failed" << std::endl;
+            close(fd);
+            return nullptr;
+        }
+
+        cfmakeraw(&tty);
+        cfsetispeed(&tty, B115200);
+        cfsetospeed(&tty, B115200);
+        tty.c_cflag = (tty.c_cflag & ~(CSIZE | CSTOPB | PARENB | CRTSCTS)) | CS8 | CLOCAL | CREAD;
+        tty.c_cc[VMIN] = 1; // with O_NONBLOCK an empty read reports EAGAIN instead of 0
+        tty.c_cc[VTIME] = 0;
+
+        if (tcsetattr(fd, TCSANOW, &tty) != 0)
+        {
+            std::cerr << "tcsetattr failed" << std::endl;
+            close(fd);
+            return nullptr;
+        }
+        tcflush(fd, TCIOFLUSH);
+
+        auto transport = std::make_unique<SerialTransport>(fd, path);
+        {
+            std::lock_guard<std::mutex> lock(loopMutex);
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == 0)
+            {
+                serialPorts[fd] = transport.get();
+                return transport;
+            }
+        }
+        std::cerr << "Failed to watch " << path << std::endl;
+        return nullptr; // the destructor closes fd
+    }
+}
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <iostream>
+#include <new>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "include/live_publisher.hpp"
+
+namespace Live
+{
+    static bool matches(const Region &region)
+    {
+        return region.magic.load(std::memory_order_acquire) == magic && region.version == version &&
+               region.size == sizeof(Region);
+    }
+
+    static Region *initialise(void *memory)
+    {
+        Region *region = new (memory) Region();
+        region->version = version;
+        region->size = sizeof(Region);
+        region->magic.store(magic, std::memory_order_release);
+        return region;
+    }
+
+#ifdef _WIN32
+
+    bool Publisher::open()
+    {
+        close();
+
+        HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+                                           static_cast<DWORD>(sizeof(Region)), regionName);
+        if (!handle)
+        {
+            std::cerr << "Failed to create live region: error " << GetLastError() << std::endl;
+            return false;
+        }
+        const bool existed = GetLastError() == ERROR_ALREADY_EXISTS;
+
+        void *view = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Region));
+        if (!view)
+        {
+            // An older client with a smaller layout still holds the name
+            std::cerr << "Failed to map live region: error " << GetLastError() << std::endl;
+            CloseHandle(handle);
+            return false;
+        }
+        mapping = handle;
+
+        region = static_cast<Region *>(view);
+        if (!existed || !matches(*region))
+            region = initialise(view);
+        return true;
+    }
+
+    void Publisher::close()
+    {
+        if (region)
+            UnmapViewOfFile(region);
+        if (mapping)
+            CloseHandle(mapping);
+        region = nullptr;
+        mapping = nullptr;
+    }
+
+#else
+
+    static void *map_region(int fd)
+    {
+        void *view = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        return view == MAP_FAILED ? nullptr : view;
+    }
+
+    bool Publisher::open()
+    {
+        close();
+
+        int fd = shm_open(regionName, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            std::cerr << "Failed to create live region: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        struct stat st{};
+        bool reuse = fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) == sizeof(Region);
+        void *view = reuse ? map_region(fd) : nullptr;
+        if (view && !matches(*static_cast<Region *>(view)))
+        {
+            munmap(view, sizeof(Region));
+            view = nullptr;
+        }
+
+        if (!view)
+        {
+            // A region of another version: unlinked rather than resized, so its readers keep
+            // a valid (if silent) mapping instead of faulting
+            ::close(fd);
+            if (st.st_size != 0)
+                shm_unlink(regionName);
+            fd = shm_open(regionName, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (fd < 0 || ftruncate(fd, sizeof(Region)) != 0 || !(view = map_region(fd)))
+            {
+                std::cerr << "Failed to create live region: " << std::strerror(errno) << std::endl;
+                if (fd >= 0)
+                    ::close(fd);
+                return false;
+            }
+            region = initialise(view);
+        }
+        else
+        {
+            region = static_cast<Region *>(view);
+        }
+        ::close(fd);
+        return true;
+    }
+
+    void Publisher::close()
+    {
+        if (region)
+            munmap(region, sizeof(Region));
+        region = nullptr;
+    }
+
+#endif
+
+    void Publisher::publish(const ComPort::DeviceInfo &info, const ComPort::Reading &reading)
+    {
+        if (!region)
+            return;
+
+        StatusRecord record;
+        record.time = reading.time;
+        record.polled_at_ns = reading.polled_at_ns;
+        record.left_clicks = reading.left_clicks;
+        record.right_clicks = reading.right_clicks;
+        record.middle_clicks = reading.middle_clicks;
+        record.backward_clicks = reading.backward_clicks;
+        record.forward_clicks = reading.forward_clicks;
+        record.downward_scrolls = reading.downward_scrolls;
+        record.upward_scrolls = reading.upward_scrolls;
+        record.battery_mv = reading.battery_mv;
+        record.battery_percent = reading.battery_percent;
+        record.current_dpi = reading.current_dpi;
+        record.subject = reading.subject == ComPort::Subject::MOUSE      ? SUBJECT_MOUSE
+                         : reading.subject == ComPort::Subject::RECEIVER ? SUBJECT_RECEIVER
+                                                                         : SUBJECT_NONE;
+
+        const std::string device = ComPort::device_name(info);
+        size_t length = std::min(device.size(), sizeof(record.device) - 1);
+        std::copy_n(device.begin(), length, record.device);
+
+        region->status.push(record);
+    }
+
+    void Publisher::publish(const Motion::Capture &capture, size_t index)
+    {
+        if (!region)
+            return;
+
+        MotionRecord record;
+        record.block = capture.block[index];
+        record.before_x = capture.before_x[index];
+        record.before_y = capture.before_y[index];
+        record.after_x = capture.after_x[index];
+        record.after_y = capture.after_y[index];
+        record.x_cond = capture.x_cond[index];
+        record.y_cond = capture.y_cond[index];
+        region->motion.push(record);
+    }
+}
@@ -1,254 +1,136 @@
-#include <atomic>
-#include <iostream>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
-#include <thread>
+
+#ifdef _WIN32
 #include <windows.h>
-#include <dbt.h>
+#endif
 
 #include <QApplication>
 #include <QAction>
 
+#include "include/cli.hpp"
+#include "include/daemon.hpp"
 #include "include/gui.hpp"
-#include "include/com_port.hpp"
-
-// -------------------- Globals --------------------
-std::atomic<bool> stopRequested(false);
-std::atomic<bool> deviceConnected(false);
-std::atomic<int> comPortEvents(1); // initial scan triggers first run
-ComPort::MouseStatus status;
-
-std::wstring mouseComPort, receiverComPort;
-HWND comNotifyHwnd = nullptr;
+#include "include/metrics.hpp"
 
-// -------------------- Functions --------------------
-bool selectDevice()
+// -------------------- Main --------------------
+int main(int argc, char *argv[])
 {
-    ComPort::connectedTo = ComPort::Subject::NONE;
+    Metrics::startup_begin();
 
-    if (!mouseComPort.empty())
+    bool noConsole = false;
+    bool headless = false;
+    Daemon::Options daemonOptions;
+    std::string motionCapturePath, motionReplayPath, motionAnalyzePath, motionConvertIn, motionConvertOut;
+    std::string motionIngestArchive;
+    std::vector<std::string> motionIngestInputs;
+    unsigned ingestThreads = 0;
+    std::string statsExportIn, statsExportOut;
+    std::string rollupStore, rollupResolution;
+    int rollupDays = 7;
+    for (int i = 1; i < argc; ++i)
     {
-        ComPort::disconnect();
-        std::cout << "MOUSE detected on "
-                  << std::string(mouseComPort.begin(), mouseComPort.end())
-                  << ", attempting to connect" << std::endl;
-
-        if (ComPort::connect(ComPort::Subject::MOUSE, mouseComPort))
+        if (std::strcmp(argv[i], "--no-console") == 0)
         {
-            std::cout << "Connected to MOUSE" << std::endl;
-            ComPort::connectedTo = ComPort::Subject::MOUSE;
-            deviceConnected = true;
-            return true;
+            noConsole = true;
         }
-    }
-
-    if (!receiverComPort.empty())
-    {
-        ComPort::disconnect();
-        std::cout << "RECEIVER detected on "
-                  << std::string(receiverComPort.begin(), receiverComPort.end())
-                  << ", attempting to connect" << std::endl;
-
-        if (ComPort::connect(ComPort::Subject::RECEIVER, receiverComPort))
+        else if (std::strcmp(argv[i], "--headless") == 0)
         {
-            std::cout << "Connected to RECEIVER" << std::endl;
-            ComPort::connectedTo = ComPort::Subject::RECEIVER;
-            deviceConnected = true;
-            return true;
+            headless = true;
         }
-    }
-
-    deviceConnected = false;
-    return false;
-}
-
-// -------------------- Device monitoring thread --------------------
-void deviceMonitoringThread()
-{
-    while (!stopRequested)
-    {
-        if (comPortEvents == 0)
+        else if (Daemon::parse_option(argc, argv, i, daemonOptions))
         {
-            Sleep(500);
-            continue;
+            // --mouse-port, --receiver-port, --history-dir, --stats-dir, --metrics-port,
+            // --text-protocol, --no-subscribe
         }
-
-        comPortEvents--; // consume event
-
-        if (!ComPort::detectDevices(mouseComPort, receiverComPort))
+        else if (std::strcmp(argv[i], "--motion-capture") == 0 && i + 1 < argc)
         {
-            std::cout << "Could not detect any device" << std::endl;
-            continue;
+            motionCapturePath = argv[++i];
         }
-
-        if (!selectDevice())
+        else if (std::strcmp(argv[i], "--motion-replay") == 0 && i + 1 < argc)
         {
-            std::cout << "Could not select a COM port..." << std::endl;
-            Gui::updateGui(status, false);
+            motionReplayPath = argv[++i];
         }
-
-        std::cout << "Selected a device" << std::endl;
-    }
-}
-
-// -------------------- Data reading thread --------------------
-void dataReadingThread()
-{
-    while (!stopRequested)
-    {
-        if (!deviceConnected)
+        else if (std::strcmp(argv[i], "--motion-analyze") == 0 && i + 1 < argc)
         {
-            Sleep(1000);
-            continue;
+            motionAnalyzePath = argv[++i];
         }
-
-        if (!ComPort::read_data_X)
+        else if (std::strcmp(argv[i], "--motion-ingest") == 0 && i + 2 < argc)
         {
-            std::cout << "No read data function" << std::endl;
-            Sleep(1000);
-            continue;
+            motionIngestArchive = argv[++i];
+            while (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0)
+                motionIngestInputs.push_back(argv[++i]);
         }
-
-        if (!ComPort::read_data_X(status))
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
         {
-            std::cout << "Could not read data, disconnecting" << std::endl;
-            ComPort::disconnect();
-            deviceConnected = false;
-            Gui::updateGui(status, false);
-            ComPort::connectedTo = ComPort::Subject::NONE;
-            Sleep(2000);
-            continue;
+            ingestThreads = static_cast<unsigned>(std::atoi(argv[++i]));
         }
-
-        Gui::updateGui(status, true);
-        Sleep(2000);
-    }
-}
-
-// -------------------- COM port notification thread --------------------
-void comPortNotificationThread()
-{
-    const wchar_t CLASS_NAME[] = L"ComPortNotifyWindow";
-    HINSTANCE hInstance = GetModuleHandle(nullptr);
-
-    WNDCLASS wc{};
-    wc.lpfnWndProc = [](HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) -> LRESULT
-    {
-        switch (uMsg)
+        else if (std::strcmp(argv[i], "--motion-convert") == 0 && i + 2 < argc)
         {
-        case WM_DEVICECHANGE:
-            if (wParam == DBT_DEVICEARRIVAL || wParam == DBT_DEVICEREMOVECOMPLETE)
-            {
-                PDEV_BROADCAST_HDR pHdr = (PDEV_BROADCAST_HDR)lParam;
-                if (pHdr && pHdr->dbch_devicetype == DBT_DEVTYP_DEVICEINTERFACE)
-                {
-                    std::cout << "Something com port happened" << std::endl;
-                    deviceConnected = false;
-                    comPortEvents++;
-                }
-            }
-            break;
-
-        case WM_DESTROY:
-            PostQuitMessage(0);
-            return 0;
+            motionConvertIn = argv[++i];
+            motionConvertOut = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--export-stats") == 0 && i + 2 < argc)
+        {
+            statsExportIn = argv[++i];
+            statsExportOut = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--stats-rollup") == 0 && i + 2 < argc)
+        {
+            rollupStore = argv[++i];
+            rollupResolution = argv[++i];
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+                rollupDays = std::atoi(argv[++i]);
         }
-
-        return DefWindowProc(hwnd, uMsg, wParam, lParam);
-    };
-
-    wc.hInstance = hInstance;
-    wc.lpszClassName = CLASS_NAME;
-
-    if (!RegisterClass(&wc))
-    {
-        std::cerr << "Failed to register window class" << std::endl;
-        return;
-    }
-
-    HWND hwnd = CreateWindowEx(
-        0, CLASS_NAME, L"COM Port Notification Window",
-        0, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT,
-        nullptr, nullptr, hInstance, nullptr);
-
-    comNotifyHwnd = hwnd;
-
-    if (!hwnd)
-    {
-        std::cerr << "Failed to create window" << std::endl;
-        return;
-    }
-
-    DEV_BROADCAST_DEVICEINTERFACE NotificationFilter{};
-    NotificationFilter.dbcc_size = sizeof(DEV_BROADCAST_DEVICEINTERFACE);
-    NotificationFilter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
-    NotificationFilter.dbcc_classguid = GUID_DEVINTERFACE_COMPORT;
-
-    HDEVNOTIFY hDevNotify = RegisterDeviceNotification(
-        hwnd, &NotificationFilter, DEVICE_NOTIFY_WINDOW_HANDLE);
-
-    if (!hDevNotify)
-    {
-        std::cerr << "Failed to register device notification" << std::endl;
-        return;
-    }
-
-    MSG msg{};
-    while (GetMessage(&msg, nullptr, 0, 0))
-    {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
     }
 
-    UnregisterDeviceNotification(hDevNotify);
-}
-
-#ifdef _WIN32
-#include <windows.h>
-#endif
-
-// -------------------- Main --------------------
-int main(int argc, char *argv[])
-{
+    if (!statsExportIn.empty())
+        return Cli::export_stats(statsExportIn, statsExportOut);
+    if (!rollupStore.empty())
+        return Cli::stats_rollup(rollupStore, rollupResolution, rollupDays);
+    if (!motionConvertIn.empty())
+        return Cli::motion_convert(motionConvertIn, motionConvertOut);
+    if (!motionIngestArchive.empty())
+        return Cli::motion_ingest(motionIngestArchive, motionIngestInputs, ingestThreads);
+    if (!motionAnalyzePath.empty())
+        return Cli::motion_analyze(motionAnalyzePath);
+    if (!motionReplayPath.empty())
+        return Cli::motion_replay(motionReplayPath);
+    if (!motionCapturePath.empty())
+        return Cli::motion_capture(daemonOptions.mousePort, motionCapturePath);
+    if (headless)
+        return Daemon::run_headless(daemonOptions);
 
 #ifdef _WIN32
-
-    bool noConsole = false;
-    for (int i = 1; i < argc; ++i)
-    {
-        if (std::strcmp(argv[i], "--no-console") == 0)
-        {
-            noConsole = true;
-            break;
-        }
-    }
     if (noConsole)
     {
         FreeConsole();
     }
+#else
+    (void)noConsole;
 #endif
 
     QApplication app(argc, argv);
 
+    // The tray icon first, the history and the devices behind it
     QAction *quitAction = nullptr;
     gui_init(app, &quitAction);
 
-    std::thread comNotifyThread(comPortNotificationThread);
-    std::thread monitorThread(deviceMonitoringThread);
-    std::thread readerThread(dataReadingThread);
+    Daemon::open_stats(daemonOptions);
+    gui_restore_last_reading();
+
+    Daemon::start(daemonOptions, Gui::publish);
 
     QObject::connect(quitAction, &QAction::triggered, [&]()
                      {
-        stopRequested = true;
-
-        if (comNotifyHwnd)
-            PostMessage(comNotifyHwnd, WM_QUIT, 0, 0);
-
-        if (monitorThread.joinable()) monitorThread.join();
-        if (readerThread.joinable()) readerThread.join();
-        if (comNotifyThread.joinable()) comNotifyThread.join();
-
+        Daemon::stop();
         app.quit(); });
 
-    return app.exec();
+    // Also when the session ends without Quit, the device threads must be joined before main() returns
+    int result = app.exec();
+    Daemon::stop();
+    return result;
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "include/mapped_file.hpp"
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    opened = true;
+    length = static_cast<size_t>(size.QuadPart);
+    if (length == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+    {
+        close();
+        return false;
+    }
+    mappingHandle = mapping;
+
+    base = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!base)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (base)
+        UnmapViewOfFile(base);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+    base = nullptr;
+    mappingHandle = fileHandle = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    opened = true;
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0)
+    {
+        void *p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            ::close(fd);
+            opened = false;
+            length = 0;
+            return false;
+        }
+        base = static_cast<const uint8_t *>(p);
+    }
+
+    ::close(fd); // the mapping keeps the file referenced
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (base)
+        munmap(const_cast<uint8_t *>(base), length);
+    base = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#endif
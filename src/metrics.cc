@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "include/metrics.hpp"
+
+namespace Metrics
+{
+    static Histogram stages[STAGE_COUNT];
+    static std::atomic<uint64_t> counters[COUNTER_COUNT];
+
+    static const char *stageNames[STAGE_COUNT] = {
+        "write", "first byte", "last byte", "parse", "publish", "render", "persist", "cycle"};
+
+    static std::atomic<uint64_t> startupStartNs{0};
+    static std::atomic<uint64_t> milestones[MILESTONE_COUNT];
+    static const char *milestoneNames[MILESTONE_COUNT] = {"tray", "known port", "first reading"};
+
+    static const char *counterNames[COUNTER_COUNT] = {
+        "polls", "pushed changes", "timeouts", "truncated frames", "dropped bytes", "crc errors",
+        "transport errors", "reconnects", "coalesced updates", "manager wakeups"};
+
+    // -------------------- Histogram --------------------
+    size_t Histogram::bucket_of(uint64_t ns)
+    {
+        const uint64_t exact = 2 << subBucketBits;
+        if (ns < exact)
+            return static_cast<size_t>(ns);
+
+        int exponent = std::bit_width(ns) - 1;
+        if (exponent > maxExponent)
+            return bucketCount - 1;
+        uint64_t mantissa = ns >> (exponent - subBucketBits); // [32, 64)
+        return exact + static_cast<size_t>(exponent - subBucketBits - 1) * (1 << subBucketBits) +
+               static_cast<size_t>(mantissa - (1 << subBucketBits));
+    }
+
+    uint64_t Histogram::highest_in(size_t bucket)
+    {
+        const size_t exact = 2 << subBucketBits;
+        if (bucket < exact)
+            return bucket;
+
+        size_t k = bucket - exact;
+        int exponent = static_cast<int>(k >> subBucketBits) + subBucketBits + 1;
+        uint64_t mantissa = (k & ((1 << subBucketBits) - 1)) + (1 << subBucketBits);
+        return ((mantissa + 1) << (exponent - subBucketBits)) - 1;
+    }
+
+    void Histogram::record(uint64_t ns)
+    {
+        buckets[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(ns, std::memory_order_relaxed);
+
+        uint64_t seen = minimum.load(std::memory_order_relaxed);
+        while (ns < seen && !minimum.compare_exchange_weak(seen, ns, std::memory_order_relaxed))
+            ;
+        seen = maximum.load(std::memory_order_relaxed);
+        while (ns > seen && !maximum.compare_exchange_weak(seen, ns, std::memory_order_relaxed))
+            ;
+    }
+
+    uint64_t Histogram::percentile(double p) const
+    {
+        // Bucket counts are read one by one while other threads record, so they may add up
+        // to a little more than total. Both only grow, which keeps the walk in range.
+        uint64_t n = count();
+        if (n == 0)
+            return 0;
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * n + 0.5));
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucketCount; ++i)
+        {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return std::min(highest_in(i), maximum.load(std::memory_order_relaxed));
+        }
+        return maximum.load(std::memory_order_relaxed);
+    }
+
+    Histogram::Summary Histogram::summary() const
+    {
+        Summary s;
+        s.count = count();
+        if (s.count == 0)
+            return s;
+        s.sum = sum.load(std::memory_order_relaxed);
+        s.min = minimum.load(std::memory_order_relaxed);
+        s.mean = s.sum / s.count;
+        s.p50 = percentile(50);
+        s.p90 = percentile(90);
+        s.p99 = percentile(99);
+        s.p999 = percentile(99.9);
+        s.max = maximum.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void Histogram::reset()
+    {
+        for (auto &bucket : buckets)
+            bucket.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        minimum.store(UINT64_MAX, std::memory_order_relaxed);
+        maximum.store(0, std::memory_order_relaxed);
+    }
+
+    // -------------------- Registry --------------------
+    Histogram &histogram(Stage stage)
+    {
+        return stages[stage];
+    }
+
+    const char *stage_name(Stage stage)
+    {
+        return stageNames[stage];
+    }
+
+    const char *counter_name(Counter counter)
+    {
+        return counterNames[counter];
+    }
+
+    void count(Counter counter, uint64_t n)
+    {
+        counters[counter].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t counter(Counter counter)
+    {
+        return counters[counter].load(std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        for (Histogram &stage : stages)
+            stage.reset();
+        for (auto &value : counters)
+            value.store(0, std::memory_order_relaxed);
+    }
+
+    // -------------------- Startup --------------------
+    void startup_begin()
+    {
+        startupStartNs.store(now_ns(), std::memory_order_relaxed);
+    }
+
+    void startup_mark(Milestone milestone)
+    {
+        const uint64_t start = startupStartNs.load(std::memory_order_relaxed);
+        if (start == 0)
+            return;
+        uint64_t unset = 0;
+        const uint64_t elapsed = std::max<uint64_t>(now_ns() - start, 1);
+        if (milestones[milestone].compare_exchange_strong(unset, elapsed, std::memory_order_relaxed))
+            std::cout << "Startup: " << milestoneNames[milestone] << " after " << elapsed / 1000000.0 << " ms" << std::endl;
+    }
+
+    uint64_t startup_ns(Milestone milestone)
+    {
+        return milestones[milestone].load(std::memory_order_relaxed);
+    }
+
+    // -------------------- Report --------------------
+    // 950 ns, 12.3 us, 4.56 ms, 1.20 s
+    static std::string format_ns(uint64_t ns)
+    {
+        char text[32];
+        if (ns < 1000)
+            std::snprintf(text, sizeof(text), "%llu ns", static_cast<unsigned long long>(ns));
+        else if (ns < 1000000)
+            std::snprintf(text, sizeof(text), "%.1f us", ns / 1e3);
+        else if (ns < 1000000000)
+            std::snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+        else
+            std::snprintf(text, sizeof(text), "%.2f s", ns / 1e9);
+        return text;
+    }
+
+    void write_report(std::ostream &out)
+    {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-12s %8s %10s %10s %10s %10s %10s %10s\n",
+                      "stage", "count", "min", "p50", "p90", "p99", "p99.9", "max");
+        out << line;
+        for (int i = 0; i < STAGE_COUNT; ++i)
+        {
+            Histogram::Summary s = stages[i].summary();
+            if (s.count == 0)
+            {
+                std::snprintf(line, sizeof(line), "%-12s %8d %10s %10s %10s %10s %10s %10s\n",
+                              stageNames[i], 0, "-", "-", "-", "-", "-", "-");
+                out << line;
+                continue;
+            }
+            std::snprintf(line, sizeof(line), "%-12s %8llu %10s %10s %10s %10s %10s %10s\n",
+                          stageNames[i], static_cast<unsigned long long>(s.count),
+                          format_ns(s.min).c_str(), format_ns(s.p50).c_str(), format_ns(s.p90).c_str(),
+                          format_ns(s.p99).c_str(), format_ns(s.p999).c_str(), format_ns(s.max).c_str());
+            out << line;
+        }
+
+        out << "\n";
+        for (int i = 0; i < COUNTER_COUNT; ++i)
+        {
+            std::snprintf(line, sizeof(line), "%-18s %llu\n", counterNames[i],
+                          static_cast<unsigned long long>(counters[i].load(std::memory_order_relaxed)));
+            out << line;
+        }
+
+        if (startupStartNs.load(std::memory_order_relaxed) != 0)
+        {
+            out << "\n";
+            for (int i = 0; i < MILESTONE_COUNT; ++i)
+            {
+                const uint64_t ns = milestones[i].load(std::memory_order_relaxed);
+                std::snprintf(line, sizeof(line), "startup %-13s %10s\n", milestoneNames[i], ns ? format_ns(ns).c_str() : "-");
+                out << line;
+            }
+        }
+        out.flush();
+    }
+
+    // "truncated frames" -> "truncated_frames"
+    static std::string metric_name(const char *name)
+    {
+        std::string text(name);
+        std::replace(text.begin(), text.end(), ' ', '_');
+        return text;
+    }
+
+    void write_openmetrics(std::ostream &out)
+    {
+        char line[160];
+        out << "# TYPE mouse_client_stage_seconds summary\n"
+               "# HELP mouse_client_stage_seconds Time spent in each stage of a poll cycle.\n";
+        for (int i = 0; i < STAGE_COUNT; ++i)
+        {
+            const std::string stage = metric_name(stageNames[i]);
+            Histogram::Summary s = stages[i].summary();
+            const std::pair<const char *, uint64_t> quantiles[] = {
+                {"0.5", s.p50}, {"0.9", s.p90}, {"0.99", s.p99}, {"0.999", s.p999}};
+            if (s.count > 0)
+            {
+                for (const auto &[quantile, ns] : quantiles)
+                {
+                    std::snprintf(line, sizeof(line), "mouse_client_stage_seconds{stage=\"%s\",quantile=\"%s\"} %.9f\n",
+                                  stage.c_str(), quantile, ns / 1e9);
+                    out << line;
+                }
+            }
+            std::snprintf(line, sizeof(line), "mouse_client_stage_seconds_sum{stage=\"%s\"} %.9f\n"
+                                              "mouse_client_stage_seconds_count{stage=\"%s\"} %llu\n",
+                          stage.c_str(), s.sum / 1e9, stage.c_str(), static_cast<unsigned long long>(s.count));
+            out << line;
+        }
+
+        for (int i = 0; i < COUNTER_COUNT; ++i)
+        {
+            const std::string name = "mouse_client_" + metric_name(counterNames[i]);
+            out << "# TYPE " << name << " counter\n"
+                << name << "_total " << counters[i].load(std::memory_order_relaxed) << "\n";
+        }
+    }
+}
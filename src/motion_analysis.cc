@@ -0,0 +1,573 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOTION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "include/motion_analysis.hpp"
+
+namespace Motion
+{
+    namespace
+    {
+        struct SeriesSums
+        {
+            int64_t sum = 0;
+            uint64_t squares = 0;
+            int16_t min = INT16_MAX;
+            int16_t max = INT16_MIN;
+            uint64_t accelSquares = 0;
+            uint32_t accelMaxAbs = 0;
+        };
+
+        struct DeltaSums
+        {
+            uint64_t absSum = 0;
+            uint32_t maxAbs = 0;
+            uint64_t changed = 0;
+        };
+
+        // Sample i of v, and its acceleration from sample i - 1
+        inline void add_sample(SeriesSums &sums, const int16_t *v, size_t i)
+        {
+            const int32_t value = v[i];
+            sums.sum += value;
+            sums.squares += static_cast<uint64_t>(int64_t(value) * value);
+            sums.min = std::min(sums.min, v[i]);
+            sums.max = std::max(sums.max, v[i]);
+            if (i == 0)
+                return;
+            const int32_t accel = value - v[i - 1];
+            const uint32_t magnitude = static_cast<uint32_t>(accel < 0 ? -accel : accel);
+            sums.accelSquares += uint64_t(magnitude) * magnitude;
+            sums.accelMaxAbs = std::max(sums.accelMaxAbs, magnitude);
+        }
+
+        inline void add_delta(DeltaSums &sums, int16_t before, int16_t after)
+        {
+            const int32_t delta = int32_t(after) - before;
+            const uint32_t magnitude = static_cast<uint32_t>(delta < 0 ? -delta : delta);
+            sums.absSum += magnitude;
+            sums.maxAbs = std::max(sums.maxAbs, magnitude);
+            sums.changed += delta != 0;
+        }
+
+        inline float speed_of(int16_t x, int16_t y)
+        {
+            const uint32_t squared = static_cast<uint32_t>(int32_t(x) * x + int32_t(y) * y);
+            return std::sqrt(static_cast<float>(squared));
+        }
+
+        SeriesSums series_scalar(const int16_t *v, size_t n)
+        {
+            SeriesSums sums;
+            for (size_t i = 0; i < n; ++i)
+                add_sample(sums, v, i);
+            return sums;
+        }
+
+        DeltaSums delta_scalar(const int16_t *before, const int16_t *after, size_t n)
+        {
+            DeltaSums sums;
+            for (size_t i = 0; i < n; ++i)
+                add_delta(sums, before[i], after[i]);
+            return sums;
+        }
+
+        using Bins = std::array<uint64_t, histogramSide * histogramSide>;
+
+        inline void add_bin(Bins &bins, int16_t beforeX, int16_t beforeY, int16_t afterX, int16_t afterY)
+        {
+            const int dx = std::clamp(int(afterX) - beforeX, -histogramRadius, histogramRadius);
+            const int dy = std::clamp(int(afterY) - beforeY, -histogramRadius, histogramRadius);
+            ++bins[static_cast<size_t>((dy + histogramRadius) * histogramSide + dx + histogramRadius)];
+        }
+
+        void histogram_scalar(const Capture &capture, size_t n, Bins &bins)
+        {
+            for (size_t i = 0; i < n; ++i)
+                add_bin(bins, capture.before_x[i], capture.before_y[i], capture.after_x[i], capture.after_y[i]);
+        }
+
+        uint64_t nonzero_scalar(const uint8_t *v, size_t n)
+        {
+            uint64_t count = 0;
+            for (size_t i = 0; i < n; ++i)
+                count += v[i] != 0;
+            return count;
+        }
+
+        double speed_scalar(const int16_t *x, const int16_t *y, size_t n, float *out)
+        {
+            double sum = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                const float s = speed_of(x[i], y[i]);
+                if (out)
+                    out[i] = s;
+                sum += s;
+            }
+            return sum;
+        }
+
+#ifdef MOTION_SSE2
+        // Steps between flushes of the int32 sums to 64 bits, a lane gains less than 2^17 a step
+        constexpr size_t flushSteps = 8192;
+
+        inline __m128i widen_lo(__m128i v) { return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16); }
+        inline __m128i widen_hi(__m128i v) { return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16); }
+
+        inline __m128i abs32(__m128i v)
+        {
+            const __m128i sign = _mm_srai_epi32(v, 31);
+            return _mm_sub_epi32(_mm_xor_si128(v, sign), sign);
+        }
+
+        inline __m128i max32(__m128i a, __m128i b)
+        {
+            const __m128i greater = _mm_cmpgt_epi32(a, b);
+            return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+        }
+
+        // Lanes taken as unsigned, added into two uint64 lanes
+        inline __m128i add_u32_to_u64(__m128i sum, __m128i v)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            return _mm_add_epi64(sum, _mm_add_epi64(_mm_unpacklo_epi32(v, zero), _mm_unpackhi_epi32(v, zero)));
+        }
+
+        // Squares of lanes below 2^16 as unsigned, added into two uint64 lanes
+        inline __m128i add_squares(__m128i sum, __m128i v)
+        {
+            const __m128i odd = _mm_srli_epi64(v, 32);
+            return _mm_add_epi64(_mm_add_epi64(sum, _mm_mul_epu32(v, v)), _mm_mul_epu32(odd, odd));
+        }
+
+        inline uint64_t sum_u64(__m128i v)
+        {
+            alignas(16) uint64_t lanes[2];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), v);
+            return lanes[0] + lanes[1];
+        }
+
+        inline int64_t sum_i32(__m128i v)
+        {
+            alignas(16) int32_t lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), v);
+            return int64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+        }
+
+        inline uint32_t max_u32(__m128i v)
+        {
+            alignas(16) uint32_t lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), v);
+            return std::max({lanes[0], lanes[1], lanes[2], lanes[3]});
+        }
+
+        SeriesSums series_sse2(const int16_t *v, size_t n)
+        {
+            SeriesSums sums;
+            if (n == 0)
+                return sums;
+            add_sample(sums, v, 0);
+
+            const __m128i ones = _mm_set1_epi16(1);
+            __m128i low = _mm_set1_epi16(INT16_MAX), high = _mm_set1_epi16(INT16_MIN);
+            __m128i squares = _mm_setzero_si128(), accelSquares = _mm_setzero_si128();
+            __m128i accelMax = _mm_setzero_si128();
+            size_t i = 1;
+            while (n - i >= 8)
+            {
+                const size_t stop = i + std::min((n - i) / 8, flushSteps) * 8;
+                __m128i sum = _mm_setzero_si128();
+                for (; i < stop; i += 8)
+                {
+                    const __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + i));
+                    const __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + i - 1));
+                    low = _mm_min_epi16(low, cur);
+                    high = _mm_max_epi16(high, cur);
+                    sum = _mm_add_epi32(sum, _mm_madd_epi16(cur, ones));
+                    // x * x + y * y of two int16 fits a uint32
+                    squares = add_u32_to_u64(squares, _mm_madd_epi16(cur, cur));
+
+                    const __m128i accelLo = abs32(_mm_sub_epi32(widen_lo(cur), widen_lo(prev)));
+                    const __m128i accelHi = abs32(_mm_sub_epi32(widen_hi(cur), widen_hi(prev)));
+                    accelMax = max32(accelMax, max32(accelLo, accelHi));
+                    accelSquares = add_squares(add_squares(accelSquares, accelLo), accelHi);
+                }
+                sums.sum += sum_i32(sum);
+            }
+
+            alignas(16) int16_t lows[8], highs[8];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lows), low);
+            _mm_store_si128(reinterpret_cast<__m128i *>(highs), high);
+            sums.min = std::min(sums.min, *std::min_element(lows, lows + 8));
+            sums.max = std::max(sums.max, *std::max_element(highs, highs + 8));
+            sums.squares += sum_u64(squares);
+            sums.accelSquares += sum_u64(accelSquares);
+            sums.accelMaxAbs = std::max(sums.accelMaxAbs, max_u32(accelMax));
+
+            for (; i < n; ++i)
+                add_sample(sums, v, i);
+            return sums;
+        }
+
+        DeltaSums delta_sse2(const int16_t *before, const int16_t *after, size_t n)
+        {
+            DeltaSums sums;
+            __m128i absSum = _mm_setzero_si128(), maxAbs = _mm_setzero_si128();
+            size_t i = 0;
+            while (n - i >= 8)
+            {
+                const size_t stop = i + std::min((n - i) / 8, flushSteps) * 8;
+                __m128i blockSum = _mm_setzero_si128();
+                for (; i < stop; i += 8)
+                {
+                    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(before + i));
+                    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(after + i));
+                    const int equalBytes = _mm_movemask_epi8(_mm_cmpeq_epi16(a, b));
+                    sums.changed += 8 - std::popcount(static_cast<unsigned>(equalBytes)) / 2;
+
+                    const __m128i deltaLo = abs32(_mm_sub_epi32(widen_lo(a), widen_lo(b)));
+                    const __m128i deltaHi = abs32(_mm_sub_epi32(widen_hi(a), widen_hi(b)));
+                    maxAbs = max32(maxAbs, max32(deltaLo, deltaHi));
+                    blockSum = _mm_add_epi32(blockSum, _mm_add_epi32(deltaLo, deltaHi));
+                }
+                absSum = add_u32_to_u64(absSum, blockSum);
+            }
+            sums.absSum = sum_u64(absSum);
+            sums.maxAbs = max_u32(maxAbs);
+
+            for (; i < n; ++i)
+                add_delta(sums, before[i], after[i]);
+            return sums;
+        }
+
+        // Most samples leave the filter unmoved and would all increment the same bin one after
+        // the other. They are counted eight at a time, only the moved ones are scattered.
+        void histogram_sse2(const Capture &capture, size_t n, Bins &bins)
+        {
+            const int16_t *bx = capture.before_x.data(), *by = capture.before_y.data();
+            const int16_t *ax = capture.after_x.data(), *ay = capture.after_y.data();
+            uint64_t unmoved = 0;
+            size_t i = 0;
+            for (; n - i >= 8; i += 8)
+            {
+                const __m128i sameX = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ax + i)),
+                                                      _mm_loadu_si128(reinterpret_cast<const __m128i *>(bx + i)));
+                const __m128i sameY = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ay + i)),
+                                                      _mm_loadu_si128(reinterpret_cast<const __m128i *>(by + i)));
+                const unsigned same = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(sameX, sameY)));
+                unmoved += static_cast<uint64_t>(std::popcount(same) / 2);
+                // Two mask bits per sample
+                for (unsigned moved = ~same & 0xffff; moved; moved &= moved - 1, moved &= moved - 1)
+                {
+                    const size_t k = i + static_cast<size_t>(std::countr_zero(moved)) / 2;
+                    add_bin(bins, bx[k], by[k], ax[k], ay[k]);
+                }
+            }
+            bins[static_cast<size_t>(histogramRadius * histogramSide + histogramRadius)] += unmoved;
+            for (; i < n; ++i)
+                add_bin(bins, bx[i], by[i], ax[i], ay[i]);
+        }
+
+        uint64_t nonzero_sse2(const uint8_t *v, size_t n)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            uint64_t count = 0;
+            size_t i = 0;
+            for (; n - i >= 16; i += 16)
+            {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + i));
+                count += 16 - std::popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero))));
+            }
+            return count + nonzero_scalar(v + i, n - i);
+        }
+
+        inline __m128 speed4(__m128i squared)
+        {
+            // Only (-32768, -32768) reaches 2^31, which the signed conversion wraps
+            __m128 f = _mm_cvtepi32_ps(squared);
+            f = _mm_add_ps(f, _mm_and_ps(_mm_cmplt_ps(f, _mm_setzero_ps()), _mm_set1_ps(4294967296.0f)));
+            return _mm_sqrt_ps(f);
+        }
+
+        inline __m128d add_floats(__m128d sum, __m128 v)
+        {
+            return _mm_add_pd(_mm_add_pd(sum, _mm_cvtps_pd(v)), _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+        }
+
+        double speed_sse2(const int16_t *x, const int16_t *y, size_t n, float *out)
+        {
+            __m128d sum = _mm_setzero_pd();
+            size_t i = 0;
+            for (; n - i >= 8; i += 8)
+            {
+                const __m128i vx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(x + i));
+                const __m128i vy = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + i));
+                // Interleaved (x, y) pairs, madd squares and adds each pair
+                const __m128i pairsLo = _mm_unpacklo_epi16(vx, vy);
+                const __m128i pairsHi = _mm_unpackhi_epi16(vx, vy);
+                const __m128 lo = speed4(_mm_madd_epi16(pairsLo, pairsLo));
+                const __m128 hi = speed4(_mm_madd_epi16(pairsHi, pairsHi));
+                if (out)
+                {
+                    _mm_storeu_ps(out + i, lo);
+                    _mm_storeu_ps(out + i + 4, hi);
+                }
+                sum = add_floats(add_floats(sum, lo), hi);
+            }
+            alignas(16) double lanes[2];
+            _mm_store_pd(lanes, sum);
+            return lanes[0] + lanes[1] + speed_scalar(x + i, y + i, n - i, out ? out + i : nullptr);
+        }
+
+        void difference_sse2(const int16_t *a, const int16_t *b, size_t n, int32_t *out)
+        {
+            size_t i = 0;
+            for (; n - i >= 8; i += 8)
+            {
+                const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+                const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_sub_epi32(widen_lo(va), widen_lo(vb)));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 4), _mm_sub_epi32(widen_hi(va), widen_hi(vb)));
+            }
+            for (; i < n; ++i)
+                out[i] = int32_t(a[i]) - b[i];
+        }
+#endif
+
+        bool use_vector(Kernels kernels)
+        {
+#ifdef MOTION_SSE2
+            return kernels == Kernels::VECTOR;
+#else
+            (void)kernels;
+            return false;
+#endif
+        }
+
+        SeriesSums series(const std::vector<int16_t> &v, size_t n, Kernels kernels)
+        {
+#ifdef MOTION_SSE2
+            if (use_vector(kernels))
+                return series_sse2(v.data(), n);
+#endif
+            (void)kernels;
+            return series_scalar(v.data(), n);
+        }
+
+        DeltaSums delta(const std::vector<int16_t> &before, const std::vector<int16_t> &after, size_t n,
+                        Kernels kernels)
+        {
+#ifdef MOTION_SSE2
+            if (use_vector(kernels))
+                return delta_sse2(before.data(), after.data(), n);
+#endif
+            (void)kernels;
+            return delta_scalar(before.data(), after.data(), n);
+        }
+
+        uint64_t nonzero(const std::vector<uint8_t> &v, size_t n, Kernels kernels)
+        {
+#ifdef MOTION_SSE2
+            if (use_vector(kernels))
+                return nonzero_sse2(v.data(), n);
+#endif
+            (void)kernels;
+            return nonzero_scalar(v.data(), n);
+        }
+
+        void histogram(const Capture &capture, size_t n, Bins &bins, Kernels kernels)
+        {
+#ifdef MOTION_SSE2
+            if (use_vector(kernels))
+            {
+                histogram_sse2(capture, n, bins);
+                return;
+            }
+#endif
+            (void)kernels;
+            histogram_scalar(capture, n, bins);
+        }
+
+        double speed_sum(const std::vector<int16_t> &x, const std::vector<int16_t> &y, size_t n, float *out,
+                         Kernels kernels)
+        {
+#ifdef MOTION_SSE2
+            if (use_vector(kernels))
+                return speed_sse2(x.data(), y.data(), n, out);
+#endif
+            (void)kernels;
+            return speed_scalar(x.data(), y.data(), n, out);
+        }
+
+        void difference(const int16_t *a, const int16_t *b, size_t n, int32_t *out, Kernels kernels)
+        {
+#ifdef MOTION_SSE2
+            if (use_vector(kernels))
+            {
+                difference_sse2(a, b, n, out);
+                return;
+            }
+#endif
+            (void)kernels;
+            for (size_t i = 0; i < n; ++i)
+                out[i] = int32_t(a[i]) - b[i];
+        }
+
+        DeltaStats delta_stats(const DeltaSums &sums, size_t n)
+        {
+            DeltaStats stats;
+            stats.meanAbs = double(sums.absSum) / double(n);
+            stats.maxAbs = sums.maxAbs;
+            stats.changed = sums.changed;
+            return stats;
+        }
+    }
+
+    const char *vector_kernels()
+    {
+#ifdef MOTION_SSE2
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+
+    Analysis analyze(const Capture &capture, Kernels kernels)
+    {
+        Analysis analysis;
+        const size_t n = capture.size();
+        analysis.samples = n;
+        if (n == 0)
+            return analysis;
+
+        const std::vector<int16_t> *columns[AXIS_COUNT] = {&capture.before_x, &capture.before_y,
+                                                           &capture.after_x, &capture.after_y};
+        for (int axis = 0; axis < AXIS_COUNT; ++axis)
+        {
+            const SeriesSums sums = series(*columns[axis], n, kernels);
+            AxisStats &stats = analysis.axes[axis];
+            stats.min = sums.min;
+            stats.max = sums.max;
+            stats.mean = double(sums.sum) / double(n);
+            stats.stddev = std::sqrt(std::max(0.0, double(sums.squares) / double(n) - stats.mean * stats.mean));
+            stats.accelRms = n > 1 ? std::sqrt(double(sums.accelSquares) / double(n - 1)) : 0.0;
+            stats.accelMaxAbs = sums.accelMaxAbs;
+        }
+
+        analysis.deltaX = delta_stats(delta(capture.before_x, capture.after_x, n, kernels), n);
+        analysis.deltaY = delta_stats(delta(capture.before_y, capture.after_y, n, kernels), n);
+        analysis.xCondTriggers = nonzero(capture.x_cond, n, kernels);
+        analysis.yCondTriggers = nonzero(capture.y_cond, n, kernels);
+        analysis.speedBefore = speed_sum(capture.before_x, capture.before_y, n, nullptr, kernels) / double(n);
+        analysis.speedAfter = speed_sum(capture.after_x, capture.after_y, n, nullptr, kernels) / double(n);
+
+        Bins bins{};
+        histogram(capture, n, bins, kernels);
+        for (int dy = 0; dy < histogramSide; ++dy)
+            for (int dx = 0; dx < histogramSide; ++dx)
+                analysis.deltaHistogram[dy][dx] = bins[static_cast<size_t>(dy * histogramSide + dx)];
+        return analysis;
+    }
+
+    void write_report(std::ostream &out, const Analysis &analysis)
+    {
+        char line[160];
+        const double n = double(std::max<uint64_t>(analysis.samples, 1));
+        std::snprintf(line, sizeof(line), "Samples:            %llu\n", static_cast<unsigned long long>(analysis.samples));
+        out << line;
+        std::snprintf(line, sizeof(line), "x_cond triggers:    %llu (%.2f %%)\n",
+                      static_cast<unsigned long long>(analysis.xCondTriggers), 100.0 * analysis.xCondTriggers / n);
+        out << line;
+        std::snprintf(line, sizeof(line), "y_cond triggers:    %llu (%.2f %%)\n",
+                      static_cast<unsigned long long>(analysis.yCondTriggers), 100.0 * analysis.yCondTriggers / n);
+        out << line;
+        if (analysis.samples == 0)
+            return;
+
+        out << "\n                     before_x  before_y   after_x   after_y\n";
+        auto row = [&](const char *name, auto value, const char *format)
+        {
+            int length = std::snprintf(line, sizeof(line), "%-19s", name);
+            for (const AxisStats &axis : analysis.axes)
+                length += std::snprintf(line + length, sizeof(line) - static_cast<size_t>(length), format, value(axis));
+            out << line << "\n";
+        };
+        row("Min", [](const AxisStats &a)
+            { return int(a.min); }, "%10d");
+        row("Max", [](const AxisStats &a)
+            { return int(a.max); }, "%10d");
+        row("Mean", [](const AxisStats &a)
+            { return a.mean; }, "%10.3f");
+        row("Stddev", [](const AxisStats &a)
+            { return a.stddev; }, "%10.3f");
+        row("Jitter (RMS accel)", [](const AxisStats &a)
+            { return a.accelRms; }, "%10.3f");
+        row("Max |accel|", [](const AxisStats &a)
+            { return a.accelMaxAbs; }, "%10u");
+
+        out << "\nFilter delta                x         y\n";
+        std::snprintf(line, sizeof(line), "%-19s%10.3f%10.3f\n", "Mean |delta|", analysis.deltaX.meanAbs,
+                      analysis.deltaY.meanAbs);
+        out << line;
+        std::snprintf(line, sizeof(line), "%-19s%10u%10u\n", "Max |delta|", analysis.deltaX.maxAbs, analysis.deltaY.maxAbs);
+        out << line;
+        std::snprintf(line, sizeof(line), "%-19s%9.2f%%%9.2f%%\n", "Moved", 100.0 * analysis.deltaX.changed / n,
+                      100.0 * analysis.deltaY.changed / n);
+        out << line;
+        std::snprintf(line, sizeof(line), "\nMean speed:         %.3f before, %.3f after (counts per report)\n",
+                      analysis.speedBefore, analysis.speedAfter);
+        out << line;
+
+        // The busiest bins of the 2D histogram
+        struct Bin
+        {
+            int dx, dy;
+            uint64_t count;
+        };
+        std::vector<Bin> bins;
+        for (int dy = 0; dy < histogramSide; ++dy)
+            for (int dx = 0; dx < histogramSide; ++dx)
+                if (analysis.deltaHistogram[dy][dx])
+                    bins.push_back({dx - histogramRadius, dy - histogramRadius, analysis.deltaHistogram[dy][dx]});
+        std::sort(bins.begin(), bins.end(), [](const Bin &a, const Bin &b)
+                  { return a.count > b.count; });
+        out << "\nMost common filter deltas (dx, dy), edges include everything beyond +-" << histogramRadius << "\n";
+        for (size_t i = 0; i < std::min<size_t>(bins.size(), 8); ++i)
+        {
+            std::snprintf(line, sizeof(line), "  (%3d, %3d) %12llu  %6.2f %%\n", bins[i].dx, bins[i].dy,
+                          static_cast<unsigned long long>(bins[i].count), 100.0 * bins[i].count / n);
+            out << line;
+        }
+    }
+
+    void speed(const std::vector<int16_t> &x, const std::vector<int16_t> &y, std::vector<float> &out, Kernels kernels)
+    {
+        const size_t n = std::min(x.size(), y.size());
+        out.resize(n);
+        speed_sum(x, y, n, out.data(), kernels);
+    }
+
+    void acceleration(const std::vector<int16_t> &v, std::vector<int32_t> &out, Kernels kernels)
+    {
+        out.resize(v.size());
+        if (v.empty())
+            return;
+        out[0] = 0;
+        difference(v.data() + 1, v.data(), v.size() - 1, out.data() + 1, kernels);
+    }
+
+    void filter_delta(const std::vector<int16_t> &before, const std::vector<int16_t> &after, std::vector<int32_t> &out,
+                      Kernels kernels)
+    {
+        const size_t n = std::min(before.size(), after.size());
+        out.resize(n);
+        difference(after.data(), before.data(), n, out.data(), kernels);
+    }
+}
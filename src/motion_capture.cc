@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "include/motion_capture.hpp"
+
+namespace Motion
+{
+    namespace
+    {
+        // Value of a hex digit, -1 for anything else
+        constexpr std::array<int8_t, 256> hexDigits = []
+        {
+            std::array<int8_t, 256> digits{};
+            digits.fill(-1);
+            for (int c = 0; c < 10; ++c)
+                digits['0' + c] = static_cast<int8_t>(c);
+            for (int c = 0; c < 6; ++c)
+                digits['a' + c] = digits['A' + c] = static_cast<int8_t>(10 + c);
+            return digits;
+        }();
+
+        // "0xHH-0xLL" starting at the 'x' at p as a two's complement 16 bit value
+        bool decode_pair(const char *p, const char *end, int16_t &value)
+        {
+            if (end - p < 8 || p[3] != '-' || p[4] != '0' || p[5] != 'x')
+                return false;
+            const int digits[4] = {hexDigits[static_cast<uint8_t>(p[1])], hexDigits[static_cast<uint8_t>(p[2])],
+                                   hexDigits[static_cast<uint8_t>(p[6])], hexDigits[static_cast<uint8_t>(p[7])]};
+            if ((digits[0] | digits[1] | digits[2] | digits[3]) < 0)
+                return false;
+            value = static_cast<int16_t>(static_cast<uint16_t>(digits[0] << 12 | digits[1] << 8 | digits[2] << 4 | digits[3]));
+            return true;
+        }
+
+        // "|X:... 0xHH-0xLL - Y:... 0xHH-0xLL". The bit strings and labels hold no lowercase x,
+        // so the first two found are the pairs.
+        bool parse_xy(std::string_view line, int16_t &x, int16_t &y)
+        {
+            const char *end = line.data() + line.size();
+            const char *p = static_cast<const char *>(std::memchr(line.data(), 'x', line.size()));
+            if (!p || p == line.data() || p[-1] != '0' || !decode_pair(p, end, x))
+                return false;
+            p += 8;
+            p = static_cast<const char *>(std::memchr(p, 'x', static_cast<size_t>(end - p)));
+            return p && p[-1] == '0' && decode_pair(p, end, y);
+        }
+
+        bool is_blank(char c)
+        {
+            return c == ' ' || c == '\r' || c == '\0' || c == '\t';
+        }
+
+        // Lines come as "\r[ 3 ] ---\r" or "\0before: ...", strip the stray CR/NUL/space
+        std::string_view trim(std::string_view s)
+        {
+            while (!s.empty() && is_blank(s.front()))
+                s.remove_prefix(1);
+            while (!s.empty() && is_blank(s.back()))
+                s.remove_suffix(1);
+            return s;
+        }
+
+        bool parse_uint(std::string_view s, uint32_t &out)
+        {
+            while (!s.empty() && s.front() == ' ')
+                s.remove_prefix(1);
+            return std::from_chars(s.data(), s.data() + s.size(), out).ec == std::errc();
+        }
+    }
+
+    void Capture::reserve(size_t samples)
+    {
+        block.reserve(samples);
+        before_x.reserve(samples);
+        before_y.reserve(samples);
+        after_x.reserve(samples);
+        after_y.reserve(samples);
+        x_cond.reserve(samples);
+        y_cond.reserve(samples);
+    }
+
+    void Capture::clear()
+    {
+        block.clear();
+        before_x.clear();
+        before_y.clear();
+        after_x.clear();
+        after_y.clear();
+        x_cond.clear();
+        y_cond.clear();
+    }
+
+    void Decoder::store_sample(uint8_t xCond, uint8_t yCond)
+    {
+        capture.block.push_back(block);
+        capture.before_x.push_back(beforeX);
+        capture.before_y.push_back(beforeY);
+        capture.after_x.push_back(afterX);
+        capture.after_y.push_back(afterY);
+        capture.x_cond.push_back(xCond);
+        capture.y_cond.push_back(yCond);
+        inBlock = false;
+    }
+
+    void Decoder::flush_block()
+    {
+        if (inBlock && !(haveBefore && haveAfter))
+            incompleteBlocks++;
+        inBlock = haveBefore = haveAfter = false;
+    }
+
+    void Decoder::feed_line(std::string_view line)
+    {
+        line = trim(line);
+        if (line.empty())
+            return;
+
+        switch (line.front())
+        {
+        case '[': // "[ 12 ] -------------"
+        {
+            flush_block();
+            if (!parse_uint(line.substr(1), block))
+            {
+                malformedLines++;
+                return;
+            }
+            inBlock = true;
+            return;
+        }
+        case 'b':
+            if (line.starts_with("before:") && inBlock)
+            {
+                haveBefore = parse_xy(line, beforeX, beforeY);
+                malformedLines += !haveBefore;
+            }
+            return;
+        case 'a':
+            if (line.starts_with("after:") && inBlock)
+            {
+                haveAfter = parse_xy(line, afterX, afterY);
+                malformedLines += !haveAfter;
+            }
+            return;
+        case 'x': // "x_cond: 0 - y_cond: 1" closes the block
+        {
+            if (!line.starts_with("x_cond:") || !inBlock)
+                return;
+
+            uint32_t xCond = 0, yCond = 0;
+            size_t y = line.find("y_cond:");
+            if (!parse_uint(line.substr(7), xCond) || y == std::string_view::npos ||
+                !parse_uint(line.substr(y + 7), yCond))
+            {
+                malformedLines++;
+                xCond = yCond = 0;
+            }
+
+            if (haveBefore && haveAfter)
+                store_sample(static_cast<uint8_t>(xCond), static_cast<uint8_t>(yCond));
+            flush_block();
+            return;
+        }
+        default:
+            return; // banner lines such as "---- START"
+        }
+    }
+
+    void Decoder::finish(bool endOfStream)
+    {
+        // Stream cut before the x_cond line, keep the readings without conditions
+        if (endOfStream && inBlock && haveBefore && haveAfter)
+            store_sample(0, 0);
+        flush_block();
+    }
+
+    void decode_text(std::string_view text, Decoder &decoder)
+    {
+        const char *p = text.data();
+        const char *end = p + text.size();
+        while (p < end)
+        {
+            const char *eol = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!eol)
+                eol = end;
+            decoder.feed_line(std::string_view(p, static_cast<size_t>(eol - p)));
+            p = eol + 1;
+        }
+    }
+
+    size_t next_block_start(std::string_view text, size_t pos)
+    {
+        if (pos == 0)
+            return 0;
+        // From the end of the line before pos, so pos itself counts if it starts a line
+        size_t search = std::min(pos, text.size()) - 1;
+        for (;;)
+        {
+            const void *eol = std::memchr(text.data() + search, '\n', text.size() - search);
+            if (!eol)
+                return text.size();
+            const size_t start = static_cast<size_t>(static_cast<const char *>(eol) - text.data()) + 1;
+            size_t first = start;
+            while (first < text.size() && is_blank(text[first]))
+                ++first;
+            if (first < text.size() && text[first] == '[')
+                return start;
+            search = start;
+        }
+    }
+
+    bool decode_file(const std::string &path, Decoder &decoder)
+    {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in)
+        {
+            std::cerr << "Cannot open " << path << std::endl;
+            return false;
+        }
+
+        std::string text(static_cast<size_t>(in.tellg()), '\0');
+        in.seekg(0);
+        in.read(text.data(), static_cast<std::streamsize>(text.size()));
+
+        decode_text(text, decoder);
+        decoder.finish();
+        return true;
+    }
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+#include "include/mapped_file.hpp"
+#include "include/motion_ingest.hpp"
+#include "include/motion_store.hpp"
+#include "include/work_pool.hpp"
+
+namespace Motion
+{
+    namespace
+    {
+        struct Part
+        {
+            size_t begin = 0, end = 0;
+            Capture capture;
+            size_t incompleteBlocks = 0;
+            size_t malformedLines = 0;
+        };
+
+        struct FileJob
+        {
+            std::string path;
+            MappedFile text;
+            uint64_t textBytes = 0;
+            std::vector<Part> parts;
+            std::atomic<size_t> remaining{0};
+            EncodedCapture encoded;
+            bool ok = false;
+            bool done = false; // under doneMutex
+        };
+
+        // Joins the decoded parts of a file in order and encodes them, dropping the parts
+        void finish_file(FileJob &job)
+        {
+            Capture capture;
+            size_t samples = 0;
+            for (const Part &part : job.parts)
+                samples += part.capture.size();
+            capture.reserve(samples);
+            for (Part &part : job.parts)
+            {
+                const Capture &from = part.capture;
+                auto append = [](auto &to, const auto &column)
+                { to.insert(to.end(), column.begin(), column.end()); };
+                append(capture.block, from.block);
+                append(capture.before_x, from.before_x);
+                append(capture.before_y, from.before_y);
+                append(capture.after_x, from.after_x);
+                append(capture.after_y, from.after_y);
+                append(capture.x_cond, from.x_cond);
+                append(capture.y_cond, from.y_cond);
+                part.capture = Capture();
+            }
+            job.encoded = encode_capture(capture);
+            job.text.close();
+            job.ok = true;
+        }
+    }
+
+    bool ingest_captures(const std::vector<std::string> &textPaths, const std::string &archivePath,
+                         const IngestOptions &options, IngestResult &result)
+    {
+        result = {};
+        ColumnWriter writer;
+        if (!writer.open(archivePath))
+        {
+            std::cerr << "Cannot write " << archivePath << std::endl;
+            return false;
+        }
+
+        std::vector<std::unique_ptr<FileJob>> jobs;
+        for (const std::string &path : textPaths)
+        {
+            jobs.push_back(std::make_unique<FileJob>());
+            jobs.back()->path = path;
+        }
+
+        std::mutex doneMutex;
+        std::condition_variable doneChanged;
+        auto mark_done = [&](FileJob &job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                job.done = true;
+            }
+            doneChanged.notify_all();
+        };
+
+        WorkPool pool(options.threads);
+        const size_t partBytes = std::max<size_t>(options.partBytes, 4096);
+        for (const std::unique_ptr<FileJob> &owned : jobs)
+        {
+            FileJob *job = owned.get();
+            pool.submit([&, job]
+                        {
+                            if (!job->text.open(job->path))
+                            {
+                                std::cerr << "Cannot open " << job->path << std::endl;
+                                mark_done(*job);
+                                return;
+                            }
+                            const std::string_view text(reinterpret_cast<const char *>(job->text.data()), job->text.size());
+                            job->textBytes = text.size();
+
+                            // Parts start on block lines, so each decodes on its own
+                            size_t begin = 0;
+                            do
+                            {
+                                Part part;
+                                part.begin = begin;
+                                part.end = begin + partBytes >= text.size() ? text.size()
+                                                                            : next_block_start(text, begin + partBytes);
+                                begin = part.end;
+                                job->parts.push_back(std::move(part));
+                            } while (begin < text.size());
+                            job->remaining = job->parts.size();
+
+                            // The first part stays with this worker, the rest can be stolen
+                            for (size_t i = job->parts.size(); i-- > 0;)
+                            {
+                                auto decode = [&mark_done, text, job, i]
+                                {
+                                    Part &part = job->parts[i];
+                                    Decoder decoder(part.capture);
+                                    decode_text(text.substr(part.begin, part.end - part.begin), decoder);
+                                    decoder.finish(i + 1 == job->parts.size());
+                                    part.incompleteBlocks = decoder.incomplete_blocks();
+                                    part.malformedLines = decoder.malformed_lines();
+                                    if (job->remaining.fetch_sub(1) == 1)
+                                    {
+                                        finish_file(*job);
+                                        mark_done(*job);
+                                    }
+                                };
+                                if (i == 0)
+                                    decode();
+                                else
+                                    pool.submit(decode);
+                            } });
+        }
+
+        // Files go into the archive in the order given, each as soon as it is ready
+        for (const std::unique_ptr<FileJob> &job : jobs)
+        {
+            {
+                std::unique_lock<std::mutex> lock(doneMutex);
+                doneChanged.wait(lock, [&]
+                                 { return job->done; });
+            }
+            ++result.files;
+            if (!job->ok)
+            {
+                ++result.failed;
+                continue;
+            }
+            writer.append_encoded(std::filesystem::path(job->path).filename().string(), job->encoded);
+            result.samples += job->encoded.samples;
+            result.textBytes += job->textBytes;
+            result.parts += job->parts.size();
+            for (const Part &part : job->parts)
+            {
+                result.incompleteBlocks += part.incompleteBlocks;
+                result.malformedLines += part.malformedLines;
+            }
+            job->encoded = EncodedCapture();
+        }
+        pool.wait();
+        result.steals = pool.steals();
+
+        if (!writer.close())
+        {
+            std::cerr << "Cannot write " << archivePath << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,476 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+
+#include "include/motion_store.hpp"
+#include "include/varint.hpp"
+
+static_assert(std::endian::native == std::endian::little, "the .mcol layout is little endian");
+
+namespace Motion
+{
+    namespace
+    {
+        constexpr char magic[4] = {'M', 'C', 'O', 'L'};
+        constexpr uint16_t formatVersion = 1;
+        constexpr uint16_t archiveVersion = 2; // with a sources table
+        constexpr uint16_t columnCount = 7;
+
+        struct FileHeader
+        {
+            char magic[4];
+            uint16_t version;
+            uint16_t columns;
+            uint32_t chunkSamples;
+            uint32_t sourceCount; // version 2
+            uint64_t sampleCount;
+            uint64_t chunkCount;
+            uint64_t indexOffset;
+        };
+        static_assert(sizeof(FileHeader) == 40);
+
+        // minBlock, maxBlock, samples, bytes, offset, seven column sizes
+        constexpr size_t indexEntrySize = 4 * 4 + 8 + columnCount * 4;
+
+        struct ChunkInfo
+        {
+            uint32_t minBlock;
+            uint32_t maxBlock;
+            uint32_t samples;
+            uint32_t bytes;
+            uint64_t offset;
+        };
+
+        ChunkInfo load_entry(const uint8_t *indexBase, size_t chunk)
+        {
+            ChunkInfo info;
+            const uint8_t *p = indexBase + chunk * indexEntrySize;
+            std::memcpy(&info.minBlock, p, 4);
+            std::memcpy(&info.maxBlock, p + 4, 4);
+            std::memcpy(&info.samples, p + 8, 4);
+            std::memcpy(&info.bytes, p + 12, 4);
+            std::memcpy(&info.offset, p + 16, 8);
+            return info;
+        }
+
+        template <typename T>
+        void encode_column(std::string &out, const T *begin, const T *end)
+        {
+            int64_t previous = 0;
+            for (const T *p = begin; p < end; ++p)
+            {
+                Varint::put_signed(out, static_cast<int64_t>(*p) - previous);
+                previous = static_cast<int64_t>(*p);
+            }
+        }
+
+        // Samples [first, first + count) of capture as one chunk appended to out, its offset
+        // relative to out
+        ChunkEntry encode_chunk(const Capture &capture, size_t first, size_t count, std::string &out)
+        {
+            ChunkEntry entry{};
+            auto [minBlock, maxBlock] = std::minmax_element(capture.block.begin() + static_cast<std::ptrdiff_t>(first),
+                                                            capture.block.begin() + static_cast<std::ptrdiff_t>(first + count));
+            entry.minBlock = *minBlock;
+            entry.maxBlock = *maxBlock;
+            entry.samples = static_cast<uint32_t>(count);
+            entry.offset = out.size();
+
+            auto put_column = [&](const auto &column, int n)
+            {
+                size_t before = out.size();
+                encode_column(out, column.data() + first, column.data() + first + count);
+                entry.columnBytes[n] = static_cast<uint32_t>(out.size() - before);
+            };
+            put_column(capture.block, 0);
+            put_column(capture.before_x, 1);
+            put_column(capture.before_y, 2);
+            put_column(capture.after_x, 3);
+            put_column(capture.after_y, 4);
+            put_column(capture.x_cond, 5);
+            put_column(capture.y_cond, 6);
+            entry.bytes = static_cast<uint32_t>(out.size() - entry.offset);
+            return entry;
+        }
+
+        template <typename T>
+        void put_raw(std::string &out, T value)
+        {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        template <typename T>
+        const uint8_t *decode_column(const uint8_t *p, const uint8_t *end, uint32_t samples, std::vector<T> &out)
+        {
+            int64_t value = 0;
+            for (uint32_t i = 0; i < samples && p; ++i)
+            {
+                int64_t delta;
+                p = Varint::get_signed(p, end, delta);
+                value += delta;
+                out.push_back(static_cast<T>(value));
+            }
+            return p;
+        }
+    }
+
+    // -------------------- ColumnWriter --------------------
+    bool ColumnWriter::open(const std::string &path, uint32_t chunkSamples)
+    {
+        this->chunkSamples = std::max<uint32_t>(chunkSamples, 1);
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        pending.clear();
+        pending.reserve(this->chunkSamples);
+        index.clear();
+        sources.clear();
+        sampleCount = 0;
+
+        // Placeholder, close() writes the real header once the counts are known
+        FileHeader header{};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        return static_cast<bool>(out);
+    }
+
+    void ColumnWriter::append(const Capture &capture)
+    {
+        for (size_t i = 0; i < capture.size(); ++i)
+        {
+            pending.block.push_back(capture.block[i]);
+            pending.before_x.push_back(capture.before_x[i]);
+            pending.before_y.push_back(capture.before_y[i]);
+            pending.after_x.push_back(capture.after_x[i]);
+            pending.after_y.push_back(capture.after_y[i]);
+            pending.x_cond.push_back(capture.x_cond[i]);
+            pending.y_cond.push_back(capture.y_cond[i]);
+
+            if (pending.size() == chunkSamples)
+                write_chunk();
+        }
+    }
+
+    void ColumnWriter::write_chunk()
+    {
+        if (pending.size() == 0)
+            return;
+
+        encoded.clear();
+        ChunkEntry entry = encode_chunk(pending, 0, pending.size(), encoded);
+        entry.offset = static_cast<uint64_t>(out.tellp());
+
+        out.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+        index.push_back(entry);
+        sampleCount += entry.samples;
+        pending.clear();
+    }
+
+    void ColumnWriter::append_encoded(const std::string &source, const EncodedCapture &capture)
+    {
+        write_chunk();
+
+        sources.push_back({source, sampleCount, capture.samples, capture.minBlock, capture.maxBlock});
+        const uint64_t base = static_cast<uint64_t>(out.tellp());
+        out.write(capture.bytes.data(), static_cast<std::streamsize>(capture.bytes.size()));
+        for (ChunkEntry entry : capture.chunks)
+        {
+            entry.offset += base;
+            index.push_back(entry);
+        }
+        sampleCount += capture.samples;
+    }
+
+    bool ColumnWriter::close()
+    {
+        if (!out.is_open())
+            return false;
+
+        write_chunk();
+
+        FileHeader header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = sources.empty() ? formatVersion : archiveVersion;
+        header.sourceCount = static_cast<uint32_t>(sources.size());
+        header.columns = columnCount;
+        header.chunkSamples = chunkSamples;
+        header.sampleCount = sampleCount;
+        header.chunkCount = index.size();
+        header.indexOffset = static_cast<uint64_t>(out.tellp());
+
+        for (const ChunkEntry &entry : index)
+        {
+            char raw[indexEntrySize];
+            std::memcpy(raw, &entry.minBlock, 4);
+            std::memcpy(raw + 4, &entry.maxBlock, 4);
+            std::memcpy(raw + 8, &entry.samples, 4);
+            std::memcpy(raw + 12, &entry.bytes, 4);
+            std::memcpy(raw + 16, &entry.offset, 8);
+            std::memcpy(raw + 24, entry.columnBytes, sizeof(entry.columnBytes));
+            out.write(raw, sizeof(raw));
+        }
+
+        // u16 name length, name, u64 first sample, u64 samples, u32 min and max block
+        std::string table;
+        for (const Source &source : sources)
+        {
+            put_raw(table, static_cast<uint16_t>(std::min<size_t>(source.name.size(), UINT16_MAX)));
+            table.append(source.name, 0, std::min<size_t>(source.name.size(), UINT16_MAX));
+            put_raw(table, source.firstSample);
+            put_raw(table, source.samples);
+            put_raw(table, source.minBlock);
+            put_raw(table, source.maxBlock);
+        }
+        out.write(table.data(), static_cast<std::streamsize>(table.size()));
+
+        out.seekp(0);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.close();
+        return !out.fail();
+    }
+
+    // -------------------- ColumnReader --------------------
+    bool ColumnReader::open(const std::string &path)
+    {
+        indexBase = nullptr;
+        sampleCount = chunkCount = 0;
+        sourceList.clear();
+        chunkFirstSample.clear();
+        if (!file.open(path))
+            return false;
+
+        FileHeader header;
+        if (file.size() < sizeof(header))
+            return false;
+        std::memcpy(&header, file.data(), sizeof(header));
+
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || (header.version != formatVersion && header.version != archiveVersion) ||
+            header.columns != columnCount || header.indexOffset > file.size() ||
+            header.chunkCount > (file.size() - header.indexOffset) / indexEntrySize)
+        {
+            std::cerr << path << " is not a valid motion capture file" << std::endl;
+            return false;
+        }
+
+        indexBase = file.data() + header.indexOffset;
+        chunkCount = static_cast<size_t>(header.chunkCount);
+        sampleCount = header.sampleCount;
+
+        sortedBlocks = true;
+        chunkFirstSample.reserve(chunkCount);
+        uint64_t first = 0;
+        for (size_t i = 0; i < chunkCount; ++i)
+        {
+            // Every sample takes at least a byte in every column, so a chunk cannot claim more
+            // samples than its bytes hold and the counts below stay within the file's size
+            ChunkInfo info = load_entry(indexBase, i);
+            if (info.offset > header.indexOffset || info.bytes > header.indexOffset - info.offset ||
+                info.samples > info.bytes / columnCount)
+                return false;
+            if (i > 0 && info.minBlock < load_entry(indexBase, i - 1).maxBlock)
+                sortedBlocks = false;
+            chunkFirstSample.push_back(first);
+            first += info.samples;
+        }
+        // read_all() reserves this many samples
+        if (sampleCount != first)
+        {
+            std::cerr << path << " is not a valid motion capture file" << std::endl;
+            return false;
+        }
+
+        const uint8_t *p = indexBase + chunkCount * indexEntrySize;
+        const uint8_t *end = file.data() + file.size();
+        for (uint32_t i = 0; header.version == archiveVersion && i < header.sourceCount; ++i)
+        {
+            ColumnWriter::Source source;
+            uint16_t nameLength;
+            if (end - p < 2)
+                return false;
+            std::memcpy(&nameLength, p, 2);
+            if (static_cast<size_t>(end - p) < 2u + nameLength + 24u)
+                return false;
+            source.name.assign(reinterpret_cast<const char *>(p + 2), nameLength);
+            p += 2 + nameLength;
+            std::memcpy(&source.firstSample, p, 8);
+            std::memcpy(&source.samples, p + 8, 8);
+            std::memcpy(&source.minBlock, p + 16, 4);
+            std::memcpy(&source.maxBlock, p + 20, 4);
+            p += 24;
+            if (source.samples > sampleCount || source.firstSample > sampleCount - source.samples)
+                return false;
+            sourceList.push_back(std::move(source));
+        }
+        return true;
+    }
+
+    bool ColumnReader::decode_chunk(size_t chunk, uint32_t firstBlock, uint32_t lastBlock, Capture &out) const
+    {
+        ChunkInfo info = load_entry(indexBase, chunk);
+        const uint8_t *p = file.data() + info.offset;
+        const uint8_t *end = p + info.bytes;
+
+        // Whole chunk inside the range: decode straight into the output columns
+        Capture scratch;
+        const bool whole = info.minBlock >= firstBlock && info.maxBlock <= lastBlock;
+        Capture &target = whole ? out : scratch;
+
+        p = decode_column(p, end, info.samples, target.block);
+        p = decode_column(p, end, info.samples, target.before_x);
+        p = decode_column(p, end, info.samples, target.before_y);
+        p = decode_column(p, end, info.samples, target.after_x);
+        p = decode_column(p, end, info.samples, target.after_y);
+        p = decode_column(p, end, info.samples, target.x_cond);
+        p = decode_column(p, end, info.samples, target.y_cond);
+        if (!p)
+            return false;
+
+        if (whole)
+            return true;
+
+        for (size_t i = 0; i < scratch.size(); ++i)
+        {
+            if (scratch.block[i] < firstBlock || scratch.block[i] > lastBlock)
+                continue;
+            out.block.push_back(scratch.block[i]);
+            out.before_x.push_back(scratch.before_x[i]);
+            out.before_y.push_back(scratch.before_y[i]);
+            out.after_x.push_back(scratch.after_x[i]);
+            out.after_y.push_back(scratch.after_y[i]);
+            out.x_cond.push_back(scratch.x_cond[i]);
+            out.y_cond.push_back(scratch.y_cond[i]);
+        }
+        return true;
+    }
+
+    bool ColumnReader::read_all(Capture &out) const
+    {
+        out.reserve(out.size() + static_cast<size_t>(sampleCount));
+        for (size_t i = 0; i < chunkCount; ++i)
+        {
+            if (!decode_chunk(i, 0, UINT32_MAX, out))
+                return false;
+        }
+        return true;
+    }
+
+    bool ColumnReader::read_range(uint32_t firstBlock, uint32_t lastBlock, Capture &out) const
+    {
+        size_t i = 0;
+        if (sortedBlocks)
+        {
+            // First chunk that can contain firstBlock
+            size_t lo = 0, hi = chunkCount;
+            while (lo < hi)
+            {
+                size_t mid = (lo + hi) / 2;
+                if (load_entry(indexBase, mid).maxBlock < firstBlock)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            i = lo;
+        }
+
+        for (; i < chunkCount; ++i)
+        {
+            ChunkInfo info = load_entry(indexBase, i);
+            if (info.minBlock > lastBlock)
+            {
+                if (sortedBlocks)
+                    break;
+                continue;
+            }
+            if (info.maxBlock < firstBlock)
+                continue;
+            if (!decode_chunk(i, firstBlock, lastBlock, out))
+                return false;
+        }
+        return true;
+    }
+
+    bool ColumnReader::read_source(size_t source, Capture &out) const
+    {
+        if (source >= sourceList.size())
+            return false;
+        const uint64_t first = sourceList[source].firstSample;
+        const uint64_t last = first + sourceList[source].samples;
+        out.reserve(out.size() + static_cast<size_t>(sourceList[source].samples));
+        // Every source starts a chunk and no chunk spans two
+        size_t i = static_cast<size_t>(std::lower_bound(chunkFirstSample.begin(), chunkFirstSample.end(), first) -
+                                       chunkFirstSample.begin());
+        for (; i < chunkCount && chunkFirstSample[i] < last; ++i)
+        {
+            if (!decode_chunk(i, 0, UINT32_MAX, out))
+                return false;
+        }
+        return true;
+    }
+
+    EncodedCapture encode_capture(const Capture &capture, uint32_t chunkSamples)
+    {
+        EncodedCapture encoded;
+        chunkSamples = std::max<uint32_t>(chunkSamples, 1);
+        encoded.samples = capture.size();
+        for (size_t first = 0; first < capture.size(); first += chunkSamples)
+        {
+            const size_t count = std::min<size_t>(chunkSamples, capture.size() - first);
+            encoded.chunks.push_back(encode_chunk(capture, first, count, encoded.bytes));
+        }
+        if (!encoded.chunks.empty())
+        {
+            encoded.minBlock = encoded.chunks.front().minBlock;
+            encoded.maxBlock = encoded.chunks.front().maxBlock;
+            for (const ChunkEntry &chunk : encoded.chunks)
+            {
+                encoded.minBlock = std::min(encoded.minBlock, chunk.minBlock);
+                encoded.maxBlock = std::max(encoded.maxBlock, chunk.maxBlock);
+            }
+        }
+        return encoded;
+    }
+
+    bool is_columnar_file(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        char head[4] = {};
+        in.read(head, sizeof(head));
+        return in && std::memcmp(head, magic, sizeof(magic)) == 0;
+    }
+
+    bool read_capture(const std::string &path, Capture &capture)
+    {
+        if (!is_columnar_file(path))
+        {
+            Decoder decoder(capture);
+            return decode_file(path, decoder);
+        }
+        ColumnReader reader;
+        if (!reader.open(path) || !reader.read_all(capture))
+        {
+            std::cerr << "Cannot read " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    int64_t convert_text_capture(const std::string &textPath, const std::string &columnarPath)
+    {
+        Capture capture;
+        Decoder decoder(capture);
+        if (!decode_file(textPath, decoder))
+            return -1;
+
+        ColumnWriter writer;
+        if (!writer.open(columnarPath))
+        {
+            std::cerr << "Cannot write " << columnarPath << std::endl;
+            return -1;
+        }
+        writer.append(capture);
+        if (!writer.close())
+            return -1;
+        return static_cast<int64_t>(writer.samples());
+    }
+}
@@ -0,0 +1,173 @@
+#include <array>
+#include <charconv>
+#include <cstring>
+
+#include "include/response_parser.hpp"
+
+namespace ComPort
+{
+    namespace
+    {
+        struct CounterKey
+        {
+            std::string_view key;
+            Field field;
+            uint64_t MouseStatus::*member;
+        };
+
+        constexpr std::array<CounterKey, 7> counterKeys = {{
+            {"Left clicks", FIELD_LEFT_CLICKS, &MouseStatus::left_clicks},
+            {"Right clicks", FIELD_RIGHT_CLICKS, &MouseStatus::right_clicks},
+            {"Middle clicks", FIELD_MIDDLE_CLICKS, &MouseStatus::middle_clicks},
+            {"Backward clicks", FIELD_BACKWARD_CLICKS, &MouseStatus::backward_clicks},
+            {"Forward clicks", FIELD_FORWARD_CLICKS, &MouseStatus::forward_clicks},
+            {"Downward scrolls", FIELD_DOWNWARD_SCROLLS, &MouseStatus::downward_scrolls},
+            {"Upward scrolls", FIELD_UPWARD_SCROLLS, &MouseStatus::upward_scrolls},
+        }};
+
+        constexpr std::array<std::pair<Field, std::string_view>, 10> fieldNames = {{
+            {FIELD_LEFT_CLICKS, "Left clicks"},
+            {FIELD_RIGHT_CLICKS, "Right clicks"},
+            {FIELD_MIDDLE_CLICKS, "Middle clicks"},
+            {FIELD_BACKWARD_CLICKS, "Backward clicks"},
+            {FIELD_FORWARD_CLICKS, "Forward clicks"},
+            {FIELD_DOWNWARD_SCROLLS, "Downward scrolls"},
+            {FIELD_UPWARD_SCROLLS, "Upward scrolls"},
+            {FIELD_BATTERY, "Battery level"},
+            {FIELD_CURRENT_DPI, "Current DPI"},
+            {FIELD_FIRMWARE_BUILD_DATE, "Firmware build date"},
+        }};
+
+        bool is_blank(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\0';
+        }
+
+        std::string_view trim(std::string_view s)
+        {
+            while (!s.empty() && is_blank(s.front()))
+                s.remove_prefix(1);
+            while (!s.empty() && is_blank(s.back()))
+                s.remove_suffix(1);
+            return s;
+        }
+
+        // Parses a number at the start of s (after blanks) and advances s past it
+        template <typename T>
+        bool take_number(std::string_view &s, T &out)
+        {
+            while (!s.empty() && is_blank(s.front()))
+                s.remove_prefix(1);
+            auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+            if (ec != std::errc())
+                return false;
+            s.remove_prefix(static_cast<size_t>(ptr - s.data()));
+            return true;
+        }
+
+        // "3712mV = 64%"
+        bool parse_battery(std::string_view value, MouseStatus &status)
+        {
+            int mv = 0, percent = 0;
+            if (!take_number(value, mv) || !value.starts_with("mV"))
+                return false;
+            value.remove_prefix(2);
+            value = trim(value);
+            if (value.empty() || value.front() != '=')
+                return false;
+            value.remove_prefix(1);
+            if (!take_number(value, percent))
+                return false;
+
+            status.battery_mv = mv;
+            status.battery_percent = percent;
+            return true;
+        }
+    }
+
+    uint32_t parse_line(std::string_view line, MouseStatus &status)
+    {
+        line = trim(line);
+
+        // "Current DPI [400, 800, 1600]: 800", the bracket list may itself contain colons
+        if (line.starts_with("Current DPI"))
+        {
+            size_t close = line.rfind("]:");
+            if (close == std::string_view::npos)
+                return FIELD_NONE;
+            std::string_view value = line.substr(close + 2);
+            return take_number(value, status.current_dpi) ? FIELD_CURRENT_DPI : FIELD_NONE;
+        }
+
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+            return FIELD_NONE;
+
+        std::string_view key = trim(line.substr(0, colon));
+        std::string_view value = line.substr(colon + 1);
+
+        for (const CounterKey &counter : counterKeys)
+        {
+            if (key == counter.key)
+                return take_number(value, status.*counter.member) ? counter.field : FIELD_NONE;
+        }
+
+        if (key == "Battery level")
+            return parse_battery(value, status) ? FIELD_BATTERY : FIELD_NONE;
+
+        if (key == "Firmware build date")
+        {
+            value = trim(value);
+            if (status.firmware_build_date != value) // only allocates when it changes
+                status.firmware_build_date.assign(value);
+            return FIELD_FIRMWARE_BUILD_DATE;
+        }
+
+        return FIELD_NONE;
+    }
+
+    uint32_t parse_response(std::string_view response, MouseStatus &status)
+    {
+        uint32_t found = FIELD_NONE;
+        const char *p = response.data();
+        const char *end = p + response.size();
+
+        while (p < end)
+        {
+            const char *eol = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!eol)
+                eol = end;
+            found |= parse_line(std::string_view(p, static_cast<size_t>(eol - p)), status);
+            p = eol + 1;
+        }
+
+        return found;
+    }
+
+    uint32_t expected_fields(Subject subject)
+    {
+        switch (subject)
+        {
+        case Subject::MOUSE:
+            return MOUSE_FIELDS;
+        case Subject::RECEIVER:
+            return RECEIVER_FIELDS;
+        default:
+            return FIELD_NONE;
+        }
+    }
+
+    std::string describe_fields(uint32_t mask)
+    {
+        std::string out;
+        for (const auto &[field, name] : fieldNames)
+        {
+            if (!(mask & field))
+                continue;
+            if (!out.empty())
+                out += ", ";
+            out += name;
+        }
+        return out;
+    }
+}
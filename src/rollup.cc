@@ -0,0 +1,408 @@
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include "include/rollup.hpp"
+
+namespace Stats
+{
+    namespace
+    {
+        constexpr char magic[4] = {'M', 'R', 'U', 'P'};
+        constexpr uint16_t formatVersion = 1;
+        constexpr const char *suffixes[RESOLUTION_COUNT] = {".min", ".hour", ".day"};
+
+        struct FileHeader
+        {
+            char magic[4];
+            uint16_t version;
+            uint8_t resolution;
+            uint8_t counters;
+            int64_t lastTime; // last history record folded in
+            uint64_t last[counterCount];
+            int64_t openStart; // bucket still collecting
+            uint64_t open[counterCount];
+            uint8_t hasLast;
+            uint8_t hasOpen;
+            uint16_t reserved;
+            uint32_t checksum;
+        };
+        static_assert(sizeof(FileHeader) == 144);
+
+        // A closed bucket. Even a day of clicks fits 32 bits many times over.
+        struct BucketEntry
+        {
+            int64_t start;
+            uint32_t counts[counterCount];
+            uint32_t reserved;
+        };
+        static_assert(sizeof(BucketEntry) == 40);
+
+        // FNV-1a over everything before the checksum field
+        uint32_t header_checksum(const FileHeader &header)
+        {
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(&header);
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < offsetof(FileHeader, checksum); ++i)
+                hash = (hash ^ p[i]) * 16777619u;
+            return hash;
+        }
+
+        std::tm local_time(int64_t time)
+        {
+            std::time_t t = static_cast<std::time_t>(time);
+            std::tm local{};
+#ifdef _WIN32
+            localtime_s(&local, &t);
+#else
+            localtime_r(&t, &local);
+#endif
+            return local;
+        }
+
+        int64_t unix_now()
+        {
+            using namespace std::chrono;
+            return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+        }
+
+        Bucket to_bucket(const BucketEntry &entry)
+        {
+            Bucket bucket;
+            bucket.start = entry.start;
+            for (size_t i = 0; i < counterCount; ++i)
+                bucket.counts[i] = entry.counts[i];
+            return bucket;
+        }
+
+        bool any(const Counts &counts)
+        {
+            for (uint64_t count : counts)
+                if (count)
+                    return true;
+            return false;
+        }
+    }
+
+    Counts increase(const Counts &before, const Counts &after)
+    {
+        Counts result;
+        for (size_t i = 0; i < counterCount; ++i)
+            result[i] = after[i] >= before[i] ? after[i] - before[i] : after[i];
+        return result;
+    }
+
+    int64_t bucket_start(Resolution resolution, int64_t time)
+    {
+        switch (resolution)
+        {
+        case RESOLUTION_MINUTE:
+            return time - ((time % 60) + 60) % 60;
+        case RESOLUTION_HOUR:
+        {
+            // Local, for the zones that are not a whole number of hours off UTC
+            std::tm local = local_time(time);
+            return time - local.tm_min * 60 - local.tm_sec;
+        }
+        default:
+        {
+            std::tm local = local_time(time);
+            local.tm_hour = local.tm_min = local.tm_sec = 0;
+            local.tm_isdst = -1;
+            return static_cast<int64_t>(std::mktime(&local));
+        }
+        }
+    }
+
+    int64_t bucket_end(Resolution resolution, int64_t start)
+    {
+        switch (resolution)
+        {
+        case RESOLUTION_MINUTE:
+            return start + 60;
+        case RESOLUTION_HOUR:
+            return start + 3600;
+        default:
+        {
+            // 23 or 25 hours on the days daylight saving time starts or ends
+            std::tm local = local_time(start);
+            local.tm_mday += 1;
+            local.tm_hour = local.tm_min = local.tm_sec = 0;
+            local.tm_isdst = -1;
+            return static_cast<int64_t>(std::mktime(&local));
+        }
+        }
+    }
+
+    // -------------------- RollupFile --------------------
+    bool RollupFile::open(const std::string &path, Resolution resolution)
+    {
+        close();
+        this->path = path;
+        this->resolution = resolution;
+        closedBuckets = 0;
+        hasLast = hasOpen = false;
+        last = Record{};
+        openBucket = Bucket{};
+
+        std::error_code ec;
+        uint64_t fileSize = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+
+        FileHeader header{};
+        bool valid = false;
+        if (fileSize >= sizeof(FileHeader))
+        {
+            std::ifstream in(path, std::ios::binary);
+            in.read(reinterpret_cast<char *>(&header), sizeof(header));
+            valid = in && std::memcmp(header.magic, magic, sizeof(magic)) == 0 && header.version == formatVersion &&
+                    header.resolution == resolution && header.counters == counterCount &&
+                    header.checksum == header_checksum(header);
+            if (!valid)
+                std::cerr << path << " is damaged, rebuilding it from the history" << std::endl;
+        }
+
+        if (valid)
+        {
+            hasLast = header.hasLast != 0;
+            last.time = header.lastTime;
+            std::memcpy(last.counters.data(), header.last, sizeof(header.last));
+            hasOpen = header.hasOpen != 0;
+            openBucket.start = header.openStart;
+            std::memcpy(openBucket.counts.data(), header.open, sizeof(header.open));
+            if (hasOpen)
+                openEnd = bucket_end(resolution, openBucket.start);
+
+            // A crash between appending a closed bucket and rewriting the header leaves that
+            // bucket in both places, and a torn append leaves part of one
+            closedBuckets = (fileSize - sizeof(FileHeader)) / sizeof(BucketEntry);
+            std::ifstream in(path, std::ios::binary);
+            while (closedBuckets > 0 && hasOpen)
+            {
+                BucketEntry entry{};
+                in.seekg(static_cast<std::streamoff>(sizeof(FileHeader) + (closedBuckets - 1) * sizeof(BucketEntry)));
+                in.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+                if (in && entry.start < openBucket.start)
+                    break;
+                --closedBuckets;
+            }
+            const uint64_t used = sizeof(FileHeader) + closedBuckets * sizeof(BucketEntry);
+            if (used != fileSize)
+                std::filesystem::resize_file(path, used, ec);
+        }
+        else
+        {
+            std::ofstream create(path, std::ios::binary | std::ios::trunc);
+            if (!create)
+            {
+                std::cerr << "Cannot create " << path << std::endl;
+                return false;
+            }
+        }
+
+        file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!file || (!valid && !write_header()))
+        {
+            std::cerr << "Cannot open " << path << " for writing" << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void RollupFile::close()
+    {
+        if (file.is_open())
+            file.close();
+    }
+
+    bool RollupFile::write_header()
+    {
+        FileHeader header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = formatVersion;
+        header.resolution = static_cast<uint8_t>(resolution);
+        header.counters = counterCount;
+        header.lastTime = last.time;
+        std::memcpy(header.last, last.counters.data(), sizeof(header.last));
+        header.openStart = openBucket.start;
+        std::memcpy(header.open, openBucket.counts.data(), sizeof(header.open));
+        header.hasLast = hasLast;
+        header.hasOpen = hasOpen;
+        header.checksum = header_checksum(header);
+
+        file.seekp(0);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.flush();
+        return static_cast<bool>(file);
+    }
+
+    bool RollupFile::add(const Record &record, bool commit)
+    {
+        if (!file.is_open())
+            return false;
+        if (!hasLast)
+        {
+            last = record;
+            hasLast = true;
+            return !commit || write_header();
+        }
+
+        const Counts counts = increase(last.counters, record.counters);
+        last = record;
+        if (!any(counts))
+            return true; // only the time moved, not worth a write
+
+        // A record from before the open bucket (the clock went back) is counted in it
+        if (hasOpen && record.time >= openEnd)
+        {
+            BucketEntry entry{};
+            entry.start = openBucket.start;
+            for (size_t i = 0; i < counterCount; ++i)
+                entry.counts[i] = static_cast<uint32_t>(std::min<uint64_t>(openBucket.counts[i], UINT32_MAX));
+            file.seekp(static_cast<std::streamoff>(sizeof(FileHeader) + closedBuckets * sizeof(BucketEntry)));
+            file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            if (!file)
+                return false;
+            ++closedBuckets;
+            hasOpen = false;
+        }
+        if (!hasOpen)
+        {
+            openBucket = Bucket{};
+            openBucket.start = bucket_start(resolution, record.time);
+            openEnd = bucket_end(resolution, openBucket.start);
+            hasOpen = true;
+        }
+        for (size_t i = 0; i < counterCount; ++i)
+            openBucket.counts[i] += counts[i];
+        return !commit || write_header();
+    }
+
+    bool RollupFile::scan(int64_t from, int64_t to, const std::function<void(const Bucket &)> &onBucket) const
+    {
+        const int64_t first = from > 0 ? bucket_start(resolution, from) : INT64_MIN;
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+
+        auto load = [&](uint64_t i)
+        {
+            BucketEntry entry{};
+            in.seekg(static_cast<std::streamoff>(sizeof(FileHeader) + i * sizeof(BucketEntry)));
+            in.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+            return entry;
+        };
+
+        // First closed bucket at or after the one from falls in
+        uint64_t lo = 0, hi = closedBuckets;
+        while (lo < hi)
+        {
+            uint64_t mid = (lo + hi) / 2;
+            if (load(mid).start < first)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        std::vector<BucketEntry> chunk(1024);
+        in.seekg(static_cast<std::streamoff>(sizeof(FileHeader) + lo * sizeof(BucketEntry)));
+        for (uint64_t at = lo; at < closedBuckets;)
+        {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(chunk.size(), closedBuckets - at));
+            in.read(reinterpret_cast<char *>(chunk.data()), static_cast<std::streamsize>(n * sizeof(BucketEntry)));
+            if (!in)
+                return false;
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (chunk[i].start > to)
+                    return true;
+                onBucket(to_bucket(chunk[i]));
+            }
+            at += n;
+        }
+
+        if (hasOpen && openBucket.start >= first && openBucket.start <= to)
+            onBucket(openBucket);
+        return true;
+    }
+
+    // -------------------- Rollups --------------------
+    bool Rollups::open(const std::string &storePath, const Store &store)
+    {
+        close();
+        for (int r = 0; r < RESOLUTION_COUNT; ++r)
+        {
+            if (!files[r].open(storePath + suffixes[r], static_cast<Resolution>(r)))
+            {
+                close();
+                return false;
+            }
+        }
+
+        // Whatever the history got while the rollups were not running, all of it for new files
+        caughtUp = 0;
+        int64_t from = INT64_MAX;
+        for (const RollupFile &file : files)
+            from = std::min(from, file.fed().time);
+        if (!store.empty() && from < store.latest().time)
+        {
+            bool ok = store.scan(from, INT64_MAX, [&](const Record &record)
+                                 {
+                                     ++caughtUp;
+                                     for (RollupFile &file : files)
+                                         if (record.time > file.fed().time)
+                                             file.add(record, false); });
+            for (RollupFile &file : files)
+                file.commit();
+            if (!ok)
+                std::cerr << "Could not read all of " << storePath << " for the rollups" << std::endl;
+        }
+
+        hasPrevious = !store.empty();
+        if (hasPrevious)
+            previous = store.latest();
+
+        // The windows restart from the minute rollups, good to a minute
+        minute = {};
+        hour = {};
+        const int64_t now = unix_now();
+        files[RESOLUTION_MINUTE].scan(now - 3600, now, [&](const Bucket &bucket)
+                                      {
+                                          minute.add(bucket.start, bucket.counts);
+                                          hour.add(bucket.start, bucket.counts); });
+        return true;
+    }
+
+    void Rollups::close()
+    {
+        for (RollupFile &file : files)
+            file.close();
+    }
+
+    bool Rollups::add(const Record &record)
+    {
+        bool ok = true;
+        for (RollupFile &file : files)
+            ok &= file.add(record);
+
+        if (hasPrevious)
+        {
+            const Counts counts = increase(previous.counters, record.counters);
+            minute.add(record.time, counts);
+            hour.add(record.time, counts);
+        }
+        previous = record;
+        hasPrevious = true;
+        return ok;
+    }
+
+    bool Rollups::scan(Resolution resolution, int64_t from, int64_t to,
+                       const std::function<void(const Bucket &)> &onBucket) const
+    {
+        return files[resolution].scan(from, to, onBucket);
+    }
+}
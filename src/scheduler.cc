@@ -0,0 +1,60 @@
+#include <bit>
+
+#include "include/scheduler.hpp"
+
+void Scheduler::post(uint32_t events)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint32_t fresh = events & ~pending;
+        if (!fresh)
+            return;
+
+        Clock::time_point now = Clock::now();
+        for (uint32_t bits = fresh; bits; bits &= bits - 1)
+            postedAt[std::countr_zero(bits)] = now;
+        pending |= fresh;
+    }
+    cv.notify_all();
+}
+
+uint32_t Scheduler::wait(uint32_t mask)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]
+            { return stopping || (pending & mask); });
+    uint32_t events = stopping ? 0 : pending & mask;
+    pending &= ~events;
+    return events;
+}
+
+uint32_t Scheduler::wait(uint32_t mask, Clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_until(lock, deadline, [&]
+                  { return stopping || (pending & mask); });
+    uint32_t events = stopping ? 0 : pending & mask;
+    pending &= ~events;
+    return events;
+}
+
+void Scheduler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+}
+
+bool Scheduler::stopped() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stopping;
+}
+
+Scheduler::Clock::time_point Scheduler::posted_at(Event event) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return postedAt[std::countr_zero(static_cast<uint32_t>(event))];
+}
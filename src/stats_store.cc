@@ -0,0 +1,570 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+#include "include/stats_store.hpp"
+#include "include/varint.hpp"
+
+static_assert(std::endian::native == std::endian::little, "the stats layout is little endian");
+
+namespace Stats
+{
+    const std::array<const char *, counterCount> counterNames = {
+        "Left clicks", "Right clicks", "Middle clicks",
+        "Backward clicks", "Forward clicks",
+        "Down scrolls", "Up scrolls"};
+
+    namespace
+    {
+        constexpr char magic[4] = {'M', 'S', 'T', 'S'};
+        constexpr uint16_t formatVersion = 1;
+        constexpr uint8_t keyframeBit = 0x80;
+
+        // Mask byte, time and seven counters at ten bytes per varint
+        constexpr size_t maxRecordSize = 1 + 10 + counterCount * 10;
+
+        struct FileHeader
+        {
+            char magic[4];
+            uint16_t version;
+            uint16_t counters;
+            uint32_t keyframeInterval;
+            uint32_t reserved;
+        };
+        static_assert(sizeof(FileHeader) == 16);
+
+        struct IndexEntry
+        {
+            int64_t time;
+            uint64_t offset;
+        };
+        static_assert(sizeof(IndexEntry) == 16);
+
+        constexpr char snapshotMagic[4] = {'M', 'S', 'N', 'P'};
+
+        struct SnapshotFile
+        {
+            char magic[4];
+            uint16_t version;
+            uint16_t counters;
+            int64_t time;
+            uint64_t values[counterCount];
+            int32_t currentDpi;
+            int32_t batteryPercent;
+            uint32_t checksum;
+            uint32_t reserved;
+        };
+        static_assert(sizeof(SnapshotFile) == 88);
+
+        // FNV-1a over everything before the checksum field
+        uint32_t snapshot_checksum(const SnapshotFile &file)
+        {
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(&file);
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < offsetof(SnapshotFile, checksum); ++i)
+                hash = (hash ^ p[i]) * 16777619u;
+            return hash;
+        }
+
+        std::string index_path(const std::string &path)
+        {
+            return path + ".idx";
+        }
+
+        // Decodes one record on top of record (the previous one), nullptr if it is cut short
+        const uint8_t *decode_record(const uint8_t *p, const uint8_t *end, Record &record, bool &keyframe)
+        {
+            if (p >= end)
+                return nullptr;
+            uint8_t mask = *p++;
+            keyframe = (mask & keyframeBit) != 0;
+
+            if (keyframe)
+            {
+                uint64_t time;
+                p = Varint::get(p, end, time);
+                record.time = static_cast<int64_t>(time);
+                for (size_t i = 0; i < counterCount && p; ++i)
+                    p = Varint::get(p, end, record.counters[i]);
+                return p;
+            }
+
+            int64_t delta;
+            p = Varint::get_signed(p, end, delta);
+            record.time += delta;
+            for (size_t i = 0; i < counterCount && p; ++i)
+            {
+                if (!(mask & (1u << i)))
+                    continue;
+                p = Varint::get_signed(p, end, delta);
+                record.counters[i] += static_cast<uint64_t>(delta);
+            }
+            return p;
+        }
+
+        // Streams the records of [offset, end) through a small buffer
+        class RecordReader
+        {
+        public:
+            RecordReader(const std::string &path, uint64_t offset, uint64_t end)
+                : in(path, std::ios::binary), base(offset), remaining(end > offset ? end - offset : 0)
+            {
+                in.seekg(static_cast<std::streamoff>(offset));
+            }
+
+            // Decodes the next record on top of record, false at the end or on a damaged record
+            bool next(Record &record, bool &keyframe)
+            {
+                if (buffer.size() - pos < maxRecordSize && remaining > 0)
+                    refill();
+
+                Record decoded = record;
+                const uint8_t *begin = reinterpret_cast<const uint8_t *>(buffer.data()) + pos;
+                const uint8_t *end = reinterpret_cast<const uint8_t *>(buffer.data()) + buffer.size();
+                const uint8_t *p = decode_record(begin, end, decoded, keyframe);
+                if (!p)
+                    return false;
+
+                pos += static_cast<size_t>(p - begin);
+                record = decoded;
+                return true;
+            }
+
+            // File offset of the next undecoded byte
+            uint64_t offset() const { return base + pos; }
+
+        private:
+            void refill()
+            {
+                base += pos;
+                buffer.erase(0, pos);
+                pos = 0;
+
+                size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, 64 * 1024));
+                size_t old = buffer.size();
+                buffer.resize(old + chunk);
+                in.read(buffer.data() + old, static_cast<std::streamsize>(chunk));
+                size_t got = static_cast<size_t>(in.gcount());
+                buffer.resize(old + got);
+                remaining = got == chunk ? remaining - chunk : 0;
+            }
+
+            std::ifstream in;
+            std::string buffer;
+            size_t pos = 0;
+            uint64_t base;
+            uint64_t remaining;
+        };
+    }
+
+    Record from_status(const ComPort::MouseStatus &status, int64_t time)
+    {
+        Record record;
+        record.time = time;
+        record.counters = {status.left_clicks, status.right_clicks, status.middle_clicks,
+                           status.backward_clicks, status.forward_clicks,
+                           status.downward_scrolls, status.upward_scrolls};
+        return record;
+    }
+
+    std::string format_time(int64_t time)
+    {
+        std::time_t t = static_cast<std::time_t>(time);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &t);
+#else
+        localtime_r(&t, &local);
+#endif
+        char text[32];
+        size_t n = std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+        return std::string(text, n);
+    }
+
+    bool parse_time(std::string_view text, int64_t &time)
+    {
+        // yyyy-MM-dd hh:mm:ss
+        if (text.size() < 19 || text[4] != '-' || text[7] != '-' || text[10] != ' ' || text[13] != ':' ||
+            text[16] != ':')
+            return false;
+
+        auto field = [&](size_t at, size_t len, int &value)
+        {
+            auto [ptr, ec] = std::from_chars(text.data() + at, text.data() + at + len, value);
+            return ec == std::errc() && ptr == text.data() + at + len;
+        };
+
+        std::tm local{};
+        if (!field(0, 4, local.tm_year) || !field(5, 2, local.tm_mon) || !field(8, 2, local.tm_mday) ||
+            !field(11, 2, local.tm_hour) || !field(14, 2, local.tm_min) || !field(17, 2, local.tm_sec))
+            return false;
+        local.tm_year -= 1900;
+        local.tm_mon -= 1;
+        local.tm_isdst = -1;
+
+        std::time_t t = std::mktime(&local);
+        if (t == static_cast<std::time_t>(-1))
+            return false;
+        time = static_cast<int64_t>(t);
+        return true;
+    }
+
+    // -------------------- Store --------------------
+    bool Store::open(const std::string &path, uint32_t keyframeInterval)
+    {
+        close();
+        this->path = path;
+        this->keyframeInterval = std::max<uint32_t>(keyframeInterval, 1);
+        hasLatest = false;
+        sinceKeyframe = 0;
+        last = Record{};
+
+        std::error_code ec;
+        uint64_t fileSize = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+
+        if (fileSize < sizeof(FileHeader))
+        {
+            FileHeader header{};
+            std::memcpy(header.magic, magic, sizeof(magic));
+            header.version = formatVersion;
+            header.counters = counterCount;
+            header.keyframeInterval = this->keyframeInterval;
+
+            std::ofstream create(path, std::ios::binary | std::ios::trunc);
+            create.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            if (!create)
+            {
+                std::cerr << "Cannot create " << path << std::endl;
+                return false;
+            }
+            std::filesystem::remove(index_path(path), ec);
+            endOffset = sizeof(header);
+        }
+        else
+        {
+            FileHeader header;
+            std::ifstream in(path, std::ios::binary);
+            in.read(reinterpret_cast<char *>(&header), sizeof(header));
+            if (!in || std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != formatVersion ||
+                header.counters != counterCount)
+            {
+                std::cerr << path << " is not a valid stats file" << std::endl;
+                return false;
+            }
+
+            // Replay from the last indexed keyframe. A crash can tear the keyframe an entry
+            // points to, that entry is dropped and the one before it tried. Without a usable
+            // index, replay everything and rebuild it on the way.
+            std::ifstream index(index_path(path), std::ios::binary | std::ios::ate);
+            const uint64_t indexSize = index ? static_cast<uint64_t>(index.tellg()) : 0;
+            uint64_t entries = indexSize / sizeof(IndexEntry);
+            bool recovered = false;
+            while (entries > 0 && !recovered)
+            {
+                IndexEntry entry;
+                index.seekg(static_cast<std::streamoff>((entries - 1) * sizeof(entry)));
+                index.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+                if (!index || entry.offset < sizeof(header))
+                    break;
+                recovered = entry.offset < fileSize && recover(entry.offset);
+                if (!recovered)
+                    --entries;
+            }
+            index.close();
+
+            if (recovered && entries * sizeof(IndexEntry) != indexSize)
+                std::filesystem::resize_file(index_path(path), entries * sizeof(IndexEntry), ec);
+            if (!recovered)
+            {
+                std::filesystem::remove(index_path(path), ec);
+                hasLatest = false;
+                sinceKeyframe = 0;
+                last = Record{};
+                recover(sizeof(header));
+            }
+        }
+
+        out.open(path, std::ios::binary | std::ios::app);
+        if (!out)
+        {
+            std::cerr << "Cannot open " << path << " for writing" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool Store::recover(uint64_t offset)
+    {
+        const bool rebuildIndex = offset == sizeof(FileHeader);
+        std::error_code ec;
+        uint64_t fileSize = std::filesystem::file_size(path, ec);
+
+        RecordReader reader(path, offset, fileSize);
+        Record record;
+        bool keyframe;
+        uint64_t at = reader.offset();
+        while (reader.next(record, keyframe))
+        {
+            if (!hasLatest && !keyframe)
+                return false;
+            if (keyframe)
+            {
+                sinceKeyframe = 0;
+                if (rebuildIndex)
+                    append_index(record.time, at);
+            }
+            else
+            {
+                ++sinceKeyframe;
+            }
+            last = record;
+            hasLatest = true;
+            at = reader.offset();
+        }
+
+        // Nothing intact from an indexed keyframe, the caller tries an earlier one
+        if (!hasLatest && !rebuildIndex)
+            return false;
+
+        endOffset = at;
+        if (endOffset < fileSize)
+        {
+            // Most likely a record cut short by a crash or power loss
+            std::cerr << "Dropping " << fileSize - endOffset << " damaged bytes at the end of " << path << std::endl;
+            std::filesystem::resize_file(path, endOffset, ec);
+        }
+        return true;
+    }
+
+    void Store::close()
+    {
+        if (out.is_open())
+            out.close();
+    }
+
+    bool Store::append_index(int64_t time, uint64_t offset)
+    {
+        IndexEntry entry{time, offset};
+        std::ofstream index(index_path(path), std::ios::binary | std::ios::app);
+        index.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        return static_cast<bool>(index);
+    }
+
+    bool Store::append(const Record &record)
+    {
+        if (!out.is_open())
+            return false;
+        if (hasLatest && record.counters == last.counters)
+            return true;
+
+        const bool keyframe = !hasLatest || sinceKeyframe + 1 >= keyframeInterval;
+        encoded.clear();
+        if (keyframe)
+        {
+            encoded.push_back(static_cast<char>(keyframeBit));
+            Varint::put(encoded, static_cast<uint64_t>(record.time));
+            for (uint64_t value : record.counters)
+                Varint::put(encoded, value);
+        }
+        else
+        {
+            uint8_t mask = 0;
+            for (size_t i = 0; i < counterCount; ++i)
+                if (record.counters[i] != last.counters[i])
+                    mask |= static_cast<uint8_t>(1u << i);
+
+            encoded.push_back(static_cast<char>(mask));
+            Varint::put_signed(encoded, record.time - last.time);
+            // Counters can also go down, e.g. after a firmware update resets them
+            for (size_t i = 0; i < counterCount; ++i)
+                if (mask & (1u << i))
+                    Varint::put_signed(encoded, static_cast<int64_t>(record.counters[i] - last.counters[i]));
+        }
+
+        out.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+        out.flush();
+        if (!out)
+            return false;
+
+        if (keyframe)
+        {
+            append_index(record.time, endOffset);
+            sinceKeyframe = 0;
+        }
+        else
+        {
+            ++sinceKeyframe;
+        }
+        endOffset += encoded.size();
+        last = record;
+        hasLatest = true;
+        return true;
+    }
+
+    bool Store::scan(int64_t from, int64_t to, const std::function<void(const Record &)> &onRecord) const
+    {
+        if (!hasLatest)
+            return true;
+
+        // Last keyframe at or before from. Assumes the clock never went backwards across keyframes,
+        // which at worst makes the scan start later than it should.
+        uint64_t start = sizeof(FileHeader);
+        std::ifstream index(index_path(path), std::ios::binary | std::ios::ate);
+        if (index)
+        {
+            uint64_t entries = static_cast<uint64_t>(index.tellg()) / sizeof(IndexEntry);
+            auto load = [&](uint64_t i)
+            {
+                IndexEntry entry{};
+                index.seekg(static_cast<std::streamoff>(i * sizeof(entry)));
+                index.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+                return entry;
+            };
+
+            uint64_t lo = 0, hi = entries;
+            while (lo < hi)
+            {
+                uint64_t mid = (lo + hi) / 2;
+                if (load(mid).time <= from)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if (lo > 0)
+            {
+                IndexEntry entry = load(lo - 1);
+                if (index && entry.offset < endOffset)
+                    start = entry.offset;
+            }
+        }
+
+        RecordReader reader(path, start, endOffset);
+        Record record;
+        bool keyframe;
+        bool first = true;
+        while (reader.next(record, keyframe))
+        {
+            if (first && !keyframe)
+                return false;
+            first = false;
+            if (record.time > to)
+                break;
+            if (record.time >= from)
+                onRecord(record);
+        }
+        return reader.offset() == endOffset || record.time > to;
+    }
+
+    // -------------------- Snapshot --------------------
+    Snapshot snapshot_from_status(const ComPort::MouseStatus &status, int64_t time)
+    {
+        Snapshot snapshot;
+        snapshot.time = time;
+        snapshot.counters = from_status(status, time).counters;
+        snapshot.currentDpi = status.current_dpi;
+        snapshot.batteryPercent = status.battery_percent;
+        return snapshot;
+    }
+
+    bool write_snapshot(const std::string &path, const Snapshot &snapshot)
+    {
+        SnapshotFile file{};
+        std::memcpy(file.magic, snapshotMagic, sizeof(snapshotMagic));
+        file.version = formatVersion;
+        file.counters = counterCount;
+        file.time = snapshot.time;
+        std::memcpy(file.values, snapshot.counters.data(), sizeof(file.values));
+        file.currentDpi = snapshot.currentDpi;
+        file.batteryPercent = snapshot.batteryPercent;
+        file.checksum = snapshot_checksum(file);
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&file), sizeof(file));
+        return static_cast<bool>(out);
+    }
+
+    bool read_snapshot(const std::string &path, Snapshot &snapshot)
+    {
+        SnapshotFile file;
+        std::ifstream in(path, std::ios::binary);
+        in.read(reinterpret_cast<char *>(&file), sizeof(file));
+        if (!in || std::memcmp(file.magic, snapshotMagic, sizeof(snapshotMagic)) != 0 ||
+            file.version != formatVersion || file.counters != counterCount || file.checksum != snapshot_checksum(file))
+            return false;
+
+        snapshot.time = file.time;
+        std::memcpy(snapshot.counters.data(), file.values, sizeof(file.values));
+        snapshot.currentDpi = file.currentDpi;
+        snapshot.batteryPercent = file.batteryPercent;
+        return true;
+    }
+
+    // -------------------- CSV --------------------
+    int64_t import_csv(const std::string &csvPath, Store &store)
+    {
+        std::ifstream in(csvPath);
+        if (!in)
+            return -1;
+
+        int64_t rows = 0;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            std::string_view rest(line);
+            if (!rest.empty() && rest.back() == '\r')
+                rest.remove_suffix(1);
+
+            Record record;
+            size_t comma = rest.find(',');
+            if (comma == std::string_view::npos || !parse_time(rest.substr(0, comma), record.time))
+                continue; // header or damaged row
+            rest.remove_prefix(comma + 1);
+
+            size_t i = 0;
+            for (; i < counterCount; ++i)
+            {
+                auto [ptr, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), record.counters[i]);
+                if (ec != std::errc())
+                    break;
+                rest.remove_prefix(static_cast<size_t>(ptr - rest.data()));
+                if (!rest.empty() && rest.front() == ',')
+                    rest.remove_prefix(1);
+            }
+            if (i != counterCount)
+                continue;
+
+            if (!store.append(record))
+                return -1;
+            ++rows;
+        }
+        return rows;
+    }
+
+    int64_t export_csv(const Store &store, const std::string &csvPath)
+    {
+        std::ofstream out(csvPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return -1;
+
+        out << "Date";
+        for (const char *name : counterNames)
+            out << "," << name;
+        out << "\n";
+
+        int64_t rows = 0;
+        bool ok = store.scan(INT64_MIN, INT64_MAX, [&](const Record &record)
+                             {
+                                 out << format_time(record.time);
+                                 for (uint64_t value : record.counters)
+                                     out << "," << value;
+                                 out << "\n";
+                                 ++rows; });
+        out.close();
+        return ok && !out.fail() ? rows : -1;
+    }
+}
@@ -0,0 +1,186 @@
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "include/transport.hpp"
+
+namespace ComPort
+{
+    // -------------------- MemoryTransport --------------------
+    std::pair<std::unique_ptr<MemoryTransport>, std::unique_ptr<MemoryTransport>> MemoryTransport::pair()
+    {
+        auto aToB = std::make_shared<Channel>();
+        auto bToA = std::make_shared<Channel>();
+        return {std::unique_ptr<MemoryTransport>(new MemoryTransport(bToA, aToB)),
+                std::unique_ptr<MemoryTransport>(new MemoryTransport(aToB, bToA))};
+    }
+
+    MemoryTransport::~MemoryTransport()
+    {
+        {
+            std::lock_guard<std::mutex> lock(in->mutex);
+            in->closed = true;
+            in->notify = nullptr;
+        }
+        in->cv.notify_all();
+
+        {
+            std::lock_guard<std::mutex> lock(out->mutex);
+            out->closed = true;
+        }
+        wake(*out);
+    }
+
+    void MemoryTransport::wake(Channel &channel)
+    {
+        channel.cv.notify_all();
+
+        std::function<void()> notify;
+        {
+            std::lock_guard<std::mutex> lock(channel.mutex);
+            notify = channel.notify;
+        }
+        if (notify)
+            notify();
+    }
+
+    bool MemoryTransport::send(std::string_view bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(out->mutex);
+            if (out->closed)
+                return false;
+            // Compact now and then instead of moving the unread bytes on every receive
+            if (out->head > 0 && out->head >= out->data.size() / 2)
+            {
+                out->data.erase(0, out->head);
+                out->head = 0;
+            }
+            out->data.append(bytes);
+        }
+        wake(*out);
+        return true;
+    }
+
+    int MemoryTransport::receive(std::span<char> buffer, int timeoutMs)
+    {
+        std::unique_lock<std::mutex> lock(in->mutex);
+        in->cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]
+                        { return in->closed || in->head < in->data.size(); });
+
+        size_t available = in->data.size() - in->head;
+        if (available == 0)
+            return in->closed ? -1 : 0;
+
+        size_t n = std::min(available, buffer.size());
+        std::memcpy(buffer.data(), in->data.data() + in->head, n);
+        in->head += n;
+        return static_cast<int>(n);
+    }
+
+    void MemoryTransport::discard_input()
+    {
+        std::lock_guard<std::mutex> lock(in->mutex);
+        in->data.clear();
+        in->head = 0;
+    }
+
+    bool MemoryTransport::set_notify(std::function<void()> notify)
+    {
+        std::lock_guard<std::mutex> lock(in->mutex);
+        in->notify = std::move(notify);
+        return true;
+    }
+
+#ifndef _WIN32
+    // -------------------- PtyTransport --------------------
+    std::unique_ptr<PtyTransport> PtyTransport::create()
+    {
+        int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+        {
+            std::cerr << "Cannot create a pseudo terminal: " << std::strerror(errno) << std::endl;
+            if (master >= 0)
+                close(master);
+            return nullptr;
+        }
+
+        std::string path = ptsname(master);
+        int slave = open(path.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (slave < 0)
+        {
+            std::cerr << "Cannot open " << path << ": " << std::strerror(errno) << std::endl;
+            close(master);
+            return nullptr;
+        }
+
+        // Raw from the start so nothing is echoed back before the client configures the port
+        termios tty{};
+        tcgetattr(slave, &tty);
+        cfmakeraw(&tty);
+        tcsetattr(slave, TCSANOW, &tty);
+
+        return std::unique_ptr<PtyTransport>(new PtyTransport(master, slave, path));
+    }
+
+    PtyTransport::~PtyTransport()
+    {
+        close(slaveFd);
+        close(masterFd);
+    }
+
+    bool PtyTransport::send(std::string_view bytes)
+    {
+        while (!bytes.empty())
+        {
+            ssize_t n = write(masterFd, bytes.data(), bytes.size());
+            if (n > 0)
+            {
+                bytes.remove_prefix(static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && errno != EAGAIN)
+                return false;
+
+            // Nobody is reading the slave: after a second drop the data, like a USB device would
+            pollfd pfd{masterFd, POLLOUT, 0};
+            if (poll(&pfd, 1, 1000) == 0)
+                return true;
+        }
+        return true;
+    }
+
+    int PtyTransport::receive(std::span<char> buffer, int timeoutMs)
+    {
+        pollfd pfd{masterFd, POLLIN, 0};
+        int ready = poll(&pfd, 1, timeoutMs);
+        if (ready < 0)
+            return errno == EINTR ? 0 : -1;
+        if (ready == 0)
+            return 0;
+
+        ssize_t n = read(masterFd, buffer.data(), buffer.size());
+        if (n > 0)
+            return static_cast<int>(n);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return 0;
+        return -1;
+    }
+
+    void PtyTransport::discard_input()
+    {
+        tcflush(masterFd, TCIFLUSH);
+    }
+#endif
+}
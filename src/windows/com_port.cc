@@ -1,26 +1,70 @@
 #include <windows.h>
 #include <setupapi.h>
+#include <cfgmgr32.h>
+#include <algorithm>
 #include <iostream>
+#include <mutex>
+#include <span>
 #include <string>
-#include <regex>
-
-#include <QApplication>
-#include <QDateTime>
+#include <unordered_map>
+#include <vector>
 
 #include "../include/com_port.hpp"
-#include "../include/gui.hpp"
+#include "../include/transport.hpp"
 
 #pragma comment(lib, "setupapi.lib")
+#pragma comment(lib, "cfgmgr32.lib")
 
 namespace ComPort
 {
-    bool (*read_data_X)(MouseStatus &status) = nullptr;
-    Subject connectedTo = Subject::NONE;
+    // ReadFile returns as soon as any byte is available, or after this long without one
+    static constexpr DWORD readSliceMs = 50;
+
+    // -------------------- Port cache --------------------
+    // What each present USB device turned out to be, by its device instance id. A rescan only
+    // reads the hardware id, the port name and the serial number of devices it has not seen.
+    static std::mutex portCacheMutex;
+    static std::unordered_map<std::wstring, DeviceInfo> portCache; // subject NONE for other devices
+
+    // False while the device has no port name yet, it is examined again on the next scan
+    static bool examinePort(HDEVINFO deviceInfoSet, SP_DEVINFO_DATA &deviceInfoData, const std::wstring &instanceId,
+                            DeviceInfo &info)
+    {
+        WCHAR hardwareId[256] = {0};
+        if (!SetupDiGetDeviceRegistryProperty(deviceInfoSet, &deviceInfoData, SPDRP_HARDWAREID, NULL,
+                                              (BYTE *)hardwareId, sizeof(hardwareId), NULL))
+            return false;
 
-    bool detectDevices(std::wstring &mouseComPort, std::wstring &receiverComPort)
+        std::wstring hwId(hardwareId);
+        if (hwId.find(mouseVidPid) != std::wstring::npos)
+            info.subject = Subject::MOUSE;
+        else if (hwId.find(receiverVidPid) != std::wstring::npos)
+            info.subject = Subject::RECEIVER;
+        else
+            return true;
+
+        WCHAR portName[256] = {0};
+        DWORD size = sizeof(portName);
+        HKEY hKey = SetupDiOpenDevRegKey(deviceInfoSet, &deviceInfoData, DICS_FLAG_GLOBAL, 0, DIREG_DEV, KEY_READ);
+        if (hKey != INVALID_HANDLE_VALUE)
+        {
+            if (RegQueryValueExW(hKey, L"PortName", NULL, NULL, (BYTE *)portName, &size) == ERROR_SUCCESS)
+                info.port = portName;
+            RegCloseKey(hKey);
+        }
+        if (info.port.empty())
+            return false;
+
+        // USB\VID_2FE3&PID_0003\<serial>, the last part is the serial number if the device has one
+        std::wstring serial = instanceId.substr(instanceId.find_last_of(L'\\') + 1);
+        if (serial.find(L'&') == std::wstring::npos) // else Windows made up an instance path
+            info.serial = std::string(serial.begin(), serial.end());
+        return true;
+    }
+
+    bool detectAllDevices(std::vector<DeviceInfo> &devices)
     {
-        mouseComPort.clear();
-        receiverComPort.clear();
+        devices.clear();
 
         HDEVINFO deviceInfoSet = SetupDiGetClassDevs(NULL, L"USB", NULL, DIGCF_PRESENT | DIGCF_ALLCLASSES);
         if (deviceInfoSet == INVALID_HANDLE_VALUE)
@@ -29,85 +73,142 @@ namespace ComPort
             return false;
         }
 
+        // Devices that are gone drop out of the cache
+        std::lock_guard<std::mutex> lock(portCacheMutex);
+        std::unordered_map<std::wstring, DeviceInfo> present;
         SP_DEVINFO_DATA deviceInfoData = {sizeof(SP_DEVINFO_DATA)};
         for (DWORD i = 0; SetupDiEnumDeviceInfo(deviceInfoSet, i, &deviceInfoData); i++)
         {
-            WCHAR hardwareId[256] = {0};
-            if (SetupDiGetDeviceRegistryProperty(deviceInfoSet, &deviceInfoData, SPDRP_HARDWAREID, NULL,
-                                                 (BYTE *)hardwareId, sizeof(hardwareId), NULL))
-            {
-                std::wstring hwId(hardwareId);
-
-                WCHAR portName[256] = {0};
-                DWORD size = sizeof(portName);
-                HKEY hKey = SetupDiOpenDevRegKey(deviceInfoSet, &deviceInfoData, DICS_FLAG_GLOBAL, 0, DIREG_DEV, KEY_READ);
-                if (hKey != INVALID_HANDLE_VALUE)
-                {
-                    if (RegQueryValueExW(hKey, L"PortName", NULL, NULL, (BYTE *)portName, &size) == ERROR_SUCCESS)
-                    {
-                        std::wstring port(portName);
-                        if (hwId.find(mouseVidPid) != std::wstring::npos)
-                            mouseComPort = port;
-                        else if (hwId.find(receiverVidPid) != std::wstring::npos)
-                            receiverComPort = port;
-                    }
-                    RegCloseKey(hKey);
-                }
-            }
+            WCHAR instanceIdBuffer[256] = {0};
+            if (!SetupDiGetDeviceInstanceIdW(deviceInfoSet, &deviceInfoData, instanceIdBuffer, 256, NULL))
+                continue;
+            const std::wstring instanceId(instanceIdBuffer);
+
+            DeviceInfo info;
+            if (auto cached = portCache.find(instanceId); cached != portCache.end())
+                info = std::move(cached->second);
+            else if (!examinePort(deviceInfoSet, deviceInfoData, instanceId, info))
+                continue;
+
+            if (info.subject != Subject::NONE)
+                devices.push_back(info);
+            present.emplace(instanceId, std::move(info));
         }
+        portCache = std::move(present);
 
         SetupDiDestroyDeviceInfoList(deviceInfoSet);
-        return !mouseComPort.empty() || !receiverComPort.empty();
+        std::sort(devices.begin(), devices.end(), [](const DeviceInfo &a, const DeviceInfo &b)
+                  { return a.port < b.port; });
+        return !devices.empty();
     }
 
-    bool connect(Subject targetSubject, std::wstring targetComPort)
+    bool portMatches(const DeviceInfo &known)
     {
-        if (targetComPort.empty())
-        {
-            std::cerr << "No COM port found for "
-                      << (targetSubject == Subject::MOUSE ? "MOUSE" : "RECEIVER")
-                      << std::endl;
+        // The instance id is USB\VID_2FE3&PID_0003\<serial>, without a serial number Windows
+        // makes one up that cannot be told from the port
+        if (known.serial.empty() || known.subject == Subject::NONE)
+            return false;
+        const std::wstring &vidPid = (known.subject == Subject::MOUSE) ? mouseVidPid : receiverVidPid;
+        const std::wstring instanceId = L"USB\\" + vidPid.substr(0, vidPid.find(L"&REV_")) + L"\\" +
+                                        std::wstring(known.serial.begin(), known.serial.end());
+
+        HDEVINFO deviceInfoSet = SetupDiCreateDeviceInfoList(NULL, NULL);
+        if (deviceInfoSet == INVALID_HANDLE_VALUE)
             return false;
+
+        // SetupDiOpenDeviceInfo finds unplugged devices too, the devnode is only there while it is present
+        SP_DEVINFO_DATA deviceInfoData = {sizeof(SP_DEVINFO_DATA)};
+        ULONG status = 0, problem = 0;
+        DeviceInfo info;
+        const bool present = SetupDiOpenDeviceInfoW(deviceInfoSet, instanceId.c_str(), NULL, 0, &deviceInfoData) &&
+                             CM_Get_DevNode_Status(&status, &problem, deviceInfoData.DevInst, 0) == CR_SUCCESS &&
+                             examinePort(deviceInfoSet, deviceInfoData, instanceId, info);
+        SetupDiDestroyDeviceInfoList(deviceInfoSet);
+        return present && info.port == known.port && info.subject == known.subject && info.serial == known.serial;
+    }
+
+    // -------------------- Serial transport --------------------
+    class SerialTransport : public Transport
+    {
+    public:
+        SerialTransport(HANDLE handle, std::string path) : handle(handle), path(std::move(path)) {}
+        ~SerialTransport() override { CloseHandle(handle); }
+
+        bool send(std::string_view bytes) override
+        {
+            DWORD bw = 0;
+            return WriteFile(handle, bytes.data(), static_cast<DWORD>(bytes.size()), &bw, NULL) && bw == bytes.size();
         }
 
-        std::wstring comPath = L"\\\\.\\" + targetComPort;
-        hSerial = CreateFileW(comPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
-        if (hSerial == INVALID_HANDLE_VALUE)
+        int receive(std::span<char> buffer, int timeoutMs) override
         {
-            std::cerr << "Failed to connect to " << std::string(targetComPort.begin(), targetComPort.end()) << std::endl;
-            return false;
+            // A zero timeout is how DeviceManager polls, do not block for a read slice
+            if (timeoutMs <= 0)
+            {
+                DWORD errors = 0;
+                COMSTAT comStat{};
+                if (!ClearCommError(handle, &errors, &comStat))
+                    return -1;
+                if (comStat.cbInQue == 0)
+                    return 0;
+            }
+
+            const ULONGLONG start = GetTickCount64();
+            while (true)
+            {
+                DWORD br = 0;
+                if (!ReadFile(handle, buffer.data(), static_cast<DWORD>(buffer.size()), &br, NULL))
+                    return -1;
+                if (br > 0)
+                    return static_cast<int>(br);
+                if (GetTickCount64() - start >= static_cast<ULONGLONG>(timeoutMs))
+                    return 0;
+            }
         }
 
-        std::cout << "Connected to " << std::string(targetComPort.begin(), targetComPort.end()) << std::endl;
+        void discard_input() override { PurgeComm(handle, PURGE_RXCLEAR); }
+        std::string name() const override { return path; }
+
+    private:
+        HANDLE handle;
+        std::string path;
+    };
+
+    std::unique_ptr<Transport> open_serial_transport(const std::wstring &port)
+    {
+        std::string path(port.begin(), port.end());
+        std::wstring comPath = L"\\\\.\\" + port;
+        HANDLE hSerial = CreateFileW(comPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (hSerial == INVALID_HANDLE_VALUE)
+        {
+            std::cerr << "Failed to connect to " << path << std::endl;
+            return nullptr;
+        }
 
         DCB dcb = {0};
         dcb.DCBlength = sizeof(dcb);
-        ret = GetCommState(hSerial, &dcb);
-        if (!ret)
+        if (!GetCommState(hSerial, &dcb))
         {
             std::cerr << "GetCommState failed" << std::endl;
             CloseHandle(hSerial);
-            hSerial = INVALID_HANDLE_VALUE;
-            return false;
+            return nullptr;
         }
 
         dcb.BaudRate = CBR_115200;
         dcb.ByteSize = 8;
         dcb.StopBits = ONESTOPBIT;
         dcb.Parity = NOPARITY;
-        ret = SetCommState(hSerial, &dcb);
-        if (!ret)
+        if (!SetCommState(hSerial, &dcb))
         {
             std::cerr << "SetCommState failed" << std::endl;
             CloseHandle(hSerial);
-            hSerial = INVALID_HANDLE_VALUE;
-            return false;
+            return nullptr;
         }
 
         COMMTIMEOUTS timeouts = {0};
-        timeouts.ReadIntervalTimeout = 50;
-        timeouts.ReadTotalTimeoutConstant = 50;
-        timeouts.ReadTotalTimeoutMultiplier = 10;
+        timeouts.ReadIntervalTimeout = MAXDWORD;
+        timeouts.ReadTotalTimeoutConstant = readSliceMs;
+        timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
         timeouts.WriteTotalTimeoutConstant = 50;
         timeouts.WriteTotalTimeoutMultiplier = 10;
 
@@ -115,129 +216,10 @@ namespace ComPort
         {
             std::cerr << "SetCommTimeouts failed" << std::endl;
             CloseHandle(hSerial);
-            hSerial = INVALID_HANDLE_VALUE;
-            return false;
+            return nullptr;
         }
 
-        connectedTo = targetSubject;
-        read_data_X = (connectedTo == Subject::MOUSE) ? read_data_mouse : read_data_receiver;
-        return true;
-    }
-
-    void disconnect()
-    {
-        if (hSerial != INVALID_HANDLE_VALUE)
-        {
-            CloseHandle(hSerial);
-            hSerial = INVALID_HANDLE_VALUE;
-        }
-        connectedTo = Subject::NONE;
-        read_data_X = nullptr;
-    }
-
-    bool read_data_receiver(MouseStatus &status)
-    {
-        const char enter = '1';
-        DWORD bw = 0;
-        if (!WriteFile(hSerial, &enter, 1, &bw, NULL))
-        {
-            std::cout << "Failed to send ENTER to receiver" << std::endl;
-            return false;
-        }
-
-        char buf[1024] = {0};
-        DWORD br = 0;
-        if (!ReadFile(hSerial, buf, sizeof(buf) - 1, &br, NULL))
-            return false;
-
-        std::string response(buf, br);
-        std::smatch m;
-        std::regex battery_re(R"(Battery level:\s*(-?\d+)mV\s*=\s*(\d+)%?)");
-        if (std::regex_search(response, m, battery_re))
-        {
-            status.battery_mv = std::stoi(m[1]);
-            status.battery_percent = std::stoi(m[2]);
-        }
-
-        Gui::lastReadingTime = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-        return true;
-    }
-
-    bool read_data_mouse(MouseStatus &status)
-    {
-        const char enter = '1';
-        DWORD bw = 0;
-        if (!WriteFile(hSerial, &enter, 1, &bw, NULL))
-        {
-            std::cout << "Failed to send ENTER to mouse" << std::endl;
-            return false;
-        }
-
-        char buf[1024] = {0};
-        DWORD br = 0;
-        if (!ReadFile(hSerial, buf, sizeof(buf) - 1, &br, NULL))
-            return false;
-
-        std::string response(buf, br);
-        std::smatch m;
-
-        std::regex clicks_re(R"(Left clicks:\s*(\d+))");
-        if (std::regex_search(response, m, clicks_re))
-            status.left_clicks = std::stoull(m[1]);
-
-        clicks_re = std::regex(R"(Right clicks:\s*(\d+))");
-        if (std::regex_search(response, m, clicks_re))
-            status.right_clicks = std::stoull(m[1]);
-
-        clicks_re = std::regex(R"(Middle clicks:\s*(\d+))");
-        if (std::regex_search(response, m, clicks_re))
-            status.middle_clicks = std::stoull(m[1]);
-
-        clicks_re = std::regex(R"(Backward clicks:\s*(\d+))");
-        if (std::regex_search(response, m, clicks_re))
-            status.backward_clicks = std::stoull(m[1]);
-
-        clicks_re = std::regex(R"(Forward clicks:\s*(\d+))");
-        if (std::regex_search(response, m, clicks_re))
-            status.forward_clicks = std::stoull(m[1]);
-
-        clicks_re = std::regex(R"(Downward scrolls:\s*(\d+))");
-        if (std::regex_search(response, m, clicks_re))
-            status.downward_scrolls = std::stoull(m[1]);
-
-        clicks_re = std::regex(R"(Upward scrolls:\s*(\d+))");
-        if (std::regex_search(response, m, clicks_re))
-            status.upward_scrolls = std::stoull(m[1]);
-
-        std::regex battery_re(R"(Battery level:\s*(-?\d+)mV\s*=\s*(\d+)%?)");
-        if (std::regex_search(response, m, battery_re))
-        {
-            status.battery_mv = std::stoi(m[1]);
-            status.battery_percent = std::stoi(m[2]);
-        }
-
-        std::regex dpi_re(R"(Current DPI \[.*\]:\s*(\d+))");
-        if (std::regex_search(response, m, dpi_re))
-            status.current_dpi = std::stoi(m[1]);
-
-        Gui::lastReadingTime = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-        return true;
-    }
-
-    void print_status(MouseStatus &status)
-    {
-        std::cout << "==================== Mouse Status ====================\n";
-        std::cout << "Firmware build date: " << status.firmware_build_date << "\n";
-        std::cout << "Left clicks:        " << status.left_clicks << "\n";
-        std::cout << "Right clicks:       " << status.right_clicks << "\n";
-        std::cout << "Middle clicks:      " << status.middle_clicks << "\n";
-        std::cout << "Backward clicks:    " << status.backward_clicks << "\n";
-        std::cout << "Forward clicks:     " << status.forward_clicks << "\n";
-        std::cout << "Downward scrolls:   " << status.downward_scrolls << "\n";
-        std::cout << "Upward scrolls:     " << status.upward_scrolls << "\n";
-        std::cout << "Battery level:      " << status.battery_mv << "mV = " << status.battery_percent << "%\n";
-        std::cout << "Current DPI:        " << status.current_dpi << "\n";
-        std::cout << "======================================================\n";
+        return std::make_unique<SerialTransport>(hSerial, path);
     }
 
     // Simplified helper to select and connect to device
@@ -0,0 +1,106 @@
+#include <algorithm>
+
+#include "include/work_pool.hpp"
+
+// Index of the worker running on this thread, -1 elsewhere
+static thread_local int currentWorker = -1;
+static thread_local const WorkPool *currentPool = nullptr;
+
+WorkPool::WorkPool(unsigned threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threadCount; ++i)
+        workers.push_back(std::make_unique<Worker>());
+    for (unsigned i = 0; i < threadCount; ++i)
+        threads.emplace_back([this, i]
+                             { run(i); });
+}
+
+WorkPool::~WorkPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+void WorkPool::submit(Task task)
+{
+    const unsigned target = currentPool == this ? static_cast<unsigned>(currentWorker)
+                                                : nextWorker.fetch_add(1, std::memory_order_relaxed) % size();
+    {
+        std::lock_guard<std::mutex> lock(workers[target]->mutex);
+        workers[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++queued;
+        ++unfinished;
+    }
+    workAvailable.notify_one();
+}
+
+void WorkPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    allDone.wait(lock, [this]
+                 { return unfinished == 0; });
+}
+
+bool WorkPool::take(unsigned index, Task &task)
+{
+    {
+        Worker &own = *workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (unsigned k = 1; k < size(); ++k)
+    {
+        Worker &victim = *workers[(index + k) % size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkPool::run(unsigned index)
+{
+    currentWorker = static_cast<int>(index);
+    currentPool = this;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this]
+                               { return queued > 0 || stopping; });
+            if (queued == 0)
+                return; // stopping with nothing left
+            --queued;
+        }
+
+        // The claimed task was pushed before it was counted, it is in some deque
+        Task task;
+        while (!take(index, task))
+            std::this_thread::yield();
+        task();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--unfinished == 0)
+            allDone.notify_all();
+    }
+}
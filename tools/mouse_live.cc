@@ -0,0 +1,76 @@
+// Prints what a running mouse_client publishes, an example of reading the live region
+//
+//   mouse_live            status readings of every device as they come in
+//   mouse_live --motion   motion samples too, while a --motion-capture runs
+//   mouse_live --once     the latest reading, then exit
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "../src/include/live_ring.hpp"
+
+static void print_status(const Live::StatusRecord &status)
+{
+    const char *subject = status.subject == Live::SUBJECT_MOUSE      ? "MOUSE"
+                          : status.subject == Live::SUBJECT_RECEIVER ? "RECEIVER"
+                                                                     : "-";
+    std::printf("%lld %-8s %-16s L %llu R %llu M %llu B %llu F %llu D %llu U %llu dpi %d battery %d%% (%d mV)\n",
+                static_cast<long long>(status.time), subject, status.device,
+                static_cast<unsigned long long>(status.left_clicks),
+                static_cast<unsigned long long>(status.right_clicks),
+                static_cast<unsigned long long>(status.middle_clicks),
+                static_cast<unsigned long long>(status.backward_clicks),
+                static_cast<unsigned long long>(status.forward_clicks),
+                static_cast<unsigned long long>(status.downward_scrolls),
+                static_cast<unsigned long long>(status.upward_scrolls),
+                status.current_dpi, status.battery_percent, status.battery_mv);
+}
+
+int main(int argc, char *argv[])
+{
+    bool motion = false, once = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--motion") == 0)
+            motion = true;
+        else if (std::strcmp(argv[i], "--once") == 0)
+            once = true;
+    }
+
+    Live::Reader reader;
+    if (!reader.open())
+    {
+        std::fprintf(stderr, "mouse_client is not running (or is another version)\n");
+        return 1;
+    }
+
+    Live::StatusRecord status;
+    if (reader.latest_status(status))
+        print_status(status);
+    if (once)
+        return 0;
+
+    // The rings hold seconds of data, polling them a few times per second loses nothing
+    uint64_t missed = 0;
+    Live::MotionRecord sample;
+    while (true)
+    {
+        while (reader.next_status(status))
+            print_status(status);
+        while (motion && reader.next_motion(sample))
+            std::printf("[%u] before %d,%d after %d,%d cond %u,%u\n", sample.block, sample.before_x, sample.before_y,
+                        sample.after_x, sample.after_y, sample.x_cond, sample.y_cond);
+        if (!motion)
+            while (reader.next_motion(sample))
+                ;
+
+        if (reader.missed() != missed)
+        {
+            std::fprintf(stderr, "fell behind, %llu records missed\n", static_cast<unsigned long long>(reader.missed() - missed));
+            missed = reader.missed();
+        }
+        std::fflush(stdout);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}